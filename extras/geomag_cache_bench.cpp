@@ -0,0 +1,73 @@
+// Benchmark of geomag::ConcurrentFieldCache with 1, 8, and 32 threads.
+// Each thread looks up interleaved vehicles driving repeated routes, the cache is shared.
+// Compile for example with the command
+// g++ geomag_cache_bench.cpp -std=c++14 -O2 -pthread -DXYZgeomag_SINGLE_PRECISION
+#include <stdio.h>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../src/XYZgeomag_cache.hpp"
+
+const size_t NUM_VEHICLES= 2048;
+const size_t ROUTE_LENGTH= 64;//positions per route, 25 m apart
+const size_t LOOKUPS= 4000000;//total lookups, split between the threads
+
+int main(){
+    std::mt19937 rng(15);
+    std::uniform_real_distribution<double> lat(-60, 60);
+    std::uniform_real_distribution<double> lon(-180, 180);
+    std::vector<geomag::Vector> routes;
+    for (size_t v = 0; v < NUM_VEHICLES; v++){
+        TPrecision la= lat(rng);
+        TPrecision lo= lon(rng);
+        for (size_t s = 0; s < ROUTE_LENGTH; s++){
+            routes.push_back(geomag::geodetic2ecef(la, lo+s*25/111000.0f, 100));
+        }
+    }
+    printf("threads, ns per lookup, lookups per s, hit rate, min and max shard lookups\n");
+    for (unsigned numthreads : {1u, 8u, 32u}){
+        geomag::ConcurrentFieldCache cache(16<<20, 10, 0.01f);
+        auto work= [&](unsigned self){
+            size_t per= LOOKUPS/numthreads;
+            for (size_t k = 0; k < per; k++){
+                // each thread follows every vehicle it serves along its route
+                size_t vehicle= (k*numthreads+self)%NUM_VEHICLES;
+                size_t step= (k*numthreads+self)/NUM_VEHICLES%ROUTE_LENGTH;
+                geomag::GeoMagCached(cache, 2022.5f, routes[vehicle*ROUTE_LENGTH+step], geomag::WMM2020);
+            }
+        };
+        auto start= std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (unsigned t = 1; t < numthreads; t++){
+            threads.emplace_back(work, t);
+        }
+        work(0);
+        for (std::thread& thread : threads){
+            thread.join();
+        }
+        double seconds= std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+        geomag::CacheStats stats= geomag::cacheStats(cache);
+        uint64_t total= stats.hits+stats.misses;
+        uint64_t minshard= total;
+        uint64_t maxshard= 0;
+        for (size_t s = 0; s < cache.shards.size(); s++){
+            geomag::CacheStats shard= geomag::shardStats(cache, s);
+            uint64_t lookups= shard.hits+shard.misses;
+            minshard= (lookups < minshard) ? lookups : minshard;
+            maxshard= (lookups > maxshard) ? lookups : maxshard;
+        }
+        printf("%u, %.1f, %.3g, %.4f, %llu %llu\n", numthreads, seconds*1E9/total, total/seconds,
+               (double)stats.hits/total, (unsigned long long)minshard, (unsigned long long)maxshard);
+    }
+    // the same lookups without the cache, on one thread
+    size_t count= LOOKUPS/20;
+    auto start= std::chrono::steady_clock::now();
+    TPrecision sum= 0;
+    for (size_t k = 0; k < count; k++){
+        sum+= geomag::GeoMag(2022.5f, routes[(k%NUM_VEHICLES)*ROUTE_LENGTH+k/NUM_VEHICLES%ROUTE_LENGTH], geomag::WMM2020).x;
+    }
+    double seconds= std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    printf("uncached GeoMag, %.1f ns per lookup (%g)\n", seconds*1E9/count, sum);
+    return 0;
+}
@@ -0,0 +1,1226 @@
+/** \file
+ * \brief c++ catch2 tests comparing the alternative GeoMag kernels against geomag::GeoMag.
+ * \details Compile with g++ geomag_kernels_test.cpp -std=c++14 -DXYZgeomag_SINGLE_PRECISION
+ */
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+#include "../src/XYZgeomag_basis.hpp"
+#include "../src/XYZgeomag_batch.hpp"
+#include "../src/XYZgeomag_cache.hpp"
+#include "../src/XYZgeomag_columns.hpp"
+#include "../src/XYZgeomag_dispatch.hpp"
+#include "../src/XYZgeomag_ensemble.hpp"
+#include "../src/XYZgeomag_fixed.hpp"
+#include "../src/XYZgeomag_gemm.hpp"
+#include "../src/XYZgeomag_gradient.hpp"
+#include "../src/XYZgeomag_grid.hpp"
+#include "../src/XYZgeomag_parallel.hpp"
+#include "../src/XYZgeomag_profile.hpp"
+#include "../src/XYZgeomag_tiles.hpp"
+#include "../src/XYZgeomag_table.hpp"
+#include "../src/XYZgeomag_simd.hpp"
+
+/** Margin between the derivative coefficient kernels and GeoMag(dyear, position, WMM), units nT.
+The derivative coefficients fold the factors of each term together ahead of time, so they round differently:
+the largest difference over 200000 random positions is 0.124 nT in single precision and 3E-10 nT in double precision.*/
+static const double DERIVATIVE_MARGIN_NT= (sizeof(TPrecision) == sizeof(float)) ? 0.2 : 1E-8;
+
+/** Fill x, y, z with count random positions from 1000 km below to 1000 km above the geoid radius.*/
+static void randomPositions(size_t count, unsigned seed, std::vector<TPrecision>& x, std::vector<TPrecision>& y, std::vector<TPrecision>& z){
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> dir(0.0, 1.0);
+    std::uniform_real_distribution<double> height(-1E6, 1E6);
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+    for (size_t i = 0; i < count; i++){
+        double u= dir(rng);
+        double v= dir(rng);
+        double w= dir(rng);
+        double r= (geomag::EARTH_R+height(rng))/std::sqrt(u*u+v*v+w*w);
+        x[i]= u*r;
+        y[i]= v*r;
+        z[i]= w*r;
+    }
+}
+
+
+TEST_CASE( "batch matches scalar GeoMag", "[Batch]" ) {
+    // not a multiple of BATCH_BLOCK, to cover the partial block.
+    const size_t count= 1000;
+    std::vector<TPrecision> x, y, z;
+    randomPositions(count, 1234, x, y, z);
+    std::vector<TPrecision> bx(count), by(count), bz(count);
+    geomag::GeoMagBatch(2022.5, x.data(), y.data(), z.data(), count, geomag::WMM2020, bx.data(), by.data(), bz.data());
+    geomag::DerivativeCoeffs coeffs= geomag::derivativeCoeffs(geomag::snapshotModel(2022.5, geomag::WMM2020));
+    for (size_t i = 0; i < count; i++){
+        geomag::Vector truth= geomag::GeoMag({x[i], y[i], z[i]}, coeffs);
+        CHECK( bx[i]*1E9 == Approx(truth.x*1E9).margin(1E-3) );
+        CHECK( by[i]*1E9 == Approx(truth.y*1E9).margin(1E-3) );
+        CHECK( bz[i]*1E9 == Approx(truth.z*1E9).margin(1E-3) );
+        geomag::Vector model= geomag::GeoMag(2022.5, {x[i], y[i], z[i]}, geomag::WMM2020);
+        CHECK( bx[i]*1E9 == Approx(model.x*1E9).margin(DERIVATIVE_MARGIN_NT) );
+        CHECK( by[i]*1E9 == Approx(model.y*1E9).margin(DERIVATIVE_MARGIN_NT) );
+        CHECK( bz[i]*1E9 == Approx(model.z*1E9).margin(DERIVATIVE_MARGIN_NT) );
+    }
+}
+
+
+TEST_CASE( "gemm matches scalar GeoMag", "[Gemm]" ) {
+    // not a multiple of GEMM_TILE, to cover the padded tile.
+    const size_t count= 1000+13;
+    std::vector<TPrecision> x, y, z;
+    randomPositions(count, 2121, x, y, z);
+    std::vector<TPrecision> bx(count), by(count), bz(count);
+    geomag::GeoMagGemm(2022.5, x.data(), y.data(), z.data(), count, geomag::WMM2020, bx.data(), by.data(), bz.data());
+    geomag::DerivativeCoeffs coeffs= geomag::derivativeCoeffs(geomag::snapshotModel(2022.5, geomag::WMM2020));
+    for (size_t i = 0; i < count; i++){
+        geomag::Vector truth= geomag::GeoMag({x[i], y[i], z[i]}, coeffs);
+        CHECK( bx[i]*1E9 == Approx(truth.x*1E9).margin(1E-3) );
+        CHECK( by[i]*1E9 == Approx(truth.y*1E9).margin(1E-3) );
+        CHECK( bz[i]*1E9 == Approx(truth.z*1E9).margin(1E-3) );
+    }
+}
+
+TEST_CASE( "columns match scalar GeoMag", "[Columns]" ) {
+    const size_t count= 300;
+    std::vector<TPrecision> x, y, z;
+    randomPositions(count, 2323, x, y, z);
+    geomag::DerivativeCoeffs coeffs= geomag::derivativeCoeffs(geomag::snapshotModel(2022.5, geomag::WMM2020));
+    // 4 lanes leave a partly filled last group, 16 lanes a single group of NMAX+2 columns
+    static geomag::ColumnCoeffs<4> columns4= geomag::columnCoeffs<4>(coeffs);
+    static geomag::ColumnCoeffs<16> columns16= geomag::columnCoeffs<16>(coeffs);
+    for (size_t i = 0; i < count; i++){
+        geomag::Vector truth= geomag::GeoMag({x[i], y[i], z[i]}, coeffs);
+        geomag::Vector out4= geomag::GeoMagColumns({x[i], y[i], z[i]}, columns4);
+        geomag::Vector out16= geomag::GeoMagColumns({x[i], y[i], z[i]}, columns16);
+        CHECK( out4.x*1E9 == Approx(truth.x*1E9).margin(0.5) );
+        CHECK( out4.y*1E9 == Approx(truth.y*1E9).margin(0.5) );
+        CHECK( out4.z*1E9 == Approx(truth.z*1E9).margin(0.5) );
+        CHECK( out16.x*1E9 == Approx(truth.x*1E9).margin(0.5) );
+        CHECK( out16.y*1E9 == Approx(truth.y*1E9).margin(0.5) );
+        CHECK( out16.z*1E9 == Approx(truth.z*1E9).margin(0.5) );
+    }
+}
+
+TEST_CASE( "every supported dispatch kernel matches scalar GeoMag", "[Dispatch]" ) {
+    const size_t count= 1000+13;
+    std::vector<TPrecision> x, y, z;
+    randomPositions(count, 2424, x, y, z);
+    geomag::DerivativeCoeffs coeffs= geomag::derivativeCoeffs(geomag::snapshotModel(2022.5, geomag::WMM2020));
+    static geomag::dispatch::PointCoeffs point;
+    point= geomag::dispatch::pointCoeffs(coeffs);
+    std::vector<TPrecision> bx(count), by(count), bz(count);
+    for (int isa = 0; isa < geomag::dispatch::NUM_ISAS; isa++){
+        if (!geomag::dispatch::isaSupported(geomag::dispatch::Isa(isa))){
+            continue;
+        }
+        geomag::dispatch::Kernels kernels= geomag::dispatch::kernelsFor(geomag::dispatch::Isa(isa));
+        CHECK( kernels.isa == isa );
+#if defined(XYZgeomag_HAVE_SIMD)
+        if (isa == geomag::dispatch::ISA_AVX512){
+            // AVX-512F doesn't imply the AVX2 and FMA of the point kernel
+            CHECK( kernels.point == (geomag::avx2::supported() ? geomag::dispatch::avx2Point : geomag::dispatch::ssePoint) );
+        }
+#endif
+        kernels.batch(x.data(), y.data(), z.data(), count, coeffs, bx.data(), by.data(), bz.data());
+        for (size_t i = 0; i < count; i++){
+            geomag::Vector truth= geomag::GeoMag({x[i], y[i], z[i]}, coeffs);
+            geomag::Vector single= kernels.point({x[i], y[i], z[i]}, point);
+            CHECK( bx[i]*1E9 == Approx(truth.x*1E9).margin(0.5) );
+            CHECK( by[i]*1E9 == Approx(truth.y*1E9).margin(0.5) );
+            CHECK( bz[i]*1E9 == Approx(truth.z*1E9).margin(0.5) );
+            CHECK( single.x*1E9 == Approx(truth.x*1E9).margin(0.5) );
+            CHECK( single.y*1E9 == Approx(truth.y*1E9).margin(0.5) );
+            CHECK( single.z*1E9 == Approx(truth.z*1E9).margin(0.5) );
+        }
+    }
+    // the selected kernels
+    geomag::dispatch::GeoMagBatch(2022.5, x.data(), y.data(), z.data(), count, geomag::WMM2020, bx.data(), by.data(), bz.data());
+    for (size_t i = 0; i < count; i++){
+        geomag::Vector truth= geomag::GeoMag({x[i], y[i], z[i]}, coeffs);
+        geomag::Vector single= geomag::dispatch::GeoMag({x[i], y[i], z[i]}, point);
+        CHECK( bx[i]*1E9 == Approx(truth.x*1E9).margin(0.5) );
+        CHECK( bz[i]*1E9 == Approx(truth.z*1E9).margin(0.5) );
+        CHECK( single.x*1E9 == Approx(truth.x*1E9).margin(0.5) );
+        CHECK( single.z*1E9 == Approx(truth.z*1E9).margin(0.5) );
+    }
+}
+
+TEST_CASE( "dispatch override by name", "[Dispatch]" ) {
+    geomag::dispatch::Isa best= geomag::dispatch::bestIsa();
+    CHECK( geomag::dispatch::isaSupported(best) );
+    CHECK( geomag::dispatch::chooseIsa(nullptr, best) == best );
+    CHECK( geomag::dispatch::chooseIsa("no such kernel", best) == best );
+    CHECK( geomag::dispatch::chooseIsa("scalar", best) == geomag::dispatch::ISA_SCALAR );
+    for (int isa = 0; isa < geomag::dispatch::NUM_ISAS; isa++){
+        geomag::dispatch::Isa named= geomag::dispatch::chooseIsa(geomag::dispatch::isaName(geomag::dispatch::Isa(isa)), best);
+        CHECK( named == (geomag::dispatch::isaSupported(geomag::dispatch::Isa(isa)) ? isa : best) );
+    }
+    CHECK( geomag::dispatch::isaSupported(geomag::dispatch::kernels().isa) );
+}
+
+/** The decimal year, model, and position of a test point of geomag_test.cpp.*/
+struct FixedTestPoint{
+    float dyear;
+    int model;//index into the models of checkFixedPoints
+    double a, b, c;//x, y, z in m, or latitude, longitude in degrees and height in m
+};
+
+/** Check GeoMagFixed against GeoMag at the points, within 10 nT, returning the largest difference.*/
+static double checkFixedPoints(const FixedTestPoint* points, size_t count, bool geodetic){
+    const geomag::ConstModel* models[3]= {&geomag::WMM2015, &geomag::WMM2015v2, &geomag::WMM2020};
+    const geomag::FixedModel* fixed[3]= {&geomag::WMM2015_FIXED, &geomag::WMM2015v2_FIXED, &geomag::WMM2020_FIXED};
+    double maxerr= 0;
+    for (size_t i = 0; i < count; i++){
+        const FixedTestPoint& p= points[i];
+        geomag::Vector position= geodetic ? geomag::geodetic2ecef(p.a, p.b, p.c) : geomag::Vector{(TPrecision)p.a, (TPrecision)p.b, (TPrecision)p.c};
+        // the fixed point kernel takes whole meters
+        geomag::FixedVector in= {(int32_t)lround(position.x), (int32_t)lround(position.y), (int32_t)lround(position.z)};
+        geomag::Vector truth= geomag::GeoMag(p.dyear, {(TPrecision)in.x, (TPrecision)in.y, (TPrecision)in.z}, *models[p.model]);
+        geomag::FixedVector out= geomag::GeoMagFixed((int32_t)lround(p.dyear*65536.0), in, *fixed[p.model]);
+        CHECK( out.x == Approx(truth.x*1E9).margin(10) );
+        CHECK( out.y == Approx(truth.y*1E9).margin(10) );
+        CHECK( out.z == Approx(truth.z*1E9).margin(10) );
+        maxerr= std::max(maxerr, std::max(std::fabs(out.x-truth.x*1E9), std::max(std::fabs(out.y-truth.y*1E9), std::fabs(out.z-truth.z*1E9))));
+    }
+    return maxerr;
+}
+
+TEST_CASE( "fixed point matches GeoMag at the test points", "[Fixed]" ) {
+    // the [GeoMag] and [Full GeoMag] test points of geomag_test.cpp
+    static const FixedTestPoint itrs[]= {
+    {2015.0, 0, 1111164.8708100126, 0.0, 6259542.961028692},
+    {2015.0, 0, -3189068.4999999986, 5523628.670817468, 0.0},
+    {2015.0, 0, -555582.4354050067, -962297.0059143244, -6259542.961028692},
+    {2015.0, 0, 1128529.6885767058, 0.0, 6358023.736329913},
+    {2015.0, 0, -3239068.4999999986, 5610231.211195912, 0.0},
+    {2015.0, 0, -564264.8442883533, -977335.3792323681, -6358023.736329913},
+    {2017.5, 0, 1111164.8708100126, 0.0, 6259542.961028692},
+    {2017.5, 0, -3189068.4999999986, 5523628.670817468, 0.0},
+    {2017.5, 0, -555582.4354050067, -962297.0059143244, -6259542.961028692},
+    {2017.5, 0, 1128529.6885767058, 0.0, 6358023.736329913},
+    {2017.5, 0, -3239068.4999999986, 5610231.211195912, 0.0},
+    {2017.5, 0, -564264.8442883533, -977335.3792323681, -6358023.736329913},
+    {2015.0, 1, 1111164.8708100126, 0.0, 6259542.961028692},
+    {2015.0, 1, -3189068.4999999986, 5523628.670817468, 0.0},
+    {2015.0, 1, -555582.4354050067, -962297.0059143244, -6259542.961028692},
+    {2015.0, 1, 1128529.6885767058, 0.0, 6358023.736329913},
+    {2015.0, 1, -3239068.4999999986, 5610231.211195912, 0.0},
+    {2015.0, 1, -564264.8442883533, -977335.3792323681, -6358023.736329913},
+    {2017.5, 1, 1111164.8708100126, 0.0, 6259542.961028692},
+    {2017.5, 1, -3189068.4999999986, 5523628.670817468, 0.0},
+    {2017.5, 1, -555582.4354050067, -962297.0059143244, -6259542.961028692},
+    {2017.5, 1, 1128529.6885767058, 0.0, 6358023.736329913},
+    {2017.5, 1, -3239068.4999999986, 5610231.211195912, 0.0},
+    {2017.5, 1, -564264.8442883533, -977335.3792323681, -6358023.736329913},
+    {2020.0, 2, 1111164.8708100126, 0.0, 6259542.961028692},
+    {2020.0, 2, -3189068.4999999986, 5523628.670817468, 0.0},
+    {2020.0, 2, -555582.4354050067, -962297.0059143244, -6259542.961028692},
+    {2020.0, 2, 1128529.6885767058, 0.0, 6358023.736329913},
+    {2020.0, 2, -3239068.4999999986, 5610231.211195912, 0.0},
+    {2020.0, 2, -564264.8442883533, -977335.3792323681, -6358023.736329913},
+    {2022.5, 2, 1111164.8708100126, 0.0, 6259542.961028692},
+    {2022.5, 2, -3189068.4999999986, 5523628.670817468, 0.0},
+    {2022.5, 2, -555582.4354050067, -962297.0059143244, -6259542.961028692},
+    {2022.5, 2, 1128529.6885767058, 0.0, 6358023.736329913},
+    {2022.5, 2, -3239068.4999999986, 5610231.211195912, 0.0},
+    {2022.5, 2, -564264.8442883533, -977335.3792323681, -6358023.736329913},
+    };
+    static const FixedTestPoint geodetic[]= {
+    {2015.0, 0, 80, 0, 0.0},
+    {2015.0, 0, 0, 120, 0.0},
+    {2015.0, 0, -80, 240, 0.0},
+    {2015.0, 0, 80, 0, 100000.0},
+    {2015.0, 0, 0, 120, 100000.0},
+    {2015.0, 0, -80, 240, 100000.0},
+    {2017.5, 0, 80, 0, 0.0},
+    {2017.5, 0, 0, 120, 0.0},
+    {2017.5, 0, -80, 240, 0.0},
+    {2017.5, 0, 80, 0, 100000.0},
+    {2017.5, 0, 0, 120, 100000.0},
+    {2017.5, 0, -80, 240, 100000.0},
+    {2015.0, 1, 80, 0, 0.0},
+    {2015.0, 1, 0, 120, 0.0},
+    {2015.0, 1, -80, 240, 0.0},
+    {2015.0, 1, 80, 0, 100000.0},
+    {2015.0, 1, 0, 120, 100000.0},
+    {2015.0, 1, -80, 240, 100000.0},
+    {2017.5, 1, 80, 0, 0.0},
+    {2017.5, 1, 0, 120, 0.0},
+    {2017.5, 1, -80, 240, 0.0},
+    {2017.5, 1, 80, 0, 100000.0},
+    {2017.5, 1, 0, 120, 100000.0},
+    {2017.5, 1, -80, 240, 100000.0},
+    {2020.0, 2, 80, 0, 0.0},
+    {2020.0, 2, 0, 120, 0.0},
+    {2020.0, 2, -80, 240, 0.0},
+    {2020.0, 2, 80, 0, 100000.0},
+    {2020.0, 2, 0, 120, 100000.0},
+    {2020.0, 2, -80, 240, 100000.0},
+    {2022.5, 2, 80, 0, 0.0},
+    {2022.5, 2, 0, 120, 0.0},
+    {2022.5, 2, -80, 240, 0.0},
+    {2022.5, 2, 80, 0, 100000.0},
+    {2022.5, 2, 0, 120, 100000.0},
+    {2022.5, 2, -80, 240, 100000.0},
+    };
+    double maxerr= std::max(checkFixedPoints(itrs, sizeof(itrs)/sizeof(itrs[0]), false),
+                            checkFixedPoints(geodetic, sizeof(geodetic)/sizeof(geodetic[0]), true));
+    // the coefficients are rounded to 1/128 nT and the field to 1 nT
+    CHECK( maxerr < 1.0 );
+}
+
+TEST_CASE( "batch with per point times matches scalar GeoMag", "[Batch]" ) {
+    const size_t count= 333;
+    std::vector<TPrecision> x, y, z;
+    randomPositions(count, 1717, x, y, z);
+    std::vector<float> dyear(count);
+    std::mt19937 rng(1717);
+    std::uniform_real_distribution<float> year(2020, 2025);
+    for (size_t i = 0; i < count; i++){
+        dyear[i]= year(rng);
+    }
+    std::vector<TPrecision> bx(count), by(count), bz(count);
+    geomag::GeoMagBatch(dyear.data(), x.data(), y.data(), z.data(), count, geomag::WMM2020, bx.data(), by.data(), bz.data());
+    for (size_t i = 0; i < count; i++){
+        geomag::Vector truth= geomag::GeoMag(dyear[i], {x[i], y[i], z[i]}, geomag::WMM2020);
+        CHECK( bx[i]*1E9 == Approx(truth.x*1E9).margin(0.5) );
+        CHECK( by[i]*1E9 == Approx(truth.y*1E9).margin(0.5) );
+        CHECK( bz[i]*1E9 == Approx(truth.z*1E9).margin(0.5) );
+    }
+    // at one shared time it matches the shared snapshot batch
+    std::vector<float> same(count, 2022.5f);
+    std::vector<TPrecision> sx(count), sy(count), sz(count);
+    geomag::GeoMagBatch(same.data(), x.data(), y.data(), z.data(), count, geomag::WMM2020, bx.data(), by.data(), bz.data());
+    geomag::GeoMagBatch(2022.5f, x.data(), y.data(), z.data(), count, geomag::WMM2020, sx.data(), sy.data(), sz.data());
+    for (size_t i = 0; i < count; i++){
+        CHECK( bx[i]*1E9 == Approx(sx[i]*1E9).margin(0.5) );
+        CHECK( by[i]*1E9 == Approx(sy[i]*1E9).margin(0.5) );
+        CHECK( bz[i]*1E9 == Approx(sz[i]*1E9).margin(0.5) );
+    }
+}
+
+TEST_CASE( "profile matches scalar GeoMag along a radius", "[Profile]" ) {
+    geomag::DerivativeCoeffs coeffs= geomag::derivativeCoeffs(geomag::snapshotModel(2022.5, geomag::WMM2020));
+    const size_t count= 300;
+    std::vector<TPrecision> heights(count), radii(count);
+    for (size_t i = 0; i < count; i++){
+        heights[i]= -400+i*(1.0E6f/count);
+    }
+    std::vector<TPrecision> bx(count), by(count), bz(count);
+    for (int lat = -90; lat <= 90; lat+= 30){
+        for (int lon = -170; lon < 180; lon+= 85){
+            geomag::Vector surface= geomag::geodetic2ecef(lat, lon, 0);
+            TPrecision r0= std::sqrt(surface.x*surface.x+surface.y*surface.y+surface.z*surface.z);
+            geomag::GeoMagProfile(lat, lon, heights.data(), count, coeffs, bx.data(), by.data(), bz.data());
+            for (size_t i = 0; i < count; i++){
+                TPrecision scale= (r0+heights[i])/r0;
+                geomag::Vector truth= geomag::GeoMag({surface.x*scale, surface.y*scale, surface.z*scale}, coeffs);
+                CHECK( bx[i]*1E9 == Approx(truth.x*1E9).margin(0.5) );
+                CHECK( by[i]*1E9 == Approx(truth.y*1E9).margin(0.5) );
+                CHECK( bz[i]*1E9 == Approx(truth.z*1E9).margin(0.5) );
+                radii[i]= r0+heights[i];
+            }
+            // the direction doesn't need to be a unit vector
+            geomag::GeoMagProfile({surface.x*3, surface.y*3, surface.z*3}, radii.data(), count, coeffs, bx.data(), by.data(), bz.data());
+            for (size_t i = 0; i < count; i++){
+                TPrecision scale= radii[i]/r0;
+                geomag::Vector truth= geomag::GeoMag({surface.x*scale, surface.y*scale, surface.z*scale}, coeffs);
+                CHECK( bx[i]*1E9 == Approx(truth.x*1E9).margin(0.5) );
+                CHECK( by[i]*1E9 == Approx(truth.y*1E9).margin(0.5) );
+                CHECK( bz[i]*1E9 == Approx(truth.z*1E9).margin(0.5) );
+            }
+        }
+    }
+}
+
+TEST_CASE( "parallel matches batch for any thread count", "[Parallel]" ) {
+    const size_t count= 10007;
+    std::vector<TPrecision> x, y, z;
+    randomPositions(count, 1111, x, y, z);
+    geomag::DerivativeCoeffs coeffs= geomag::derivativeCoeffs(geomag::snapshotModel(2022.5, geomag::WMM2020));
+    std::vector<TPrecision> bx(count), by(count), bz(count);
+    geomag::GeoMagBatch(x.data(), y.data(), z.data(), count, coeffs, bx.data(), by.data(), bz.data());
+    // chunks that are not a multiple of BATCH_BLOCK, more threads than cores, and more threads than chunks.
+    const unsigned threads[]= {0, 1, 3, 8, 300};
+    const size_t chunks[]= {1000, 100, 4096};
+    for (unsigned t : threads){
+        for (size_t c : chunks){
+            geomag::ParallelOptions options;
+            options.threads= t;
+            options.chunk= c;
+            std::vector<TPrecision> px(count), py(count), pz(count);
+            geomag::GeoMagParallel(x.data(), y.data(), z.data(), count, coeffs, px.data(), py.data(), pz.data(), options);
+            CHECK( px == bx );
+            CHECK( py == by );
+            CHECK( pz == bz );
+        }
+    }
+    std::vector<TPrecision> px(count), py(count), pz(count);
+    geomag::GeoMagParallel(2022.5, x.data(), y.data(), z.data(), count, geomag::WMM2020, px.data(), py.data(), pz.data());
+    CHECK( px == bx );
+    CHECK( py == by );
+    CHECK( pz == bz );
+}
+
+#if defined(XYZgeomag_HAVE_SIMD)
+TEST_CASE( "parallel with a SIMD kernel is independent of the thread count", "[Parallel]" ) {
+    // the SIMD batches send the tail of each call through the scalar GeoMag, so the chunks must not depend on the threads
+    const size_t count= 10007;
+    std::vector<TPrecision> x, y, z;
+    randomPositions(count, 1212, x, y, z);
+    geomag::DerivativeCoeffs coeffs= geomag::derivativeCoeffs(geomag::snapshotModel(2022.5, geomag::WMM2020));
+    std::vector<geomag::BatchKernel> kernels;
+    if (geomag::avx2::supported()){
+        kernels.push_back(geomag::avx2::GeoMagBatch);
+    }
+    if (geomag::avx512::supported()){
+        kernels.push_back(geomag::avx512::GeoMagBatch);
+    }
+    for (geomag::BatchKernel kernel : kernels){
+        for (size_t c : {100, 4096}){
+            geomag::ParallelOptions options;
+            options.kernel= kernel;
+            options.chunk= c;
+            options.threads= 1;
+            std::vector<TPrecision> bx(count), by(count), bz(count);
+            geomag::GeoMagParallel(x.data(), y.data(), z.data(), count, coeffs, bx.data(), by.data(), bz.data(), options);
+            for (unsigned t : {2u, 4u, 300u}){
+                options.threads= t;
+                std::vector<TPrecision> px(count), py(count), pz(count);
+                geomag::GeoMagParallel(x.data(), y.data(), z.data(), count, coeffs, px.data(), py.data(), pz.data(), options);
+                CHECK( px == bx );
+                CHECK( py == by );
+                CHECK( pz == bz );
+            }
+        }
+    }
+}
+#endif
+
+TEST_CASE( "snapshot matches scalar GeoMag", "[Snapshot]" ) {
+    const size_t count= 100;
+    std::vector<TPrecision> x, y, z;
+    randomPositions(count, 5678, x, y, z);
+    geomag::ModelSnapshot snapshot= geomag::snapshotModel(2017.5, geomag::WMM2015v2);
+    CHECK( snapshot.dyear == 2017.5 );
+    for (size_t i = 0; i < count; i++){
+        geomag::Vector out= geomag::GeoMag({x[i], y[i], z[i]}, snapshot);
+        geomag::Vector truth= geomag::GeoMag(2017.5, {x[i], y[i], z[i]}, geomag::WMM2015v2);
+        CHECK( out.x == truth.x );
+        CHECK( out.y == truth.y );
+        CHECK( out.z == truth.z );
+    }
+}
+
+
+TEST_CASE( "recurrence plan constants", "[Derivative]" ) {
+    const geomag::RecurrencePlan& plan= geomag::RECURRENCE_PLAN;
+    CHECK( plan.diag[1] == 1 );
+    CHECK( plan.diag[5] == 9 );
+    CHECK( plan.fcoef[geomag::termIndex(5,2)] == Approx(9.0/3.0) );
+    CHECK( plan.gcoef[geomag::termIndex(5,2)] == Approx(6.0/3.0) );
+    CHECK( plan.fcoef[geomag::termIndex(3,3)] == 0 );
+    CHECK( geomag::termIndex(geomag::NMAX+1,geomag::NMAX+1) == geomag::NUMTERMS-1 );
+    // the table written by wmmcodeupdate.py rounds the same as the divisions it replaces
+    for (int m = 0; m <= geomag::NMAX+1; m++){
+        CHECK( plan.diagAt(m) == 2*m-1 );
+        for (int n = m+1; n <= geomag::NMAX+1; n++){
+            CHECK( plan.fcoefAt(geomag::termIndex(n,m)) == ((TPrecision)(2*n-1))/((TPrecision)(n-m)) );
+            CHECK( plan.gcoefAt(geomag::termIndex(n,m)) == ((TPrecision)(n+m-1))/((TPrecision)(n-m)) );
+        }
+    }
+}
+
+TEST_CASE( "derivative coefficients match scalar GeoMag", "[Derivative]" ) {
+    const size_t count= 200;
+    std::vector<TPrecision> x, y, z;
+    randomPositions(count, 8765, x, y, z);
+    geomag::DerivativeCoeffs coeffs= geomag::derivativeCoeffs(geomag::snapshotModel(2022.5, geomag::WMM2020));
+    CHECK( coeffs.dyear == 2022.5 );
+    for (size_t i = 0; i < count; i++){
+        geomag::Vector out= geomag::GeoMag({x[i], y[i], z[i]}, coeffs);
+        geomag::Vector truth= geomag::GeoMag(2022.5, {x[i], y[i], z[i]}, geomag::WMM2020);
+        CHECK( out.x*1E9 == Approx(truth.x*1E9).margin(DERIVATIVE_MARGIN_NT) );
+        CHECK( out.y*1E9 == Approx(truth.y*1E9).margin(DERIVATIVE_MARGIN_NT) );
+        CHECK( out.z*1E9 == Approx(truth.z*1E9).margin(DERIVATIVE_MARGIN_NT) );
+    }
+}
+
+
+TEST_CASE( "several models share one recursion", "[Models]" ) {
+    const size_t count= 200;
+    std::vector<TPrecision> x, y, z;
+    randomPositions(count, 1919, x, y, z);
+    // more sets than MODEL_GROUP, so the last group is partly used
+    const int K= 7;
+    const geomag::ConstModel* models[3]= {&geomag::WMM2015, &geomag::WMM2015v2, &geomag::WMM2020};
+    const float epochs[3]= {2015.0f, 2015.0f, 2020.0f};
+    geomag::DerivativeCoeffs coeffs[K];
+    const geomag::DerivativeCoeffs* sets[K];
+    for (int k = 0; k < K; k++){
+        coeffs[k]= geomag::derivativeCoeffs(geomag::snapshotModel(epochs[k%3]+0.5f*k, *models[k%3]));
+        sets[k]= &coeffs[k];
+    }
+    CHECK( geomag::modelGroups(K) == 2 );
+    geomag::ModelGroupCoeffs groups[geomag::modelGroups(K)];
+    geomag::modelGroupCoeffs(sets, K, groups);
+    CHECK( groups[0].count == geomag::MODEL_GROUP );
+    CHECK( groups[1].count == K-geomag::MODEL_GROUP );
+    for (size_t i = 0; i < count; i++){
+        geomag::Vector position= {x[i], y[i], z[i]};
+        geomag::Vector fields[K+1];
+        fields[K]= {1, 2, 3};
+        geomag::GeoMagModels(position, groups, K, fields);
+        for (int k = 0; k < K; k++){
+            geomag::Vector truth= geomag::GeoMag(position, coeffs[k]);
+            CHECK( fields[k].x*1E9 == Approx(truth.x*1E9).margin(0.01) );
+            CHECK( fields[k].y*1E9 == Approx(truth.y*1E9).margin(0.01) );
+            CHECK( fields[k].z*1E9 == Approx(truth.z*1E9).margin(0.01) );
+        }
+        // nothing past the count is written
+        CHECK( fields[K].x == 1 );
+        CHECK( fields[K].z == 3 );
+    }
+}
+
+TEST_CASE( "stored basis matches scalar GeoMag for any coefficients", "[Basis]" ) {
+    const size_t count= 200;
+    std::vector<TPrecision> x, y, z;
+    randomPositions(count, 2020, x, y, z);
+    std::vector<geomag::SphericalBasis> bases(count);
+    for (size_t i = 0; i < count; i++){
+        bases[i]= geomag::sphericalBasis({x[i], y[i], z[i]});
+    }
+    std::vector<TPrecision> bx(count), by(count), bz(count);
+    for (float dyear : {2020.0f, 2022.5f, 2024.9f}){
+        geomag::ModelSnapshot snapshot= geomag::snapshotModel(dyear, geomag::WMM2020);
+        geomag::DerivativeCoeffs coeffs= geomag::derivativeCoeffs(snapshot);
+        geomag::applyBasis(bases.data(), count, coeffs, bx.data(), by.data(), bz.data());
+        for (size_t i = 0; i < count; i++){
+            geomag::Vector position= {x[i], y[i], z[i]};
+            geomag::Vector truth= geomag::GeoMag(position, coeffs);
+            CHECK( bx[i]*1E9 == Approx(truth.x*1E9).margin(0.01) );
+            CHECK( by[i]*1E9 == Approx(truth.y*1E9).margin(0.01) );
+            CHECK( bz[i]*1E9 == Approx(truth.z*1E9).margin(0.01) );
+            truth= geomag::GeoMag(dyear, position, geomag::WMM2020);
+            geomag::Vector field= geomag::applyBasis(bases[i], dyear, geomag::WMM2020);
+            CHECK( field.x*1E9 == Approx(truth.x*1E9).margin(0.5) );
+            CHECK( field.y*1E9 == Approx(truth.y*1E9).margin(0.5) );
+            CHECK( field.z*1E9 == Approx(truth.z*1E9).margin(0.5) );
+            field= geomag::applyBasis(bases[i], snapshot);
+            CHECK( field.x*1E9 == Approx(truth.x*1E9).margin(0.5) );
+            CHECK( field.y*1E9 == Approx(truth.y*1E9).margin(0.5) );
+            CHECK( field.z*1E9 == Approx(truth.z*1E9).margin(0.5) );
+        }
+    }
+}
+
+TEST_CASE( "ensemble members match GeoMag with perturbed coefficients", "[Ensemble]" ) {
+    const int members= 5;
+    std::mt19937 rng(22);
+    std::normal_distribution<double> noise(0.0, 20.0);
+    std::vector<TPrecision> rows(members*geomag::ENSEMBLE_COEFFS);
+    for (TPrecision& delta : rows){
+        delta= noise(rng);
+    }
+    geomag::PerturbationMatrix matrix= {rows.data(), members};
+    geomag::ModelSnapshot nominal= geomag::snapshotModel(2022.5, geomag::WMM2020);
+    std::vector<TPrecision> x, y, z;
+    randomPositions(50, 2222, x, y, z);
+    for (size_t i = 0; i < x.size(); i++){
+        geomag::Vector position= {x[i], y[i], z[i]};
+        geomag::Vector fields[members];
+        geomag::GeoMagEnsemble(position, nominal, matrix, fields);
+        for (int k = 0; k < members; k++){
+            geomag::ModelSnapshot perturbed= nominal;
+            for (int m = 0; m <= geomag::NMAX; m++){
+                for (int n = m; n <= geomag::NMAX; n++){
+                    // un Schmidt semi-normalize like wmmcodeupdate.py
+                    double unnorm= (m==0) ? 1 : std::sqrt(2*std::tgamma(n-m+1)/std::tgamma(n+m+1));
+                    int c= geomag::coeffIndex(n,m);
+                    perturbed.Coeff_C[c]+= unnorm*rows[k*geomag::ENSEMBLE_COEFFS+c];
+                    perturbed.Coeff_S[c]+= unnorm*rows[k*geomag::ENSEMBLE_COEFFS+geomag::NUMCOF+c];
+                }
+            }
+            geomag::Vector truth= geomag::GeoMag(position, perturbed);
+            CHECK( fields[k].x*1E9 == Approx(truth.x*1E9).margin(0.5) );
+            CHECK( fields[k].y*1E9 == Approx(truth.y*1E9).margin(0.5) );
+            CHECK( fields[k].z*1E9 == Approx(truth.z*1E9).margin(0.5) );
+        }
+    }
+}
+
+TEST_CASE( "ensemble statistics match the members", "[Ensemble]" ) {
+    const int members= 2000;
+    std::vector<TPrecision> sigma(geomag::ENSEMBLE_COEFFS, 0);
+    for (int n = 1; n <= 3; n++){
+        for (int m = 0; m <= n; m++){
+            sigma[geomag::coeffIndex(n,m)]= 10;
+            sigma[geomag::coeffIndex(n,m)+geomag::NUMCOF]= (m==0) ? 0 : 10;
+        }
+    }
+    geomag::GaussianPerturbations gaussian= {77, sigma.data(), members};
+    geomag::ConstModelAt nominal= {geomag::WMM2020, 2022.5f};
+    geomag::Vector position= geomag::geodetic2ecef(45, -120, 1000);
+    std::vector<geomag::Vector> fields(members), again(members);
+    geomag::GeoMagEnsemble(position, nominal, gaussian, fields.data());
+    // the same seed gives the same members
+    geomag::GeoMagEnsemble(position, nominal, gaussian, again.data());
+    for (int k = 0; k < members; k++){
+        CHECK( fields[k].x == again[k].x );
+        CHECK( fields[k].z == again[k].z );
+    }
+    double mean[3]= {0, 0, 0};
+    for (const geomag::Vector& field : fields){
+        mean[0]+= field.x/members;
+        mean[1]+= field.y/members;
+        mean[2]+= field.z/members;
+    }
+    double cov[3][3]= {};
+    for (const geomag::Vector& field : fields){
+        double d[3]= {field.x-mean[0], field.y-mean[1], field.z-mean[2]};
+        for (int k = 0; k < 3; k++){
+            for (int l = 0; l < 3; l++){
+                cov[k][l]+= d[k]*d[l]/(members-1);
+            }
+        }
+    }
+    geomag::EnsembleStats stats= geomag::GeoMagEnsembleStats(position, nominal, gaussian);
+    CHECK( stats.count == members );
+    CHECK( stats.mean.x*1E9 == Approx(mean[0]*1E9).margin(0.05) );
+    CHECK( stats.mean.y*1E9 == Approx(mean[1]*1E9).margin(0.05) );
+    CHECK( stats.mean.z*1E9 == Approx(mean[2]*1E9).margin(0.05) );
+    for (int k = 0; k < 3; k++){
+        for (int l = 0; l < 3; l++){
+            CHECK( geomag::ensembleCovariance(stats, k, l)*1E18 == Approx(cov[k][l]*1E18).epsilon(1E-3).margin(1E-2) );
+        }
+    }
+    // the mean is near the nominal field, and the spread is tens of nT
+    geomag::Vector center= geomag::GeoMag(2022.5, position, geomag::WMM2020);
+    CHECK( stats.mean.x*1E9 == Approx(center.x*1E9).margin(5) );
+    CHECK( stats.mean.z*1E9 == Approx(center.z*1E9).margin(5) );
+    CHECK( std::sqrt(geomag::ensembleCovariance(stats, 2, 2))*1E9 > 10 );
+    CHECK( std::sqrt(geomag::ensembleCovariance(stats, 2, 2))*1E9 < 200 );
+}
+
+TEST_CASE( "fused elements match the three step pipeline", "[Elements]" ) {
+    for (int lat = -89; lat <= 89; lat+= 8){
+        for (int lon = -180; lon < 180; lon+= 10){
+            for (TPrecision h : {-400.0f, 0.0f, 305.0f, 400E3f}){
+                geomag::Vector position = geomag::geodetic2ecef(lat, lon, h);
+                geomag::Vector mag_field = geomag::GeoMag(2022.5, position, geomag::WMM2020);
+                geomag::Elements truth = geomag::magField2Elements(mag_field, lat, lon);
+                geomag::Elements out = geomag::GeoMagElements(2022.5, lat, lon, h, geomag::WMM2020);
+                CHECK( out.north == Approx(truth.north).margin(0.1) );
+                CHECK( out.east == Approx(truth.east).margin(0.1) );
+                CHECK( out.down == Approx(truth.down).margin(0.1) );
+                CHECK( out.horizontal == Approx(truth.horizontal).margin(0.1) );
+                CHECK( out.total == Approx(truth.total).margin(0.1) );
+                CHECK( out.inclination == Approx(truth.inclination).margin(1E-4) );
+                CHECK( out.declination == Approx(truth.declination).margin(1E-4) );
+            }
+        }
+    }
+}
+
+TEST_CASE( "station matches scalar GeoMag at any time", "[Station]" ) {
+    const size_t count= 200;
+    std::vector<TPrecision> x, y, z;
+    randomPositions(count, 1616, x, y, z);
+    for (size_t i = 0; i < count; i++){
+        geomag::Vector position= {x[i], y[i], z[i]};
+        geomag::Station station= geomag::makeStation(position, geomag::WMM2020);
+        CHECK( station.epoch == 2020.0f );
+        for (float dyear : {2020.0f, 2021.37f, 2022.5f, 2024.99f}){
+            geomag::Vector out= station.field(dyear);
+            geomag::Vector truth= geomag::GeoMag(dyear, position, geomag::WMM2020);
+            CHECK( out.x*1E9 == Approx(truth.x*1E9).margin(0.05) );
+            CHECK( out.y*1E9 == Approx(truth.y*1E9).margin(0.05) );
+            CHECK( out.z*1E9 == Approx(truth.z*1E9).margin(0.05) );
+        }
+    }
+}
+
+TEST_CASE( "grid matches scalar GeoMag", "[Grid]" ) {
+    geomag::GeodeticGrid grid;
+    grid.lat0= -85;
+    grid.dlat= 10;
+    grid.nlat= 18;
+    grid.lon0= -180;
+    grid.dlon= 7.5;
+    grid.nlon= 48;
+    grid.h0= -400;
+    grid.dh= 250E3;
+    grid.nh= 3;
+    size_t size= geomag::gridSize(grid);
+    CHECK( size == 18*48*3 );
+    geomag::DerivativeCoeffs coeffs= geomag::derivativeCoeffs(geomag::snapshotModel(2022.5, geomag::WMM2020));
+    std::vector<TPrecision> x(size), y(size), z(size), north(size), east(size), down(size);
+    REQUIRE( geomag::GeoMagGrid(grid, coeffs, geomag::GRID_ITRS, x.data(), y.data(), z.data()) );
+    REQUIRE( geomag::GeoMagGrid(2022.5, grid, geomag::WMM2020, geomag::GRID_NED, north.data(), east.data(), down.data()) );
+    size_t i= 0;
+    for (int ih = 0; ih < grid.nh; ih++){
+        for (int ilat = 0; ilat < grid.nlat; ilat++){
+            for (int ilon = 0; ilon < grid.nlon; ilon++, i++){
+                TPrecision lat= grid.lat0+ilat*grid.dlat;
+                TPrecision lon= grid.lon0+ilon*grid.dlon;
+                TPrecision h= grid.h0+ih*grid.dh;
+                geomag::Vector truth= geomag::GeoMag(geomag::geodetic2ecef(lat, lon, h), coeffs);
+                geomag::Elements elements= geomag::magField2Elements(truth, lat, lon);
+                CHECK( x[i]*1E9 == Approx(truth.x*1E9).margin(0.5) );
+                CHECK( y[i]*1E9 == Approx(truth.y*1E9).margin(0.5) );
+                CHECK( z[i]*1E9 == Approx(truth.z*1E9).margin(0.5) );
+                CHECK( north[i] == Approx(elements.north).margin(0.5) );
+                CHECK( east[i] == Approx(elements.east).margin(0.5) );
+                CHECK( down[i] == Approx(elements.down).margin(0.5) );
+            }
+        }
+    }
+}
+
+TEST_CASE( "inverse DFT matches the direct sum", "[Grid]" ) {
+    // powers of 2 and 4, small and large primes, and 1.
+    const int lengths[]= {1, 2, 8, 12, 17, 30, 3600, 37*3, 5*7*11};
+    for (int n : lengths){
+        geomag::FourierPlan plan= geomag::makeFourierPlan(n);
+        std::vector<std::complex<TPrecision>> in(n), out(n);
+        for (int k = 0; k < n; k++){
+            in[k]= std::complex<TPrecision>(std::cos(1.3*k*k), std::sin(0.7*k));
+        }
+        std::vector<std::complex<TPrecision>> spectrum= in;
+        geomag::inverseDFT(plan, spectrum.data(), out.data());
+        for (int j = 0; j < n; j+= 1+n/50){
+            std::complex<double> sum= 0;
+            for (int k = 0; k < n; k++){
+                sum+= std::complex<double>(in[k].real(), in[k].imag())*std::polar(1.0, 2*M_PI*(double)j*k/n);
+            }
+            CHECK( out[j].real() == Approx(sum.real()).margin(1E-3*std::sqrt(n)) );
+            CHECK( out[j].imag() == Approx(sum.imag()).margin(1E-3*std::sqrt(n)) );
+        }
+    }
+}
+
+TEST_CASE( "global grid matches grid", "[Grid]" ) {
+    // includes a ring shorter than the number of orders, where frequencies alias.
+    const int nlons[]= {360, 7, 50};
+    for (int nlon : nlons){
+        geomag::GeodeticGrid grid;
+        grid.lat0= -89.5;
+        grid.dlat= 11;
+        grid.nlat= 17;
+        grid.lon0= -177.25;
+        grid.dlon= 360.0/nlon;
+        grid.nlon= nlon;
+        grid.h0= 0;
+        grid.dh= 800E3;
+        grid.nh= (nlon==7) ? 1 : 2;// an odd number of rows
+        size_t size= geomag::gridSize(grid);
+        geomag::DerivativeCoeffs coeffs= geomag::derivativeCoeffs(geomag::snapshotModel(2022.5, geomag::WMM2020));
+        for (geomag::GridFrame frame : {geomag::GRID_ITRS, geomag::GRID_NED}){
+            TPrecision scale= (frame==geomag::GRID_NED) ? 1 : 1E9;
+            std::vector<TPrecision> a0(size), a1(size), a2(size), b0(size), b1(size), b2(size);
+            REQUIRE( geomag::GeoMagGrid(grid, coeffs, frame, a0.data(), a1.data(), a2.data()) );
+            REQUIRE( geomag::GeoMagGlobalGrid(2022.5, grid, geomag::WMM2020, frame, b0.data(), b1.data(), b2.data()) );
+            for (size_t i = 0; i < size; i++){
+                CHECK( b0[i]*scale == Approx(a0[i]*scale).margin(0.5) );
+                CHECK( b1[i]*scale == Approx(a1[i]*scale).margin(0.5) );
+                CHECK( b2[i]*scale == Approx(a2[i]*scale).margin(0.5) );
+            }
+            // spot check points against GeoMag, so an error shared by both grids is caught
+            for (size_t i = 0; i < size; i+= 13){
+                int ilon= i%nlon;
+                int ilat= (i/nlon)%grid.nlat;
+                int ih= i/(nlon*grid.nlat);
+                TPrecision lat= grid.lat0+ilat*grid.dlat;
+                TPrecision lon= grid.lon0+ilon*360.0/nlon;
+                geomag::Vector truth= geomag::GeoMag(geomag::geodetic2ecef(lat, lon, grid.h0+ih*grid.dh), coeffs);
+                TPrecision t0= truth.x*1E9;
+                TPrecision t1= truth.y*1E9;
+                TPrecision t2= truth.z*1E9;
+                if (frame==geomag::GRID_NED){
+                    geomag::Elements elements= geomag::magField2Elements(truth, lat, lon);
+                    t0= elements.north;
+                    t1= elements.east;
+                    t2= elements.down;
+                }
+                CHECK( b0[i]*scale == Approx(t0).margin(0.5) );
+                CHECK( b1[i]*scale == Approx(t1).margin(0.5) );
+                CHECK( b2[i]*scale == Approx(t2).margin(0.5) );
+            }
+        }
+    }
+    // a grid without longitudes is rejected
+    geomag::GeodeticGrid empty= {0, 1, 1, 0, 1, 0, 0, 1, 1};
+    TPrecision unused= 7;
+    CHECK_FALSE( geomag::GeoMagGlobalGrid(2022.5, empty, geomag::WMM2020, geomag::GRID_ITRS, &unused, &unused, &unused) );
+    // and so are negative counts, by both grid kernels
+    geomag::GeodeticGrid negative[3]= {{0, 1, -1, 0, 1, 1, 0, 1, 1}, {0, 1, 1, 0, 1, -1, 0, 1, 1}, {0, 1, 1, 0, 1, 1, 0, 1, -1}};
+    for (const geomag::GeodeticGrid& bad : negative){
+        CHECK_FALSE( geomag::GeoMagGrid(2022.5, bad, geomag::WMM2020, geomag::GRID_ITRS, &unused, &unused, &unused) );
+        CHECK_FALSE( geomag::GeoMagGlobalGrid(2022.5, bad, geomag::WMM2020, geomag::GRID_ITRS, &unused, &unused, &unused) );
+    }
+    CHECK( unused == 7 );
+}
+
+TEST_CASE( "tiles interpolate within their error bound", "[Tiles]" ) {
+    const char* path= "geomag_kernels_test_tiles.bin";
+    geomag::TileHeader header;
+    REQUIRE( geomag::buildTiles(path, 2022.5, geomag::WMM2020, 0, 15000, 5, &header) );
+    CHECK( header.version == geomag::TILE_VERSION );
+    CHECK( header.max_error <= 5 );
+    geomag::TileMap tiles;
+    CHECK_FALSE( geomag::openTiles(path, header.max_error/2, tiles) );
+    REQUIRE( geomag::openTiles(path, 5, tiles) );
+    CHECK( tiles.header->dyear == 2022.5 );
+    geomag::DerivativeCoeffs coeffs= geomag::derivativeCoeffs(geomag::snapshotModel(2022.5, geomag::WMM2020));
+    std::mt19937 rng(2222);
+    std::uniform_real_distribution<double> lat(-90, 90);
+    std::uniform_real_distribution<double> lon(-360, 360);
+    std::uniform_real_distribution<double> height(0, 15000);
+    for (int i = 0; i < 2000; i++){
+        TPrecision la= lat(rng);
+        TPrecision lo= lon(rng);
+        TPrecision h= height(rng);
+        geomag::Vector field;
+        REQUIRE( geomag::tileField(tiles, la, lo, h, field) );
+        geomag::Vector truth= geomag::GeoMag(geomag::geodetic2ecef(la, lo, h), coeffs);
+        // the bound is measured at random points, so allow some more at others.
+        CHECK( field.x*1E9 == Approx(truth.x*1E9).margin(1.5*header.max_error) );
+        CHECK( field.y*1E9 == Approx(truth.y*1E9).margin(1.5*header.max_error) );
+        CHECK( field.z*1E9 == Approx(truth.z*1E9).margin(1.5*header.max_error) );
+    }
+    geomag::Vector field;
+    CHECK( geomag::tileField(tiles, 90, 0, 15000, field) );
+    CHECK( geomag::tileField(tiles, -90, 180, 0, field) );
+    CHECK_FALSE( geomag::tileField(tiles, 0, 0, 15001, field) );
+    // non-finite coordinates are rejected, and far longitudes wrap
+    const TPrecision nan= std::numeric_limits<TPrecision>::quiet_NaN();
+    const TPrecision inf= std::numeric_limits<TPrecision>::infinity();
+    CHECK_FALSE( geomag::tileField(tiles, nan, 0, 0, field) );
+    CHECK_FALSE( geomag::tileField(tiles, 0, nan, 0, field) );
+    CHECK_FALSE( geomag::tileField(tiles, 0, inf, 0, field) );
+    CHECK_FALSE( geomag::tileField(tiles, 0, 0, nan, field) );
+    geomag::Vector wrapped;
+    REQUIRE( geomag::tileField(tiles, 20, 30.5f, 0, field) );
+    REQUIRE( geomag::tileField(tiles, 20, 30.5f+3600, 0, wrapped) );
+    CHECK( wrapped.x*1E9 == Approx(field.x*1E9).margin(0.01) );
+    CHECK( wrapped.y*1E9 == Approx(field.y*1E9).margin(0.01) );
+    CHECK( wrapped.z*1E9 == Approx(field.z*1E9).margin(0.01) );
+    CHECK( geomag::tileField(tiles, 20, 1E30f, 0, wrapped) );
+    geomag::closeTiles(tiles);
+    CHECK( tiles.header == nullptr );
+
+    // a file of another version is rejected
+    FILE* file= fopen(path, "r+b");
+    REQUIRE( file );
+    uint32_t version= geomag::TILE_VERSION+1;
+    fseek(file, offsetof(geomag::TileHeader, version), SEEK_SET);
+    fwrite(&version, sizeof(version), 1, file);
+    fclose(file);
+    CHECK_FALSE( geomag::openTiles(path, 5, tiles) );
+    CHECK_FALSE( geomag::openTiles("no_such_file.bin", 5, tiles) );
+    remove(path);
+}
+
+TEST_CASE( "tile interpolation reads only nodes inside the data", "[Tiles]" ) {
+    geomag::TileHeader header= geomag::makeTileHeader(2022.5f, 0, 15000, 2, 10000);
+    geomag::DerivativeCoeffs coeffs= geomag::derivativeCoeffs(geomag::snapshotModel(2022.5, geomag::WMM2020));
+    std::vector<float> samples= geomag::sampleTiles(header, coeffs);
+    // a layer of NaN before and after the data, any read of it makes the field NaN even with zero weight
+    const size_t layer= (size_t)header.nlat*header.nlon*3;
+    std::vector<float> data(layer, std::numeric_limits<float>::quiet_NaN());
+    data.insert(data.end(), samples.begin(), samples.end());
+    data.resize(data.size()+layer, std::numeric_limits<float>::quiet_NaN());
+    const float* nodes= data.data()+layer;
+    const TPrecision corners[][3]= {{90, 0, 15000}, {-90, 180, 0}, {90, -180, 0}, {-90, 0, 15000}, {0, 0, 15000}, {0, 0, 0}};
+    for (const TPrecision* c : corners){
+        geomag::Vector field= geomag::interpolateTiles(header, nodes, c[0], c[1], c[2]);
+        REQUIRE( std::isfinite(field.x) );
+        REQUIRE( std::isfinite(field.y) );
+        REQUIRE( std::isfinite(field.z) );
+        geomag::Vector truth= geomag::GeoMag(geomag::geodetic2ecef(c[0], c[1], c[2]), coeffs);
+        CHECK( field.x*1E9 == Approx(truth.x*1E9).margin(100) );
+        CHECK( field.y*1E9 == Approx(truth.y*1E9).margin(100) );
+        CHECK( field.z*1E9 == Approx(truth.z*1E9).margin(100) );
+    }
+}
+
+TEST_CASE( "element table interpolates within its documented error", "[Table]" ) {
+    // at the table points only the quantization is left
+    for (int i = 0; i < geomag::TABLE_NLAT; i++){
+        for (int j = 0; j < geomag::TABLE_NLON; j++){
+            float la= -90+i*geomag::TABLE_RESOLUTION;
+            float lo= -180+j*geomag::TABLE_RESOLUTION;
+            geomag::TableElements out= geomag::GeoMagTable(la, lo, geomag::WMM2020_TABLE);
+            geomag::Elements truth= geomag::GeoMagElements(geomag::TABLE_DYEAR, la, lo, geomag::TABLE_HEIGHT, geomag::WMM2020);
+            CHECK( std::remainder(out.declination-truth.declination, 360.0f) == Approx(0).margin(0.01) );
+            CHECK( out.inclination == Approx(truth.inclination).margin(0.01) );
+            CHECK( out.total == Approx(truth.total).margin(geomag::TABLE_INTENSITY_UNIT) );
+        }
+    }
+    // the documented errors are bounds, so check them on a sweep halfway between the generator's samples,
+    // and at random points, including longitudes that wrap
+    const float step= 0.25f;
+    float decerr= 0;
+    float middecerr= 0;
+    float incerr= 0;
+    float toterr= 0;
+    auto measure= [&](float la, float lo){
+        geomag::TableElements out= geomag::GeoMagTable(la, lo, geomag::WMM2020_TABLE);
+        geomag::Elements truth= geomag::GeoMagElements(geomag::TABLE_DYEAR, la, lo, geomag::TABLE_HEIGHT, geomag::WMM2020);
+        if (truth.horizontal >= geomag::TABLE_MIN_HORIZONTAL){
+            float error= std::abs(std::remainder(out.declination-truth.declination, 360.0f));
+            decerr= std::max(decerr, error);
+            if (std::abs(la) <= geomag::TABLE_MID_LATITUDE){
+                middecerr= std::max(middecerr, error);
+            }
+        }
+        incerr= std::max(incerr, std::abs(out.inclination-(float)truth.inclination));
+        toterr= std::max(toterr, std::abs(out.total-(float)truth.total));
+        return out;
+    };
+    for (float la = -90+step/2; la < 90; la+= step){
+        for (float lo = -180+step/2; lo < 180; lo+= step){
+            measure(la, lo);
+        }
+    }
+    std::mt19937 rng(1313);
+    std::uniform_real_distribution<float> lat(-90, 90);
+    std::uniform_real_distribution<float> lon(-540, 540);
+    for (int i = 0; i < 5000; i++){
+        geomag::TableElements out= measure(lat(rng), lon(rng));
+        CHECK( out.declination >= -180 );
+        CHECK( out.declination <= 180 );
+    }
+    CHECK( decerr <= geomag::TABLE_DECLINATION_ERROR );
+    CHECK( middecerr <= geomag::TABLE_MID_LATITUDE_DECLINATION_ERROR );
+    CHECK( incerr <= geomag::TABLE_INCLINATION_ERROR );
+    CHECK( toterr <= geomag::TABLE_TOTAL_ERROR );
+}
+
+TEST_CASE( "cache returns GeoMag at the nearest grid point", "[Cache]" ) {
+    const size_t count= 1000;
+    std::vector<TPrecision> x, y, z;
+    randomPositions(count, 1414, x, y, z);
+    geomag::FieldCache cache(1<<20, 100, 0.01f);
+    CHECK( cache.entries.size()*sizeof(geomag::CacheEntry) <= (1<<20) );
+    for (int pass = 0; pass < 2; pass++){
+        for (size_t i = 0; i < count; i++){
+            geomag::Vector position= {x[i], y[i], z[i]};
+            geomag::Vector out= geomag::GeoMagCached(cache, 2022.503f, position, geomag::WMM2020);
+            geomag::CacheKey key= geomag::cacheKey(cache, 2022.503f, position);
+            geomag::Vector grid_point= {key.x*cache.resolution, key.y*cache.resolution, key.z*cache.resolution};
+            geomag::Vector truth= geomag::GeoMag(key.t*cache.dyear_resolution, grid_point, geomag::WMM2020);
+            CHECK( out.x == truth.x );
+            CHECK( out.y == truth.y );
+            CHECK( out.z == truth.z );
+            geomag::Vector exact= geomag::GeoMag(2022.503f, position, geomag::WMM2020);
+            CHECK( out.x*1E9 == Approx(exact.x*1E9).margin(5) );
+            CHECK( out.y*1E9 == Approx(exact.y*1E9).margin(5) );
+            CHECK( out.z*1E9 == Approx(exact.z*1E9).margin(5) );
+        }
+    }
+    CHECK( cache.misses == count );
+    CHECK( cache.hits == count );
+    // nearby positions and times share an entry
+    geomag::Vector position= {x[0]+10, y[0]-10, z[0]+10};
+    geomag::GeoMagCached(cache, 2022.501f, position, geomag::WMM2020);
+    CHECK( cache.hits == count+1 );
+    geomag::clearCache(cache);
+    CHECK( cache.hits == 0 );
+    CHECK( cache.misses == 0 );
+
+    // with one set, the least recently used entry is evicted
+    geomag::FieldCache small(0, 100, 0.01f);
+    REQUIRE( small.entries.size() == geomag::CACHE_WAYS );
+    auto lookup= [&](int i){
+        geomag::GeoMagCached(small, 2022.5f, {x[i], y[i], z[i]}, geomag::WMM2020);
+    };
+    for (int i = 0; i < 4; i++){
+        lookup(i);
+    }
+    lookup(0);
+    lookup(4);// evicts 1
+    CHECK( small.hits == 1 );
+    CHECK( small.misses == 5 );
+    lookup(0);
+    lookup(2);
+    lookup(1);// evicts 3
+    CHECK( small.hits == 3 );
+    CHECK( small.misses == 6 );
+    lookup(4);
+    lookup(3);
+    CHECK( small.hits == 4 );
+    CHECK( small.misses == 7 );
+}
+
+TEST_CASE( "concurrent cache returns GeoMag at the nearest grid point", "[Cache]" ) {
+    const size_t count= 500;
+    std::vector<TPrecision> x, y, z;
+    randomPositions(count, 1515, x, y, z);
+    std::vector<geomag::Vector> truth(count);
+    geomag::FieldCache reference(0, 100, 0.01f);
+    for (size_t i = 0; i < count; i++){
+        truth[i]= geomag::GeoMagCached(reference, 2022.5f, {x[i], y[i], z[i]}, geomag::WMM2020);
+    }
+    geomag::ConcurrentFieldCache cache(1<<20, 100, 0.01f, 10);
+    CHECK( cache.shards.size() == 16 );
+    // each shard's counters fill their own cache line
+    CHECK( (uintptr_t)cache.shards.data() % geomag::CACHE_LINE == 0 );
+    CHECK( cache.slots.size()*sizeof(geomag::CacheSlot) <= (1<<20) );
+    for (int pass = 0; pass < 2; pass++){
+        for (size_t i = 0; i < count; i++){
+            geomag::Vector out= geomag::GeoMagCached(cache, 2022.5f, {x[i], y[i], z[i]}, geomag::WMM2020);
+            CHECK( out.x == truth[i].x );
+            CHECK( out.y == truth[i].y );
+            CHECK( out.z == truth[i].z );
+        }
+    }
+    geomag::CacheStats stats= geomag::cacheStats(cache);
+    CHECK( stats.hits+stats.misses == 2*count );
+    CHECK( stats.skipped == 0 );
+    CHECK( stats.hits == count );
+    uint64_t shardhits= 0;
+    for (size_t s = 0; s < cache.shards.size(); s++){
+        shardhits+= geomag::shardStats(cache, s).hits;
+    }
+    CHECK( shardhits == stats.hits );
+    geomag::clearCache(cache);
+    CHECK( geomag::cacheStats(cache).hits == 0 );
+
+    // a small cache shared by threads never returns a torn entry
+    geomag::ConcurrentFieldCache small(64*sizeof(geomag::CacheSlot), 100, 0.01f, 4);
+    std::vector<std::thread> threads;
+    std::atomic<int> wrong(0);
+    for (int t = 0; t < 4; t++){
+        threads.emplace_back([&, t](){
+            for (size_t k = 0; k < 20000; k++){
+                size_t i= (k*(2*t+1)+t)%count;
+                geomag::Vector out= geomag::GeoMagCached(small, 2022.5f, {x[i], y[i], z[i]}, geomag::WMM2020);
+                if (out.x!=truth[i].x || out.y!=truth[i].y || out.z!=truth[i].z){
+                    wrong++;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads){
+        thread.join();
+    }
+    CHECK( wrong == 0 );
+    stats= geomag::cacheStats(small);
+    CHECK( stats.hits+stats.misses == 80000 );
+}
+
+TEST_CASE( "degree truncated GeoMag", "[Degree]" ) {
+    const size_t count= 200;
+    std::vector<TPrecision> x, y, z;
+    randomPositions(count, 2468, x, y, z);
+    geomag::ModelSnapshot snapshot= geomag::snapshotModel(2022.5, geomag::WMM2020);
+    geomag::DerivativeCoeffs coeffs= geomag::derivativeCoeffs(snapshot);
+    for (size_t i = 0; i < count; i++){
+        geomag::Vector pos= {x[i], y[i], z[i]};
+        geomag::Vector truth= geomag::GeoMag(2022.5, pos, geomag::WMM2020);
+        geomag::Vector full= geomag::GeoMag<geomag::NMAX>(2022.5, pos, geomag::WMM2020);
+        CHECK( full.x == truth.x );
+        CHECK( full.y == truth.y );
+        CHECK( full.z == truth.z );
+        geomag::Vector full_coeffs= geomag::GeoMag<geomag::NMAX>(pos, coeffs);
+        geomag::Vector truth_coeffs= geomag::GeoMag(pos, coeffs);
+        CHECK( full_coeffs.x == truth_coeffs.x );
+        CHECK( full_coeffs.y == truth_coeffs.y );
+        CHECK( full_coeffs.z == truth_coeffs.z );
+        geomag::Vector coarse= geomag::GeoMag<6>(pos, coeffs);
+        geomag::Vector coarse_snapshot= geomag::GeoMag<6>(pos, snapshot);
+        CHECK( coarse_snapshot.x*1E9 == Approx(coarse.x*1E9).margin(0.5) );
+        CHECK( coarse_snapshot.y*1E9 == Approx(coarse.y*1E9).margin(0.5) );
+        CHECK( coarse_snapshot.z*1E9 == Approx(coarse.z*1E9).margin(0.5) );
+    }
+    // the README error table, on the surface.
+    for (int lat = -90; lat <= 90; lat+= 15){
+        for (int lon = -180; lon < 180; lon+= 15){
+            geomag::Vector pos= geomag::geodetic2ecef(lat, lon, 0);
+            geomag::Vector truth= geomag::GeoMag(pos, coeffs);
+            geomag::Vector coarse= geomag::GeoMag<6>(pos, coeffs);
+            TPrecision dx= (coarse.x-truth.x)*1E9f;
+            TPrecision dy= (coarse.y-truth.y)*1E9f;
+            TPrecision dz= (coarse.z-truth.z)*1E9f;
+            CHECK( std::sqrt(dx*dx+dy*dy+dz*dz) < 1214 );
+        }
+    }
+}
+
+
+TEST_CASE( "adaptive truncation stays within tolerance", "[Degree]" ) {
+    geomag::ModelSnapshot snapshot= geomag::snapshotModel(2022.5, geomag::WMM2020);
+    geomag::DerivativeCoeffs coeffs= geomag::derivativeCoeffs(snapshot);
+    geomag::TruncationBounds bounds= geomag::truncationBounds(snapshot);
+    CHECK( bounds.dyear == 2022.5 );
+    std::mt19937 rng(1357);
+    std::normal_distribution<double> dir(0.0, 1.0);
+    std::uniform_real_distribution<double> height(0, 2E6);
+    const TPrecision tolerances[]= {1, 10, 100, 1000};
+    for (int i = 0; i < 500; i++){
+        double u= dir(rng);
+        double v= dir(rng);
+        double w= dir(rng);
+        double r= (geomag::EARTH_R+height(rng))/std::sqrt(u*u+v*v+w*w);
+        geomag::Vector pos= {(TPrecision)(u*r), (TPrecision)(v*r), (TPrecision)(w*r)};
+        geomag::Vector truth= geomag::GeoMag(pos, coeffs);
+        for (TPrecision tolerance : tolerances){
+            geomag::AdaptiveField out= geomag::GeoMagAdaptive(pos, coeffs, bounds, tolerance);
+            REQUIRE( out.degree >= 1 );
+            REQUIRE( out.degree <= geomag::NMAX );
+            TPrecision dx= (out.field.x-truth.x)*1E9f;
+            TPrecision dy= (out.field.y-truth.y)*1E9f;
+            TPrecision dz= (out.field.z-truth.z)*1E9f;
+            // plus rounding error
+            CHECK( std::sqrt(dx*dx+dy*dy+dz*dz) <= tolerance+0.5f );
+        }
+    }
+    // at 2000 km a 100 nT tolerance should need much less than the full model.
+    geomag::Vector high= {geomag::EARTH_R+2E6f, 0, 0};
+    CHECK( geomag::GeoMagAdaptive(high, coeffs, bounds, 100).degree <= 7 );
+    CHECK( geomag::GeoMagAdaptive(high, coeffs, bounds, 0).degree == geomag::NMAX );
+}
+
+
+TEST_CASE( "gradient field matches scalar GeoMag", "[Gradient]" ) {
+    const size_t count= 200;
+    std::vector<TPrecision> x, y, z;
+    randomPositions(count, 9753, x, y, z);
+    geomag::ModelSnapshot snapshot= geomag::snapshotModel(2022.5, geomag::WMM2020);
+    geomag::DerivativeCoeffs coeffs= geomag::derivativeCoeffs(snapshot);
+    geomag::GradientCoeffs gradcoeffs= geomag::gradientCoeffs(snapshot);
+    CHECK( gradcoeffs.dyear == 2022.5 );
+    for (size_t i = 0; i < count; i++){
+        geomag::Vector pos= {x[i], y[i], z[i]};
+        geomag::Vector truth= geomag::GeoMag(pos, coeffs);
+        geomag::FieldGradient out= geomag::GeoMagGradient(pos, gradcoeffs);
+        CHECK( out.field.x*1E9 == Approx(truth.x*1E9).margin(0.5) );
+        CHECK( out.field.y*1E9 == Approx(truth.y*1E9).margin(0.5) );
+        CHECK( out.field.z*1E9 == Approx(truth.z*1E9).margin(0.5) );
+    }
+}
+
+#if defined(XYZgeomag_DOUBLE_PRECISION)
+TEST_CASE( "gradient matches central differences", "[Gradient]" ) {
+    const size_t count= 200;
+    const double step= 10.0;//m
+    std::vector<TPrecision> x, y, z;
+    randomPositions(count, 3579, x, y, z);
+    geomag::ModelSnapshot snapshot= geomag::snapshotModel(2022.5, geomag::WMM2020);
+    geomag::DerivativeCoeffs coeffs= geomag::derivativeCoeffs(snapshot);
+    geomag::GradientCoeffs gradcoeffs= geomag::gradientCoeffs(snapshot);
+    // one step along axis j
+    const geomag::Vector offsets[3]= {{step, 0, 0}, {0, step, 0}, {0, 0, step}};
+    for (size_t i = 0; i < count; i++){
+        geomag::Vector pos= {x[i], y[i], z[i]};
+        geomag::FieldGradient out= geomag::GeoMagGradient(pos, gradcoeffs);
+        for (int j = 0; j < 3; j++){
+            const geomag::Vector& d= offsets[j];
+            geomag::Vector plus= {pos.x+d.x, pos.y+d.y, pos.z+d.z};
+            geomag::Vector minus= {pos.x-d.x, pos.y-d.y, pos.z-d.z};
+            geomag::Vector bplus= geomag::GeoMag(plus, coeffs);
+            geomag::Vector bminus= geomag::GeoMag(minus, coeffs);
+            // units nT/km
+            CHECK( out.gradient[0][j]*1E12 == Approx((bplus.x-bminus.x)/(2*step)*1E12).margin(1E-6) );
+            CHECK( out.gradient[1][j]*1E12 == Approx((bplus.y-bminus.y)/(2*step)*1E12).margin(1E-6) );
+            CHECK( out.gradient[2][j]*1E12 == Approx((bplus.z-bminus.z)/(2*step)*1E12).margin(1E-6) );
+        }
+    }
+}
+#endif
+
+
+#if defined(XYZgeomag_HAVE_SIMD)
+/** Check a SIMD batch kernel against the scalar GeoMag to within the 0.5 nT error budget of the README.*/
+static void checkSimdKernel(void (*kernel)(float, const TPrecision*, const TPrecision*, const TPrecision*, size_t, const geomag::ConstModel&, TPrecision*, TPrecision*, TPrecision*)){
+    // not a multiple of the lane count or BATCH_BLOCK, to cover the scalar tail.
+    const size_t count= 1000+13;
+    std::vector<TPrecision> x, y, z;
+    randomPositions(count, 4321, x, y, z);
+    std::vector<TPrecision> bx(count), by(count), bz(count);
+    kernel(2022.5, x.data(), y.data(), z.data(), count, geomag::WMM2020, bx.data(), by.data(), bz.data());
+    for (size_t i = 0; i < count; i++){
+        geomag::Vector truth= geomag::GeoMag(2022.5, {x[i], y[i], z[i]}, geomag::WMM2020);
+        CHECK( bx[i]*1E9 == Approx(truth.x*1E9).margin(0.5) );
+        CHECK( by[i]*1E9 == Approx(truth.y*1E9).margin(0.5) );
+        CHECK( bz[i]*1E9 == Approx(truth.z*1E9).margin(0.5) );
+    }
+}
+
+/** Check a SIMD single point columns kernel against the scalar GeoMag.*/
+template <class Columns>
+static void checkSimdColumns(Columns (*pack)(const geomag::DerivativeCoeffs&), geomag::Vector (*kernel)(geomag::Vector, const Columns&)){
+    const size_t count= 300;
+    std::vector<TPrecision> x, y, z;
+    randomPositions(count, 4343, x, y, z);
+    geomag::DerivativeCoeffs coeffs= geomag::derivativeCoeffs(geomag::snapshotModel(2022.5, geomag::WMM2020));
+    static Columns columns;
+    columns= pack(coeffs);
+    for (size_t i = 0; i < count; i++){
+        geomag::Vector truth= geomag::GeoMag({x[i], y[i], z[i]}, coeffs);
+        geomag::Vector out= kernel({x[i], y[i], z[i]}, columns);
+        CHECK( out.x*1E9 == Approx(truth.x*1E9).margin(0.5) );
+        CHECK( out.y*1E9 == Approx(truth.y*1E9).margin(0.5) );
+        CHECK( out.z*1E9 == Approx(truth.z*1E9).margin(0.5) );
+    }
+}
+
+TEST_CASE( "sse batch matches scalar GeoMag", "[SIMD]" ) {
+    if (!geomag::sse::supported()){
+        WARN("sse not supported, skipping");
+        return;
+    }
+    checkSimdKernel(geomag::sse::GeoMagBatch);
+    checkSimdKernel(geomag::sse::GeoMagGemm);
+}
+
+TEST_CASE( "sse columns match scalar GeoMag", "[SIMD]" ) {
+    if (!geomag::sse::supported()){
+        WARN("sse not supported, skipping");
+        return;
+    }
+    checkSimdColumns(geomag::sse::columnCoeffs, geomag::sse::GeoMagColumns);
+}
+
+TEST_CASE( "avx2 batch matches scalar GeoMag", "[SIMD]" ) {
+    if (!geomag::avx2::supported()){
+        WARN("avx2 not supported, skipping");
+        return;
+    }
+    checkSimdKernel(geomag::avx2::GeoMagBatch);
+    checkSimdKernel(geomag::avx2::GeoMagGemm);
+}
+
+TEST_CASE( "avx2 columns match scalar GeoMag", "[SIMD]" ) {
+    if (!geomag::avx2::supported()){
+        WARN("avx2 not supported, skipping");
+        return;
+    }
+    checkSimdColumns(geomag::avx2::columnCoeffs, geomag::avx2::GeoMagColumns);
+}
+
+TEST_CASE( "avx512 batch matches scalar GeoMag", "[SIMD]" ) {
+    if (!geomag::avx512::supported()){
+        WARN("avx512 not supported, skipping");
+        return;
+    }
+    checkSimdKernel(geomag::avx512::GeoMagBatch);
+    checkSimdKernel(geomag::avx512::GeoMagGemm);
+}
+
+TEST_CASE( "avx512 columns match scalar GeoMag", "[SIMD]" ) {
+    if (!geomag::avx512::supported()){
+        WARN("avx512 not supported, skipping");
+        return;
+    }
+    checkSimdColumns(geomag::avx512::columnCoeffs, geomag::avx512::GeoMagColumns);
+}
+#endif
@@ -0,0 +1,56 @@
+// Benchmark of the latency of one field evaluation, geomag::GeoMag against geomag::GeoMagColumns.
+// Each position depends on the field at the previous one, so the evaluations can not overlap.
+// Compile for example with the command
+// g++ geomag_latency_bench.cpp -std=c++14 -O2 -DXYZgeomag_SINGLE_PRECISION
+#include <stdio.h>
+#include <chrono>
+#include "../src/XYZgeomag_columns.hpp"
+#include "../src/XYZgeomag_simd.hpp"
+
+const int CHAIN= 20000;//evaluations per timed chain
+const int REPEATS= 9;//the fastest chain is reported
+
+/** Return the fastest time per evaluation of a chain of dependent evaluations, units ns.*/
+template <class Kernel>
+double latency(Kernel kernel){
+    geomag::Vector start= geomag::geodetic2ecef(30, 40, 1000);
+    double best= 1E30;
+    TPrecision sum= 0;
+    for (int r = 0; r < REPEATS; r++){
+        geomag::Vector position= start;
+        auto begin= std::chrono::steady_clock::now();
+        for (int i = 0; i < CHAIN; i++){
+            geomag::Vector field= kernel(position);
+            // moves the position by less than a meter
+            position.x= start.x+field.x*1000;
+        }
+        double ns= std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count()*1E9/CHAIN;
+        best= (ns < best) ? ns : best;
+        sum+= position.x;
+    }
+    if (sum == 0){
+        printf("unexpected zero\n");
+    }
+    return best;
+}
+
+int main(){
+    geomag::DerivativeCoeffs coeffs= geomag::derivativeCoeffs(geomag::snapshotModel(2022.5, geomag::WMM2020));
+    static geomag::ColumnCoeffs<4> columns4= geomag::columnCoeffs<4>(coeffs);
+    static geomag::ColumnCoeffs<8> columns8= geomag::columnCoeffs<8>(coeffs);
+    printf("kernel, ns per dependent evaluation\n");
+    printf("GeoMag, %.1f\n", latency([&](geomag::Vector p){return geomag::GeoMag(p, coeffs);}));
+    printf("GeoMagColumns<4>, %.1f\n", latency([&](geomag::Vector p){return geomag::GeoMagColumns(p, columns4);}));
+    printf("GeoMagColumns<8>, %.1f\n", latency([&](geomag::Vector p){return geomag::GeoMagColumns(p, columns8);}));
+#if defined(XYZgeomag_HAVE_SIMD)
+    if (geomag::avx2::supported()){
+        static geomag::avx2::Columns columns= geomag::avx2::columnCoeffs(coeffs);
+        printf("avx2::GeoMagColumns, %.1f\n", latency([&](geomag::Vector p){return geomag::avx2::GeoMagColumns(p, columns);}));
+    }
+    if (geomag::avx512::supported()){
+        static geomag::avx512::Columns columns= geomag::avx512::columnCoeffs(coeffs);
+        printf("avx512::GeoMagColumns, %.1f\n", latency([&](geomag::Vector p){return geomag::avx512::GeoMagColumns(p, columns);}));
+    }
+#endif
+    return 0;
+}
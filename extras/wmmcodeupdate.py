@@ -134,6 +134,15 @@ Modifications are:
 #ifndef GEOMAG_HPP
 #define GEOMAG_HPP
 
+/* Selects the floating-point precision to use. */
+#if defined(XYZgeomag_DOUBLE_PRECISION)
+  typedef double TPrecision;
+#elif defined(XYZgeomag_SINGLE_PRECISION)
+  typedef float TPrecision;
+#else
+  #error "Define the floating-point precision using either XYZgeomag_DOUBLE_PRECISION or XYZgeomag_SINGLE_PRECISION"
+#endif
+
 #include <math.h>
 
 namespace geomag
@@ -142,12 +151,12 @@ constexpr int NMAX= %d;//order of the Model
 constexpr int NUMCOF= (NMAX+1)*(NMAX+2)/2;//number of coefficents
 struct ConstModel{
     float epoch;//decimal year
-    float Main_Field_Coeff_C[NUMCOF];
-    float Main_Field_Coeff_S[NUMCOF];
-    float Secular_Var_Coeff_C[NUMCOF];
-    float Secular_Var_Coeff_S[NUMCOF];
+    TPrecision Main_Field_Coeff_C[NUMCOF];
+    TPrecision Main_Field_Coeff_S[NUMCOF];
+    TPrecision Secular_Var_Coeff_C[NUMCOF];
+    TPrecision Secular_Var_Coeff_S[NUMCOF];
     /** Function for indexing the C spherical component n,m at dyear time.*/
-    inline float C(int n, int m, float dyear) const{
+    inline TPrecision C(int n, int m, float dyear) const{
       int index= (m*(2*NMAX-m+1))/2+n;
       #ifdef PROGMEM
         return pgm_read_float_near(Main_Field_Coeff_C+index)+(dyear-epoch)*pgm_read_float_near(Secular_Var_Coeff_C+index);
@@ -155,7 +164,7 @@ struct ConstModel{
       return Main_Field_Coeff_C[index]+(dyear-epoch)*Secular_Var_Coeff_C[index];
     }
     /** Function for indexing the S spherical component n,m at dyear time.*/
-    inline float S(int n, int m, float dyear) const{
+    inline TPrecision S(int n, int m, float dyear) const{
       int index= (m*(2*NMAX-m+1))/2+n;
       #ifdef PROGMEM
         return pgm_read_float_near(Main_Field_Coeff_S+index)+(dyear-epoch)*pgm_read_float_near(Secular_Var_Coeff_S+index);
@@ -163,30 +172,233 @@ struct ConstModel{
       return Main_Field_Coeff_S[index]+(dyear-epoch)*Secular_Var_Coeff_S[index];
     }
 };
+/** The coefficients of a ConstModel resolved at one time, made by snapshotModel.
+Uses 2*NUMCOF numbers of ram, but removes the secular variation math from GeoMag.*/
+struct ModelSnapshot{
+    float dyear;//decimal year the coefficients are resolved at
+    TPrecision Coeff_C[NUMCOF];
+    TPrecision Coeff_S[NUMCOF];
+    /** Function for indexing the C spherical component n,m.*/
+    inline TPrecision C(int n, int m) const{
+      return Coeff_C[(m*(2*NMAX-m+1))/2+n];
+    }
+    /** Function for indexing the S spherical component n,m.*/
+    inline TPrecision S(int n, int m) const{
+      return Coeff_S[(m*(2*NMAX-m+1))/2+n];
+    }
+};
+
+/** Return the coefficients of WMM resolved at dyear.
+ INPUT:
+    dyear(should be around the epoch of the model): The decimal year, for example 2015.0
+    WMM(): Magnetic field model to use.
+ */
+inline ModelSnapshot snapshotModel(float dyear, const ConstModel& WMM){
+    ModelSnapshot snapshot;
+    snapshot.dyear= dyear;
+    for (int m = 0; m <= NMAX; m++){
+        for (int n = m; n <= NMAX; n++){
+            int index= (m*(2*NMAX-m+1))/2+n;
+            snapshot.Coeff_C[index]= WMM.C(n,m,dyear);
+            snapshot.Coeff_S[index]= WMM.S(n,m,dyear);
+        }
+    }
+    return snapshot;
+}
+
+/** A ConstModel at dyear, with the same C(n,m), S(n,m) interface as ModelSnapshot.*/
+struct ConstModelAt{
+    const ConstModel& WMM;
+    float dyear;
+    inline TPrecision C(int n, int m) const{
+      return WMM.C(n,m,dyear);
+    }
+    inline TPrecision S(int n, int m) const{
+      return WMM.S(n,m,dyear);
+    }
+};
+/** The secular variation of a ConstModel, units nT per year, with the same C(n,m), S(n,m) interface as ModelSnapshot.*/
+struct ConstModelSecular{
+    const ConstModel& WMM;
+    inline TPrecision C(int n, int m) const{
+      int index= (m*(2*NMAX-m+1))/2+n;
+      #ifdef PROGMEM
+        return pgm_read_float_near(WMM.Secular_Var_Coeff_C+index);
+      #endif /* PROGMEM */
+      return WMM.Secular_Var_Coeff_C[index];
+    }
+    inline TPrecision S(int n, int m) const{
+      int index= (m*(2*NMAX-m+1))/2+n;
+      #ifdef PROGMEM
+        return pgm_read_float_near(WMM.Secular_Var_Coeff_S+index);
+      #endif /* PROGMEM */
+      return WMM.Secular_Var_Coeff_S[index];
+    }
+};
+constexpr int NUMTERMS= (NMAX+2)*(NMAX+3)/2;//number of V,W terms, degree 0 to NMAX+1
+/** Index of the V,W term n,m, terms are stored by m then n, in the same order GeoMag visits them.*/
+constexpr int termIndex(int n, int m){
+    return (m*(2*(NMAX+1)-m+1))/2+n;
+}
+
+/** The constants of the V/W recursion, so GeoMag doesn't need integer math or divisions.
+    V(m,m)= diag[m]*(a*V(m-1,m-1)-b*W(m-1,m-1))
+    V(n,m)= fcoef[termIndex(n,m)]*f*V(n-1,m) - gcoef[termIndex(n,m)]*g*V(n-2,m)
+and the same for W.*/
+struct RecurrencePlan{
+    TPrecision diag[NMAX+2];// (2m-1)
+    TPrecision fcoef[NUMTERMS];// (2n-1)/(n-m), 0 for n==m
+    TPrecision gcoef[NUMTERMS];// (n+m-1)/(n-m), 0 for n==m
+    /** Functions for reading the constants, which may be in PROGMEM.*/
+    inline TPrecision diagAt(int m) const{
+      #ifdef PROGMEM
+        return pgm_read_float_near(diag+m);
+      #endif /* PROGMEM */
+      return diag[m];
+    }
+    inline TPrecision fcoefAt(int index) const{
+      #ifdef PROGMEM
+        return pgm_read_float_near(fcoef+index);
+      #endif /* PROGMEM */
+      return fcoef[index];
+    }
+    inline TPrecision gcoefAt(int index) const{
+      #ifdef PROGMEM
+        return pgm_read_float_near(gcoef+index);
+      #endif /* PROGMEM */
+      return gcoef[index];
+    }
+};
+
+%s
+/** The coefficients of each V,W term in the three field components, made by derivativeCoeffs.
+The integer factors of the derivatives, the sign, and the conversion from nT to T are folded in,
+so the field is just the sum over the terms of
+    x: XV*V+XW*W, y: YV*V+YW*W, z: ZV*V+ZW*W
+Uses 6*NUMTERMS numbers of ram.*/
+struct DerivativeCoeffs{
+    float dyear;//decimal year the coefficients are resolved at
+    TPrecision XV[NUMTERMS];
+    TPrecision XW[NUMTERMS];
+    TPrecision YV[NUMTERMS];
+    TPrecision YW[NUMTERMS];
+    TPrecision ZV[NUMTERMS];
+    TPrecision ZW[NUMTERMS];
+};
+
+/** Return the derivative coefficients of a snapshot.*/
+inline DerivativeCoeffs derivativeCoeffs(const ModelSnapshot& snapshot){
+    DerivativeCoeffs coeffs;
+    coeffs.dyear= snapshot.dyear;
+    for (int m = 0; m <= NMAX+1; m++){
+        for (int n = m; n <= NMAX+1; n++){
+            TPrecision xv= 0;
+            TPrecision xw= 0;
+            TPrecision yv= 0;
+            TPrecision yw= 0;
+            TPrecision zv= 0;
+            TPrecision zw= 0;
+            if (m<NMAX && n>=m+2){
+                TPrecision k= 0.5f*(n-m)*(n-m-1);
+                xv+= k*snapshot.C(n-1,m+1);
+                xw+= k*snapshot.S(n-1,m+1);
+                yv+= k*snapshot.S(n-1,m+1);
+                yw+= -k*snapshot.C(n-1,m+1);
+            }
+            if (n>=2 && m>=2){
+                xv+= -0.5f*snapshot.C(n-1,m-1);
+                xw+= -0.5f*snapshot.S(n-1,m-1);
+                yv+= 0.5f*snapshot.S(n-1,m-1);
+                yw+= -0.5f*snapshot.C(n-1,m-1);
+            }
+            if (m==1 && n>=2){
+                xv+= -snapshot.C(n-1,0);
+                yw+= -snapshot.C(n-1,0);
+            }
+            if (n>=2 && n>m){
+                zv+= -(n-m)*snapshot.C(n-1,m);
+                zw+= -(n-m)*snapshot.S(n-1,m);
+            }
+            int index= termIndex(n,m);
+            coeffs.XV[index]= -1.0E-9f*xv;
+            coeffs.XW[index]= -1.0E-9f*xw;
+            coeffs.YV[index]= -1.0E-9f*yv;
+            coeffs.YW[index]= -1.0E-9f*yw;
+            coeffs.ZV[index]= -1.0E-9f*zv;
+            coeffs.ZW[index]= -1.0E-9f*zw;
+        }
+    }
+    return coeffs;
+}
+
 //mean radius of  ellipsoid in meters from section 1.2 of the WMM2015 Technical report
-constexpr float EARTH_R= 6371200.0f;
+constexpr TPrecision EARTH_R= 6371200.0;
 
 typedef struct {
-    float x;
-    float y;
-    float z;
+    TPrecision x;
+    TPrecision y;
+    TPrecision z;
 } Vector;
 
 
 typedef struct {
-    float north;// local north magnetic field (nT)
-    float east;// local east magnetic field (nT)
-    float down;// local down magnetic field (nT)
-    float horizontal;// local horizontal magnetic field intensity (nT)
-    float total;// local total magnetic field intensity (nT)
-    float inclination;// also called the dip angle, 
-    // the angle measured from the horizontal plane to the 
+    TPrecision north;// local north magnetic field (nT)
+    TPrecision east;// local east magnetic field (nT)
+    TPrecision down;// local down magnetic field (nT)
+    TPrecision horizontal;// local horizontal magnetic field intensity (nT)
+    TPrecision total;// local total magnetic field intensity (nT)
+    TPrecision inclination;// also called the dip angle,
+    // the angle measured from the horizontal plane to the
     // magnetic field vector; a downward field is positive (deg)
-    float declination;// also called the magnetic variation,
-    // the angle between true north and the horizontal component 
+    TPrecision declination;// also called the magnetic variation,
+    // the angle between true north and the horizontal component
     // of the field, a eastward magnetic field of true North is positive (deg)
 } Elements;
 
+/** Sines and cosines of a latitude and longitude, made by latLonTrig,
+so the conversions that need them can share one set of trig calls.*/
+typedef struct {
+    TPrecision sphi;// sin of latitude
+    TPrecision cphi;// cos of latitude
+    TPrecision slam;// sin of longitude
+    TPrecision clam;// cos of longitude
+} LatLonTrig;
+
+/** Return the sines and cosines of a latitude and longitude.
+ INPUT:
+    lat: latitude in degrees, -90 at the south pole, 90 at the north pole.
+    lon: longitude in degrees.
+**/
+inline LatLonTrig latLonTrig(TPrecision lat, TPrecision lon){
+    TPrecision phi = lat*((TPrecision)(M_PI/180.0));
+    TPrecision lam = lon*((TPrecision)(M_PI/180.0));
+    return {std::sin(phi), std::cos(phi), std::sin(lam), std::cos(lam)};
+}
+
+/** Return a struct containing the 7 magnetic elements.
+ INPUT:
+    mag_field_itrs_nT: local magnetic field in the itrs coordinate system (nT)
+    trig: sines and cosines of the latitude and longitude, from latLonTrig.
+**/
+inline Elements magFieldNT2Elements(Vector mag_field_itrs_nT, const LatLonTrig& trig){
+    TPrecision x = mag_field_itrs_nT.x;
+    TPrecision y = mag_field_itrs_nT.y;
+    TPrecision z = mag_field_itrs_nT.z;
+    TPrecision sphi = trig.sphi;
+    TPrecision cphi = trig.cphi;
+    TPrecision slam = trig.slam;
+    TPrecision clam = trig.clam;
+    TPrecision x1 = clam*x + slam*y;
+    TPrecision north = -sphi*x1 + cphi*z;
+    TPrecision east = -slam*x + clam*y;
+    TPrecision down = -cphi*x1 + -sphi*z;
+    TPrecision horizontal = std::sqrt(north*north + east*east);
+    TPrecision total = std::sqrt(horizontal*horizontal + down*down);
+    TPrecision inclination = std::atan2(down, horizontal)*((TPrecision)(180.0/M_PI));
+    TPrecision declination = std::atan2(east, north)*((TPrecision)(180.0/M_PI));
+    return {north, east, down, horizontal, total, inclination, declination};
+}
+
 /** Return a struct containing the 7 magnetic elements.
 See https://www.geomag.nrcan.gc.ca/mag_fld/comp-en.php and
 https://www.ngdc.noaa.gov/geomag/icons/faqelems.gif for more info.
@@ -195,28 +407,30 @@ https://www.ngdc.noaa.gov/geomag/icons/faqelems.gif for more info.
     lat: latitude in degrees, -90 at the south pole, 90 at the north pole.
     lon: longitude in degrees.
 **/
-inline Elements magField2Elements(Vector mag_field_itrs, float lat, float lon){
-    float x = mag_field_itrs.x*1E9f;
-    float y = mag_field_itrs.y*1E9f;
-    float z = mag_field_itrs.z*1E9f;
-    float phi = lat*((float)(M_PI/180.0));
-    float lam = lon*((float)(M_PI/180.0));
-    float sphi = sinf(phi);
-    float cphi = cosf(phi);
-    float slam = sinf(lam);
-    float clam = cosf(lam);
-    float x1 = clam*x + slam*y;
-    float north = -sphi*x1 + cphi*z;
-    float east = -slam*x + clam*y;
-    float down = -cphi*x1 + -sphi*z;
-    float horizontal = sqrtf(north*north + east*east);
-    float total = sqrtf(horizontal*horizontal + down*down);
-    float inclination = atan2f(down, horizontal)*((float)(180.0/M_PI));
-    float declination = atan2f(east, north)*((float)(180.0/M_PI));
-    return {north, east, down, horizontal, total, inclination, declination};
+inline Elements magField2Elements(Vector mag_field_itrs, TPrecision lat, TPrecision lon){
+    Vector mag_field_itrs_nT = {mag_field_itrs.x*1E9f, mag_field_itrs.y*1E9f, mag_field_itrs.z*1E9f};
+    return magFieldNT2Elements(mag_field_itrs_nT, latLonTrig(lat, lon));
 }
 
 
+/** Return the position in International Terrestrial Reference System coordinates, units meters.
+Using the WGS 84 ellipsoid and the algorithm from https://geographiclib.sourceforge.io/
+ INPUT:
+    trig: sines and cosines of the geodetic latitude and longitude, from latLonTrig.
+    h: Height above the WGS 84 ellipsoid in meters.
+**/
+inline Vector geodetic2ecef(const LatLonTrig& trig, TPrecision h){
+    // WGS 84 constants
+    const TPrecision a = 6378137;
+    // const TPrecision f = 1.0/298.257223563;
+    const TPrecision e2 = 0.0066943799901413165;//f*(2-f);
+    const TPrecision e2m = 0.9933056200098587;//(1-f)*(1-f);
+    TPrecision n = a/std::sqrt(1.0f - e2*(trig.sphi*trig.sphi));
+    TPrecision z = (e2m*n + h) * trig.sphi;
+    TPrecision r = (n + h) * trig.cphi;
+    return {r*trig.clam, r*trig.slam, z};
+}
+
 /** Return the position in International Terrestrial Reference System coordinates, units meters.
 Using the WGS 84 ellipsoid and the algorithm from https://geographiclib.sourceforge.io/
  INPUT:
@@ -224,60 +438,140 @@ Using the WGS 84 ellipsoid and the algorithm from https://geographiclib.sourcefo
     lon: Geodetic longitude in degrees.
     h: Height above the WGS 84 ellipsoid in meters.
 **/
-inline Vector geodetic2ecef(float lat, float lon, float h){
-    // Convert to radians
-    float phi = lat*((float)(M_PI/180.0));
-    float lam = lon*((float)(M_PI/180.0));
-    // WGS 84 constants
-    const float a = 6378137;
-    // const float f = 1.0/298.257223563;
-    const float e2 = 0.0066943799901413165;//f*(2-f);
-    const float e2m = 0.9933056200098587;//(1-f)*(1-f);
-    float sphi = sinf(phi);
-    float cphi = cosf(phi);
-    float slam = sinf(lam);
-    float clam = cosf(lam);
-    float n = a/sqrtf(1.0f - e2*(sphi*sphi));
-    float z = (e2m*n + h) * sphi;
-    float r = (n + h) * cphi;
-    return {r*clam, r*slam, z};
+inline Vector geodetic2ecef(TPrecision lat, TPrecision lon, TPrecision h){
+    return geodetic2ecef(latLonTrig(lat, lon), h);
 }
 
 
-/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+/** Run the V/W recursion, calling visit(n, m, index, V, W) for every term of degree 0 to top, by m then n.
+index is where the term is stored when the terms up to degree Top are stored by m then n, termIndex for Top NMAX+1.
+GeoMagSeriesNT keeps its own streaming copy, so the embedded path needs no term arrays or plan in ram.
+ INPUT:
+    a, b, f, g: x, y, z and EARTH_R, each times EARTH_R/r^2.
+    V00: The V0,0 term, EARTH_R/r.
+    plan(): RecurrencePlan, or anything with diagAt, fcoefAt and gcoefAt stored by the same index.
+    top(0 to Top): The highest degree of the terms.
+ */
+template <int Top, class Plan, class Visitor>
+inline void recurseTerms(TPrecision a, TPrecision b, TPrecision f, TPrecision g, TPrecision V00, const Plan& plan, int top, Visitor&& visit){
+    TPrecision temp;
+    TPrecision Vtop= V00;//V0,0
+    TPrecision Wtop= 0;//W0,0
+    for (int m = 0; m <= top; m++){
+        if (m!=0){
+            temp= Vtop;
+            Vtop= plan.diagAt(m)*(a*Vtop-b*Wtop);
+            Wtop= plan.diagAt(m)*(a*Wtop+b*temp);
+        }
+        int index= (m*(2*Top-m+1))/2+m;
+        TPrecision Vprev= 0;
+        TPrecision Wprev= 0;
+        TPrecision Vnm= Vtop;
+        TPrecision Wnm= Wtop;
+        visit(m, m, index, Vnm, Wnm);
+        for (int n = m+1; n <= top; n++){
+            index++;
+            TPrecision fc= plan.fcoefAt(index)*f;
+            TPrecision gc= plan.gcoefAt(index)*g;
+            temp= Vnm;
+            Vnm= fc*Vnm - gc*Vprev;
+            Vprev= temp;
+            temp= Wnm;
+            Wnm= fc*Wnm - gc*Wprev;
+            Wprev= temp;
+            visit(n, m, index, Vnm, Wnm);
+        }
+    }
+}
+
+/** Run the V/W recursion at a position, calling visit(n, m, index, V, W) for every term of degree 0 to degree+1,
+with index= termIndex(n,m).
  INPUT:
     position_itrs(Above the surface of earth): The location where the field is predicted, units m.
-    dyear(should be around the epoch of the model): The decimal year, for example 2015.0
-    WMM(): Magnetic field model to use.
+    degree(0 to NMAX): The highest degree of the model to use.
  */
-inline Vector GeoMag(float dyear,Vector position_itrs, const ConstModel& WMM){
-    float x= position_itrs.x;
-    float y= position_itrs.y;
-    float z= position_itrs.z;
-    float px= 0;
-    float py= 0;
-    float pz= 0;
-    float rsqrd= x*x+y*y+z*z;
-    float temp= EARTH_R/rsqrd;
-    float a= x*temp;
-    float b= y*temp;
-    float f= z*temp;
-    float g= EARTH_R*temp;
+template <class Visitor>
+inline void sphericalTerms(Vector position_itrs, int degree, Visitor&& visit){
+    TPrecision x= position_itrs.x;
+    TPrecision y= position_itrs.y;
+    TPrecision z= position_itrs.z;
+    TPrecision rsqrd= x*x+y*y+z*z;
+    TPrecision temp= EARTH_R/rsqrd;
+    recurseTerms<NMAX+1>(x*temp, y*temp, z*temp, EARTH_R*temp, EARTH_R/std::sqrt(rsqrd), RECURRENCE_PLAN, degree+1, visit);
+}
+
+/** Return the sums of GeoMagSeriesNT, units nT, the field is minus the sums.
+Each V,W term n,m is multiplied by the model coefficients of the derivative formulas of Montenbruck and Gill section 3.2.5.
+ INPUT:
+    model(): Coefficients to use, anything with C(n,m) and S(n,m) like ModelSnapshot or ConstModelAt.
+    V, W(): The V,W terms up to degree degree+1 stored by termIndex, like SphericalBasis.
+    degree(1 to NMAX): The highest degree of the model to use.
+ */
+template <class Model>
+inline Vector seriesSums(const Model& model, const TPrecision* V, const TPrecision* W, int degree){
+    TPrecision px= 0;
+    TPrecision py= 0;
+    TPrecision pz= 0;
+    for (int m = 0; m <= degree+1; m++){
+        for (int n = m; n <= degree+1; n++){
+            TPrecision Vnm= V[termIndex(n,m)];
+            TPrecision Wnm= W[termIndex(n,m)];
+            if (m<NMAX && n>=m+2){
+                px+= 0.5f*(n-m)*(n-m-1)*(model.C(n-1,m+1)*Vnm+model.S(n-1,m+1)*Wnm);
+                py+= 0.5f*(n-m)*(n-m-1)*(-model.C(n-1,m+1)*Wnm+model.S(n-1,m+1)*Vnm);
+            }
+            if (n>=2 && m>=2){
+                px+= 0.5f*(-model.C(n-1,m-1)*Vnm-model.S(n-1,m-1)*Wnm);
+                py+= 0.5f*(-model.C(n-1,m-1)*Wnm+model.S(n-1,m-1)*Vnm);
+            }
+            if (m==1 && n>=2){
+                px+= -model.C(n-1,0)*Vnm;
+                py+= -model.C(n-1,0)*Wnm;
+            }
+            if (n>=2 && n>m){
+                pz+= (n-m)*(-model.C(n-1,m)*Vnm-model.S(n-1,m)*Wnm);
+            }
+        }
+    }
+    return {px,py,pz};
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units nT.
+Only the terms of the model up to degree Degree are used.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    model(): Coefficients to use, anything with C(n,m) and S(n,m) like ModelSnapshot or ConstModelAt.
+ */
+template <int Degree, class Model>
+inline Vector GeoMagSeriesNT(Vector position_itrs, const Model& model){
+    static_assert(Degree>=1 && Degree<=NMAX, "Degree must be from 1 to NMAX");
+    TPrecision x= position_itrs.x;
+    TPrecision y= position_itrs.y;
+    TPrecision z= position_itrs.z;
+    TPrecision px= 0;
+    TPrecision py= 0;
+    TPrecision pz= 0;
+    TPrecision rsqrd= x*x+y*y+z*z;
+    TPrecision temp= EARTH_R/rsqrd;
+    TPrecision a= x*temp;
+    TPrecision b= y*temp;
+    TPrecision f= z*temp;
+    TPrecision g= EARTH_R*temp;
 
     int n,m;
     //first m==0 row, just solve for the Vs
-    float Vtop= EARTH_R/sqrtf(rsqrd);//V0,0
-    float Wtop= 0;//W0,0
-    float Vprev= 0;
-    float Wprev= 0;
-    float Vnm= Vtop;
-    float Wnm= Wtop;
+    TPrecision Vtop= EARTH_R/std::sqrt(rsqrd);//V0,0
+    TPrecision Wtop= 0;//W0,0
+    TPrecision Vprev= 0;
+    TPrecision Wprev= 0;
+    TPrecision Vnm= Vtop;
+    TPrecision Wnm= Wtop;
 
     //iterate through all ms
-    for ( m = 0; m <= NMAX+1; m++)
+    for ( m = 0; m <= Degree+1; m++)
     {
         // iterate through all ns
-        for (n = m; n <= NMAX+1; n++)
+        for (n = m; n <= Degree+1; n++)
         {
             if (n==m){
                 if(m!=0){
@@ -292,7 +586,7 @@ inline Vector GeoMag(float dyear,Vector position_itrs, const ConstModel& WMM){
             }
             else{
                 temp= Vnm;
-                float invs_temp=1.0f/((float)(n-m));
+                TPrecision invs_temp=1.0f/((TPrecision)(n-m));
                 Vnm= ((2*n-1)*f*Vnm - (n+m-1)*g*Vprev)*invs_temp;
                 Vprev= temp;
                 temp= Wnm;
@@ -300,27 +594,363 @@ inline Vector GeoMag(float dyear,Vector position_itrs, const ConstModel& WMM){
                 Wprev= temp;
             }
             if (m<NMAX && n>=m+2){
-                px+= 0.5f*(n-m)*(n-m-1)*(WMM.C(n-1,m+1,dyear)*Vnm+WMM.S(n-1,m+1,dyear)*Wnm);
-                py+= 0.5f*(n-m)*(n-m-1)*(-WMM.C(n-1,m+1,dyear)*Wnm+WMM.S(n-1,m+1,dyear)*Vnm);
+                px+= 0.5f*(n-m)*(n-m-1)*(model.C(n-1,m+1)*Vnm+model.S(n-1,m+1)*Wnm);
+                py+= 0.5f*(n-m)*(n-m-1)*(-model.C(n-1,m+1)*Wnm+model.S(n-1,m+1)*Vnm);
             }
             if (n>=2 && m>=2){
-                px+= 0.5f*(-WMM.C(n-1,m-1,dyear)*Vnm-WMM.S(n-1,m-1,dyear)*Wnm);
-                py+= 0.5f*(-WMM.C(n-1,m-1,dyear)*Wnm+WMM.S(n-1,m-1,dyear)*Vnm);
+                px+= 0.5f*(-model.C(n-1,m-1)*Vnm-model.S(n-1,m-1)*Wnm);
+                py+= 0.5f*(-model.C(n-1,m-1)*Wnm+model.S(n-1,m-1)*Vnm);
             }
             if (m==1 && n>=2){
-                px+= -WMM.C(n-1,0,dyear)*Vnm;
-                py+= -WMM.C(n-1,0,dyear)*Wnm;
+                px+= -model.C(n-1,0)*Vnm;
+                py+= -model.C(n-1,0)*Wnm;
             }
             if (n>=2 && n>m){
-                pz+= (n-m)*(-WMM.C(n-1,m,dyear)*Vnm-WMM.S(n-1,m,dyear)*Wnm);
+                pz+= (n-m)*(-model.C(n-1,m)*Vnm-model.S(n-1,m)*Wnm);
+            }
+        }
+    }
+    return {-px,-py,-pz};
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+Only the terms of the model up to degree Degree are used.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    model(): Coefficients to use, anything with C(n,m) and S(n,m) like ModelSnapshot or ConstModelAt.
+ */
+template <int Degree, class Model>
+inline Vector GeoMagSeries(Vector position_itrs, const Model& model){
+    Vector field_nT= GeoMagSeriesNT<Degree>(position_itrs, model);
+    return {field_nT.x*1.0E-9f,field_nT.y*1.0E-9f,field_nT.z*1E-9f};
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+ INPUT:
+    dyear(should be around the epoch of the model): The decimal year, for example 2015.0
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    WMM(): Magnetic field model to use.
+ */
+inline Vector GeoMag(float dyear,Vector position_itrs, const ConstModel& WMM){
+    return GeoMagSeries<NMAX>(position_itrs, ConstModelAt{WMM,dyear});
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+Faster than the ConstModel version when many points share the same time.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    snapshot(): Model coefficients resolved at a time by snapshotModel.
+ */
+inline Vector GeoMag(Vector position_itrs, const ModelSnapshot& snapshot){
+    return GeoMagSeries<NMAX>(position_itrs, snapshot);
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+Only the terms of the model up to degree degree are used.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    coeffs(): Derivative coefficients made by derivativeCoeffs.
+    degree(1 to NMAX): The highest degree of the model to use.
+ */
+inline Vector GeoMag(Vector position_itrs, const DerivativeCoeffs& coeffs, int degree){
+    TPrecision bx= 0;
+    TPrecision by= 0;
+    TPrecision bz= 0;
+    sphericalTerms(position_itrs, degree, [&](int, int, int index, TPrecision Vnm, TPrecision Wnm){
+        bx+= coeffs.XV[index]*Vnm+coeffs.XW[index]*Wnm;
+        by+= coeffs.YV[index]*Vnm+coeffs.YW[index]*Wnm;
+        bz+= coeffs.ZV[index]*Vnm+coeffs.ZW[index]*Wnm;
+    });
+    return {bx,by,bz};
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+Only the terms of the model up to degree Degree are used, see the README for the error of each degree.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    coeffs(): Derivative coefficients made by derivativeCoeffs.
+ */
+template <int Degree>
+inline Vector GeoMag(Vector position_itrs, const DerivativeCoeffs& coeffs){
+    static_assert(Degree>=1 && Degree<=NMAX, "Degree must be from 1 to NMAX");
+    return GeoMag(position_itrs, coeffs, Degree);
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+The fastest scalar version, the inner loop is only multiply-adds using RECURRENCE_PLAN and the derivative coefficients.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    coeffs(): Derivative coefficients made by derivativeCoeffs.
+ */
+inline Vector GeoMag(Vector position_itrs, const DerivativeCoeffs& coeffs){
+    return GeoMag<NMAX>(position_itrs, coeffs);
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+Only the terms of the model up to degree Degree are used, see the README for the error of each degree.
+ INPUT:
+    dyear(should be around the epoch of the model): The decimal year, for example 2015.0
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    WMM(): Magnetic field model to use.
+ */
+template <int Degree>
+inline Vector GeoMag(float dyear,Vector position_itrs, const ConstModel& WMM){
+    return GeoMagSeries<Degree>(position_itrs, ConstModelAt{WMM,dyear});
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+Only the terms of the model up to degree Degree are used, see the README for the error of each degree.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    snapshot(): Model coefficients resolved at a time by snapshotModel.
+ */
+template <int Degree>
+inline Vector GeoMag(Vector position_itrs, const ModelSnapshot& snapshot){
+    return GeoMagSeries<Degree>(position_itrs, snapshot);
+}
+
+constexpr int MODEL_GROUP= 4;//number of coefficient sets in a ModelGroupCoeffs
+
+/** The derivative coefficients of up to MODEL_GROUP models or times, made by modelGroupCoeffs.
+The coefficients of a term are stored together, component then set, so GeoMagModels
+adds all the sets with a fixed length loop the compiler can vectorize.
+Uses 6*MODEL_GROUP*NUMTERMS numbers of ram.*/
+struct ModelGroupCoeffs{
+    int count;//number of sets used
+    TPrecision V[NUMTERMS][3][MODEL_GROUP];//V[t][k][s] is the V coefficient of term t in component k of set s
+    TPrecision W[NUMTERMS][3][MODEL_GROUP];//the same for W, the unused sets are zero
+};
+
+/** Return the number of ModelGroupCoeffs holding count coefficient sets.*/
+constexpr int modelGroups(int count){
+    return (count+MODEL_GROUP-1)/MODEL_GROUP;
+}
+
+/** Pack count coefficient sets into groups of MODEL_GROUP sets. Call once per list of sets.
+ INPUT:
+    coeffs(): Array of count pointers to derivative coefficients made by derivativeCoeffs,
+        for example of different models or times.
+    count(at least 1): Number of coefficient sets.
+ OUTPUT:
+    groups: Array of modelGroups(count) groups, set k is set k%%MODEL_GROUP of group k/MODEL_GROUP.
+ */
+inline void modelGroupCoeffs(const DerivativeCoeffs* const* coeffs, int count, ModelGroupCoeffs* groups){
+    for (int first = 0; first < count; first+= MODEL_GROUP){
+        ModelGroupCoeffs& group= groups[first/MODEL_GROUP];
+        group.count= (count-first < MODEL_GROUP) ? count-first : MODEL_GROUP;
+        for (int t = 0; t < NUMTERMS; t++){
+            for (int s = 0; s < MODEL_GROUP; s++){
+                bool used= s < group.count;
+                const DerivativeCoeffs* set= coeffs[used ? first+s : first];
+                group.V[t][0][s]= used ? set->XV[t] : 0;
+                group.V[t][1][s]= used ? set->YV[t] : 0;
+                group.V[t][2][s]= used ? set->ZV[t] : 0;
+                group.W[t][0][s]= used ? set->XW[t] : 0;
+                group.W[t][1][s]= used ? set->YW[t] : 0;
+                group.W[t][2][s]= used ? set->ZW[t] : 0;
             }
         }
     }
-    return {-px*1.0E-9f,-py*1.0E-9f,-pz*1E-9f};
 }
-// Model parameters\n"""%(headerfilename,maxdegree)
+
+/** Calculate the magnetic field of many coefficient sets at one position
+in International Terrestrial Reference System coordinates, units Tesla, sharing one pass of the V/W recursion.
+The first group adds its sets during the recursion, the terms are kept for the later groups,
+each group adds all its sets with six multiply-adds per term, done together for the sets.
+Within rounding of GeoMag(position_itrs, *coeffs[k]) for each set k the groups were made from.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    groups(): Array of modelGroups(count) groups made by modelGroupCoeffs.
+    count: Number of coefficient sets, the count given to modelGroupCoeffs.
+ OUTPUT:
+    fields: Array of count magnetic fields, units Tesla.
+ */
+inline void GeoMagModels(Vector position_itrs, const ModelGroupCoeffs* groups, int count, Vector* fields){
+    TPrecision V[NUMTERMS];
+    TPrecision W[NUMTERMS];
+    TPrecision sums[3*MODEL_GROUP]= {0};
+    sphericalTerms(position_itrs, NMAX, [&](int, int, int index, TPrecision Vnm, TPrecision Wnm){
+        V[index]= Vnm;
+        W[index]= Wnm;
+        const TPrecision* cv= &groups[0].V[index][0][0];
+        const TPrecision* cw= &groups[0].W[index][0][0];
+        for (int j = 0; j < 3*MODEL_GROUP; j++){
+            sums[j]+= cv[j]*Vnm+cw[j]*Wnm;
+        }
+    });
+    for (int first = 0; first < count; first+= MODEL_GROUP){
+        const ModelGroupCoeffs& group= groups[first/MODEL_GROUP];
+        if (first!=0){
+            for (int j = 0; j < 3*MODEL_GROUP; j++){
+                sums[j]= 0;
+            }
+            for (int t = 0; t < NUMTERMS; t++){
+                const TPrecision* cv= &group.V[t][0][0];
+                const TPrecision* cw= &group.W[t][0][0];
+                for (int j = 0; j < 3*MODEL_GROUP; j++){
+                    sums[j]+= cv[j]*V[t]+cw[j]*W[t];
+                }
+            }
+        }
+        for (int s = 0; s < group.count; s++){
+            fields[first+s]= {sums[s], sums[MODEL_GROUP+s], sums[2*MODEL_GROUP+s]};
+        }
+    }
+}
+
+/** Return the 7 magnetic elements at a geodetic position, the same as
+magField2Elements(GeoMag(dyear,geodetic2ecef(lat,lon,h),WMM),lat,lon)
+but with the trig functions of lat and lon called once, and no conversion to Tesla and back.
+ INPUT:
+    dyear(should be around the epoch of the model): The decimal year, for example 2015.0
+    lat: Geodetic latitude in degrees, -90 at the south pole, 90 at the north pole.
+    lon: Geodetic longitude in degrees.
+    h(Above the surface of earth): Height above the WGS 84 ellipsoid in meters.
+    WMM(): Magnetic field model to use.
+ */
+inline Elements GeoMagElements(float dyear, TPrecision lat, TPrecision lon, TPrecision h, const ConstModel& WMM){
+    LatLonTrig trig= latLonTrig(lat, lon);
+    Vector position_itrs= geodetic2ecef(trig, h);
+    return magFieldNT2Elements(GeoMagSeriesNT<NMAX>(position_itrs, ConstModelAt{WMM,dyear}), trig);
+}
+
+/** The magnetic field at one fixed position, made by makeStation.
+The secular variation of the model is linear in time, so the field is
+    main+(dyear-epoch)*secular
+exactly, and field(dyear) only needs three multiply adds.*/
+struct Station{
+    float epoch;//epoch of the model
+    Vector main;//field at the epoch in International Terrestrial Reference System coordinates, units Tesla
+    Vector secular;//change of the field, units Tesla per year
+    /** Return the magnetic field at dyear in International Terrestrial Reference System coordinates, units Tesla.*/
+    inline Vector field(float dyear) const{
+      TPrecision dt= dyear-epoch;
+      return {main.x+dt*secular.x, main.y+dt*secular.y, main.z+dt*secular.z};
+    }
+};
+
+/** Return the Station at a position, the same as GeoMag(dyear,position_itrs,WMM) at any dyear up to rounding.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    WMM(): Magnetic field model to use.
+ */
+inline Station makeStation(Vector position_itrs, const ConstModel& WMM){
+    #ifdef PROGMEM
+      float epoch= pgm_read_float_near(&WMM.epoch);
+    #else
+      float epoch= WMM.epoch;
+    #endif /* PROGMEM */
+    // at the epoch the secular variation term is zero, so C(n,m,epoch) is the main field.
+    return {epoch, GeoMagSeries<NMAX>(position_itrs, ConstModelAt{WMM,epoch}),
+            GeoMagSeries<NMAX>(position_itrs, ConstModelSecular{WMM})};
+}
+
+/** Bounds on the size of each degree of a model, made by truncationBounds.*/
+struct TruncationBounds{
+    float dyear;//decimal year of the coefficients
+    TPrecision K[NMAX+1];//the field of degree n is at most K[n]*(EARTH_R/r)^(n+2), units nT
+};
+
+/** Return the truncation bounds of a snapshot.
+The field of degree n is at most sqrt((n+1)*(2n+1)) times the root sum square of the
+Schmidt semi-normalized coefficients of degree n, times (EARTH_R/r)^(n+2), anywhere at radius r.
+ INPUT:
+    snapshot(): Model coefficients resolved at a time by snapshotModel.
+ */
+inline TruncationBounds truncationBounds(const ModelSnapshot& snapshot){
+    TruncationBounds bounds;
+    bounds.dyear= snapshot.dyear;
+    bounds.K[0]= 0;
+    for (int n = 1; n <= NMAX; n++){
+        double sumsqrd= 0;
+        double factorial_ratio= 1;//(n-m)!/(n+m)!
+        for (int m = 0; m <= n; m++){
+            if (m!=0){
+                factorial_ratio/= (double)(n-m+1)*(n+m);
+            }
+            //undo the un Schmidt semi-normalization done by wmmcodeupdate.py
+            double unnorm= (m==0) ? 1.0 : std::sqrt(2.0*factorial_ratio);
+            double c= snapshot.C(n,m)/unnorm;
+            double s= snapshot.S(n,m)/unnorm;
+            sumsqrd+= c*c+s*s;
+        }
+        bounds.K[n]= std::sqrt((n+1)*(2*n+1)*sumsqrd);
+    }
+    return bounds;
+}
+
+/** Return the lowest degree whose truncation error is at most tolerance, from 1 to NMAX.
+ INPUT:
+    rsqrd(Above the surface of earth): The square of the distance from the center of earth, units m^2.
+    tolerance(>=0): The largest allowed truncation error of the field magnitude, units nT.
+    bounds(): Truncation bounds of the model, made by truncationBounds.
+ */
+inline int truncationDegree(TPrecision rsqrd, TPrecision tolerance, const TruncationBounds& bounds){
+    TPrecision q= EARTH_R/std::sqrt(rsqrd);
+    TPrecision qpow[NMAX+1];//(EARTH_R/r)^(n+2)
+    qpow[0]= q*q;
+    for (int n = 1; n <= NMAX; n++){
+        qpow[n]= qpow[n-1]*q;
+    }
+    TPrecision error= 0;
+    for (int n = NMAX; n > 1; n--){
+        error+= bounds.K[n]*qpow[n];
+        if (error > tolerance){
+            return n;
+        }
+    }
+    return 1;
+}
+
+/** The magnetic field and the degree of the model used to calculate it, returned by GeoMagAdaptive.*/
+typedef struct {
+    Vector field;//units Tesla
+    int degree;//highest degree of the model used, from 1 to NMAX
+} AdaptiveField;
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla,
+using the lowest degree that keeps the truncation error at most tolerance.
+High above the surface the higher degrees are tiny, so far fewer terms are used.
+Rounding error is not included in the tolerance, it is about 0.5 nT in single precision.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    coeffs(): Derivative coefficients made by derivativeCoeffs.
+    bounds(): Truncation bounds of the same model and time, made by truncationBounds.
+    tolerance(>=0): The largest allowed truncation error of the field magnitude, units nT.
+ */
+inline AdaptiveField GeoMagAdaptive(Vector position_itrs, const DerivativeCoeffs& coeffs, const TruncationBounds& bounds, TPrecision tolerance){
+    TPrecision rsqrd= position_itrs.x*position_itrs.x+position_itrs.y*position_itrs.y+position_itrs.z*position_itrs.z;
+    int degree= truncationDegree(rsqrd, tolerance, bounds);
+    return {GeoMag(position_itrs, coeffs, degree), degree};
+}
+// Model parameters\n"""%(headerfilename,maxdegree,recurrence_plan_code(maxdegree))
     return head
 
+def recurrence_plan_code(maxdegree):
+    """return the code defining RECURRENCE_PLAN, the constants of the V,W recursion up to degree maxdegree+1,
+    stored by termIndex, index=((2*(maxdegree+1)-m+1)*m)/2+n
+
+    Args:
+        maxdegree(positive integer): maximum degree"""
+    top= maxdegree+1
+    numterms= ((top+1)*(top+2))//2
+    diag= [float(2*m-1) for m in range(top+1)]
+    fcoef= [0.0]*numterms
+    gcoef= [0.0]*numterms
+    for m in range(top+1):
+        for n in range(m+1,top+1):
+            index= ((2*top-m+1)*m)//2+n
+            fcoef[index]= float(2*n-1)/float(n-m)
+            gcoef[index]= float(n+m-1)/float(n-m)
+    head="""/** The RecurrencePlan, written out by wmmcodeupdate.py so it needs no constexpr loops and can be in PROGMEM.*/
+constexpr
+#ifdef PROGMEM
+    PROGMEM
+#endif /* PROGMEM */
+RecurrencePlan RECURRENCE_PLAN= {"""
+    tables= ['{'+','.join(repr(v) for v in values)+'}' for values in (diag, fcoef, gcoef)]
+    return head+',\n'.join(tables)+'};\n'
+
 def header_file_model_code(modelname, dyear,c_cofs,s_cofs,c_secvars,s_secvars):
     """return the code defining the WMM coefficents and model
                 Stored in a ConstModel, index=((2*maxdegree-m+1)*m)/2+n
@@ -359,6 +989,367 @@ ConstModel %s = {%f,\n"""%(modelname,dyear)
     return head+cs+',\n'+ss+',\n'+csec+',\n'+ssec+modeltail
 
 
+# fractional bits of the fixed point V,W terms and recurrence constants
+FIXED_TERM_BITS= 30
+FIXED_PLAN_BITS= 28
+# fractional bits of the fixed point decimal years
+FIXED_YEAR_BITS= 16
+# the largest fixed point coefficient is below 2**FIXED_COEFF_LIMIT_BITS,
+# so the 64 bit sums of all the terms can't overflow
+FIXED_COEFF_LIMIT_BITS= 23
+
+
+def schmidt(n, m):
+    """return the factor from the Schmidt semi-normalized to the unnormalized coefficents of degree n order m"""
+    if (m==0):
+        return 1.0
+    return math.sqrt(2.0*float(math.factorial(n-m))/float(math.factorial(n+m)))
+
+
+def fixed_main(infilenames, headerfilename, maxdegree):
+    """parse infilenames into the headerfilename c++ header file of the fixed point kernel
+
+    The V,W terms of the recursion are Schmidt semi-normalized, so they are at most about 1 above the
+    surface of the earth for every degree and order, and stored in Q30.
+    The derivative coefficents of the normalized terms are stored as int32 in units of
+    2**-FIXED_COEFF_BITS nT and 2**-FIXED_SECULAR_BITS nT/year, with the bits chosen for all the models.
+    Args:
+        infilenames(list of filenames): the .COF files that contains the
+            WMM coefficents, download this from https://www.ngdc.noaa.gov/geomag/WMM/DoDWMM.shtml
+        headerfilename(string ending in .hpp): the c++ header file.
+        maxdegree(positive integer): maximum degree"""
+    models= []
+    for infilename in infilenames:
+        data= parseescof(infilename,maxdegree)
+        models.append((infilename.split('/')[-1][:-4],data[0],fixed_derivative_coeffs(data,maxdegree)))
+    coeffbits= fixed_bits(max(max(abs(v) for v in row) for model in models for row in model[2][0]))
+    secularbits= fixed_bits(max(max(abs(v) for v in row) for model in models for row in model[2][1]))
+    outstr= fixed_header_file_code(headerfilename,maxdegree,coeffbits,secularbits)
+    for modelname,dyear,coeffs in models:
+        outstr+= fixed_model_code(modelname,dyear,coeffs,coeffbits,secularbits)
+    outstr+= '}\n#endif /* GEOMAG_FIXED_HPP */\n'
+    with open(headerfilename,'w') as f:
+        f.write(outstr)
+
+
+def fixed_bits(maxvalue):
+    """return the most fractional bits that keep maxvalue below 2**FIXED_COEFF_LIMIT_BITS"""
+    bits= FIXED_COEFF_LIMIT_BITS
+    while maxvalue*2.0**bits >= 2.0**FIXED_COEFF_LIMIT_BITS:
+        bits-= 1
+    return bits
+
+
+def term_index(n, m, maxdegree):
+    """return the index of the V,W term of degree n order m, the same as termIndex"""
+    return (m*(2*(maxdegree+1)-m+1))//2+n
+
+
+def fixed_derivative_coeffs(data, maxdegree):
+    """return the main field and secular variation derivative coefficents of the Schmidt semi-normalized V,W terms,
+    each a list of the XV,XW,YV,YW,ZV,ZW lists, units nT and nT/year, the same as derivativeCoeffs without the 1E-9
+
+    Args:
+        data(list): the output of parseescof
+        maxdegree(positive integer): maximum degree"""
+    numterms= (maxdegree+2)*(maxdegree+3)//2
+    out= []
+    for k in (0,1):
+        C= [[0.0]*(maxdegree+1) for n in range(maxdegree+1)]
+        S= [[0.0]*(maxdegree+1) for n in range(maxdegree+1)]
+        for cof in data[1:]:
+            n,m= cof[0],cof[1]
+            C[n][m]= cof[2+2*k]*schmidt(n,m)
+            S[n][m]= cof[3+2*k]*schmidt(n,m)
+        coeffs= [[0.0]*numterms for j in range(6)]
+        for m in range(maxdegree+2):
+            for n in range(m,maxdegree+2):
+                xv= xw= yv= yw= zv= zw= 0.0
+                if m<maxdegree and n>=m+2:
+                    k2= 0.5*(n-m)*(n-m-1)
+                    xv+= k2*C[n-1][m+1]
+                    xw+= k2*S[n-1][m+1]
+                    yv+= k2*S[n-1][m+1]
+                    yw+= -k2*C[n-1][m+1]
+                if n>=2 and m>=2:
+                    xv+= -0.5*C[n-1][m-1]
+                    xw+= -0.5*S[n-1][m-1]
+                    yv+= 0.5*S[n-1][m-1]
+                    yw+= -0.5*C[n-1][m-1]
+                if m==1 and n>=2:
+                    xv+= -C[n-1][0]
+                    yw+= -C[n-1][0]
+                if n>=2 and n>m:
+                    zv+= -(n-m)*C[n-1][m]
+                    zw+= -(n-m)*S[n-1][m]
+                # the stored terms are the unnormalized ones times schmidt(n,m)
+                index= term_index(n,m,maxdegree)
+                for j,v in enumerate((xv,xw,yv,yw,zv,zw)):
+                    coeffs[j][index]= -v/schmidt(n,m)
+        out.append(coeffs)
+    return out
+
+
+def fixed_plan(maxdegree):
+    """return the diag, fcoef, and gcoef recurrence constants of the Schmidt semi-normalized V,W terms,
+    the same as the RecurrencePlan of the unnormalized terms times the ratios of the normalizations"""
+    numterms= (maxdegree+2)*(maxdegree+3)//2
+    diag= [0.0]*(maxdegree+2)
+    fcoef= [0.0]*numterms
+    gcoef= [0.0]*numterms
+    for m in range(maxdegree+2):
+        if m!=0:
+            diag[m]= (2*m-1)*schmidt(m,m)/schmidt(m-1,m-1)
+        for n in range(m+1,maxdegree+2):
+            index= term_index(n,m,maxdegree)
+            fcoef[index]= float(2*n-1)/float(n-m)*schmidt(n,m)/schmidt(n-1,m)
+            if n-2>=m:
+                gcoef[index]= float(n+m-1)/float(n-m)*schmidt(n,m)/schmidt(n-2,m)
+    return (diag,fcoef,gcoef)
+
+
+def fixed_format(values, bits):
+    """return the values in Q bits as a c++ int32 initializer list, 16 per line"""
+    lines= []
+    for k in range(0,len(values),16):
+        lines.append(','.join(str(int(round(v*2.0**bits))) for v in values[k:k+16]))
+    return '{'+',\n'.join(lines)+'}'
+
+
+def fixed_header_file_code(headerfilename, maxdegree, coeffbits, secularbits):
+    """returns the code of the fixed point header file, before the models
+
+    Args:
+        headerfilename(string ending in .hpp): the c++ header file
+        maxdegree(positive integer): maximum degree
+        coeffbits, secularbits(integers): the fractional bits of the main field and secular variation coefficents"""
+    diag,fcoef,gcoef= fixed_plan(maxdegree)
+    head="""/*
+MIT License
+
+Copyright (c) 2019 Nathan Zimmerberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+// %(headerfilename)s Generated by python script wmmcodeupdate.py
+/** \\file
+ * \\brief Integer only version of GeoMag in Q format fixed point, for microcontrollers without a floating point unit.
+ * \\details Does not need XYZgeomag.hpp, the models and constants are stored in PROGMEM if it is defined.
+
+The V,W terms are Schmidt semi-normalized, which scales the terms of each degree and order
+so they are at most about 1 above the surface of the earth, instead of growing like (2m-1)!!,
+and are stored in Q%(termbits)d int32_t. The recurrence constants are Q%(planbits)d.
+The derivative coefficients of the normalized terms are stored as int32_t in units of
+2^-%(coeffbits)d nT for the main field and 2^-%(secularbits)d nT/year for the secular variation,
+and the products are added in int64_t.
+Each multiply is a 32 by 32 bit multiply with a 64 bit result, one instruction on Cortex-M3 and up.
+
+Supported targets are 32 bit microcontrollers without a floating point unit that have that multiply,
+like Cortex-M3, Cortex-M4 without an FPU, and RV32IM. Each term takes 18 of those multiplies,
+and each call 64 bit shifts and one 64 by 32 bit division, which is emulated on 8 bit AVR like the Arduino Uno,
+so it isn't meant for those, where XYZgeomag_table.hpp is the fast option.
+The cycle count hasn't been measured on a target.
+*/
+#ifndef GEOMAG_FIXED_HPP
+#define GEOMAG_FIXED_HPP
+
+#include <stdint.h>
+
+namespace geomag
+{
+constexpr int FIXED_NMAX= %(maxdegree)d;//order of the Model
+constexpr int FIXED_NUMTERMS= (FIXED_NMAX+2)*(FIXED_NMAX+3)/2;//number of V,W terms, degree 0 to FIXED_NMAX+1
+constexpr int FIXED_TERM_BITS= %(termbits)d;//fractional bits of the V,W terms
+constexpr int FIXED_PLAN_BITS= %(planbits)d;//fractional bits of the recurrence constants
+constexpr int FIXED_YEAR_BITS= %(yearbits)d;//fractional bits of the decimal years
+constexpr int FIXED_COEFF_BITS= %(coeffbits)d;//fractional bits of the main field coefficients, units nT
+constexpr int FIXED_SECULAR_BITS= %(secularbits)d;//fractional bits of the secular variation coefficients, units nT/year
+constexpr int32_t FIXED_EARTH_R= 6371200;//mean radius of  ellipsoid in meters from section 1.2 of the WMM2015 Technical report
+
+/** A position in meters or a magnetic field in nT, in International Terrestrial Reference System coordinates.*/
+typedef struct {
+    int32_t x;
+    int32_t y;
+    int32_t z;
+} FixedVector;
+
+/** The constants of the recursion of the normalized V,W terms, in Q FIXED_PLAN_BITS:
+    V(m,m)= diag[m]*(a*V(m-1,m-1) - b*W(m-1,m-1))
+    V(n,m)= fcoef[termIndex(n,m)]*f*V(n-1,m) - gcoef[termIndex(n,m)]*g*V(n-2,m)
+and the same for W, with W(m,m)= diag[m]*(a*W(m-1,m-1) + b*V(m-1,m-1)).*/
+struct FixedPlan{
+    int32_t diag[FIXED_NMAX+2];
+    int32_t fcoef[FIXED_NUMTERMS];
+    int32_t gcoef[FIXED_NUMTERMS];
+};
+
+/** The derivative coefficients of a model in fixed point, made by wmmcodeupdate.py.
+The field in nT is the sum over the normalized terms of
+    x: XV*V+XW*W, y: YV*V+YW*W, z: ZV*V+ZW*W
+with the coefficients main+(dyear-epoch)*secular, and coeffs[0] to coeffs[5] are XV, XW, YV, YW, ZV, ZW.*/
+struct FixedModel{
+    int32_t epoch;//decimal year, Q FIXED_YEAR_BITS
+    int32_t main[6][FIXED_NUMTERMS];//units 2^-FIXED_COEFF_BITS nT
+    int32_t secular[6][FIXED_NUMTERMS];//units 2^-FIXED_SECULAR_BITS nT/year
+};
+
+constexpr
+#ifdef PROGMEM
+    PROGMEM
+#endif /* PROGMEM */
+FixedPlan FIXED_PLAN = {
+%(diag)s,
+%(fcoef)s,
+%(gcoef)s};
+
+/** Read the fixed point number at index.*/
+inline int32_t fixedEntry(const int32_t* entries, int index){
+    #ifdef PROGMEM
+      return (int32_t)pgm_read_dword_near(entries+index);
+    #endif /* PROGMEM */
+    return entries[index];
+}
+
+/** Return the index of the V,W term of degree n order m.*/
+constexpr int fixedTermIndex(int n, int m){
+    return (m*(2*(FIXED_NMAX+1)-m+1))/2+n;
+}
+
+/** Return the floor of the square root of value.*/
+inline uint32_t fixedSqrt(uint64_t value){
+    uint64_t root= 0;
+    uint64_t bit= ((uint64_t)1)<<62;
+    while (bit > value){
+        bit>>= 2;
+    }
+    while (bit != 0){
+        if (value >= root+bit){
+            value-= root+bit;
+            root= (root>>1)+bit;
+        } else {
+            root>>= 1;
+        }
+        bit>>= 2;
+    }
+    return (uint32_t)root;
+}
+
+/** Return the product of two Q bits fixed point numbers, in Q bits.*/
+inline int32_t fixedMul(int32_t a, int32_t b, int bits){
+    return (int32_t)(((int64_t)a*b)>>bits);
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units nT,
+using only integer math. Within 1 nT of GeoMag at the test points, plus the rounding of the position to 1 m.
+ INPUT:
+    dyear(should be around the epoch of the model): The decimal year times 2^FIXED_YEAR_BITS, for example 2022.5*65536
+    position_itrs(Above the surface of earth, and within 2^30 m of its center): The location where the field is predicted, units m.
+    model(): Magnetic field model to use, for example WMM2020_FIXED.
+ */
+inline FixedVector GeoMagFixed(int32_t dyear, FixedVector position_itrs, const FixedModel& model){
+    const int T= FIXED_TERM_BITS;
+    const int P= FIXED_PLAN_BITS;
+    int32_t x= position_itrs.x;
+    int32_t y= position_itrs.y;
+    int32_t z= position_itrs.z;
+    uint64_t rsqrd= (uint64_t)((int64_t)x*x+(int64_t)y*y+(int64_t)z*z);
+    uint32_t r= fixedSqrt(rsqrd);
+    // the only division, inv is 2^(T+23)/r, below 2^31 above 2^22 m from the center
+    int32_t inv= (int32_t)((((int64_t)1)<<(T+23))/r);
+    int32_t u= (int32_t)(((int64_t)FIXED_EARTH_R*inv)>>23);//EARTH_R/r, V(0,0)
+    int32_t a= fixedMul((int32_t)(((int64_t)x*inv)>>23), u, T);//x*EARTH_R/r^2
+    int32_t b= fixedMul((int32_t)(((int64_t)y*inv)>>23), u, T);//y*EARTH_R/r^2
+    int32_t f= fixedMul((int32_t)(((int64_t)z*inv)>>23), u, T);//z*EARTH_R/r^2
+    int32_t g= fixedMul(u, u, T);//EARTH_R^2/r^2
+
+    int64_t sums[6]= {0, 0, 0, 0, 0, 0};//main field x, y, z, then secular variation x, y, z
+    int32_t Vtop= u;
+    int32_t Wtop= 0;
+    for (int m = 0; m <= FIXED_NMAX+1; m++){
+        if (m!=0){
+            int32_t diag= fixedEntry(FIXED_PLAN.diag, m);
+            int32_t temp= Vtop;
+            Vtop= fixedMul((int32_t)(((int64_t)a*Vtop-(int64_t)b*Wtop)>>T), diag, P);
+            Wtop= fixedMul((int32_t)(((int64_t)a*Wtop+(int64_t)b*temp)>>T), diag, P);
+        }
+        int32_t Vprev= 0;
+        int32_t Wprev= 0;
+        int32_t Vnm= Vtop;
+        int32_t Wnm= Wtop;
+        for (int n = m; n <= FIXED_NMAX+1; n++){
+            int index= fixedTermIndex(n,m);
+            if (n!=m){
+                int32_t fc= fixedMul(fixedEntry(FIXED_PLAN.fcoef, index), f, T);
+                int32_t gc= fixedMul(fixedEntry(FIXED_PLAN.gcoef, index), g, T);
+                int32_t temp= Vnm;
+                Vnm= (int32_t)(((int64_t)fc*Vnm-(int64_t)gc*Vprev)>>P);
+                Vprev= temp;
+                temp= Wnm;
+                Wnm= (int32_t)(((int64_t)fc*Wnm-(int64_t)gc*Wprev)>>P);
+                Wprev= temp;
+            }
+            for (int k = 0; k < 3; k++){
+                sums[k]+= (int64_t)fixedEntry(model.main[2*k], index)*Vnm+(int64_t)fixedEntry(model.main[2*k+1], index)*Wnm;
+                sums[3+k]+= (int64_t)fixedEntry(model.secular[2*k], index)*Vnm+(int64_t)fixedEntry(model.secular[2*k+1], index)*Wnm;
+            }
+        }
+    }
+    // combine in Q FIXED_YEAR_BITS nT, then round to nT
+    const int Y= FIXED_YEAR_BITS;
+    int64_t dt= (int64_t)dyear-fixedEntry(&model.epoch, 0);
+    int32_t field[3];
+    for (int k = 0; k < 3; k++){
+        int64_t mainfield= sums[k]>>(FIXED_COEFF_BITS+T-Y);
+        int64_t secular= sums[3+k]>>(FIXED_SECULAR_BITS+T-Y);
+        int64_t total= mainfield+((secular*dt)>>Y);
+        field[k]= (int32_t)((total+(((int64_t)1)<<(Y-1)))>>Y);
+    }
+    return {field[0], field[1], field[2]};
+}
+
+// Model parameters
+"""%{'headerfilename':headerfilename,'maxdegree':maxdegree,'termbits':FIXED_TERM_BITS,'planbits':FIXED_PLAN_BITS,
+    'yearbits':FIXED_YEAR_BITS,'coeffbits':coeffbits,'secularbits':secularbits,
+    'diag':fixed_format(diag,FIXED_PLAN_BITS),'fcoef':fixed_format(fcoef,FIXED_PLAN_BITS),'gcoef':fixed_format(gcoef,FIXED_PLAN_BITS)}
+    return head
+
+
+def fixed_model_code(modelname, dyear, coeffs, coeffbits, secularbits):
+    """return the code defining the fixed point model modelname_FIXED
+
+    Args:
+        modelname(str, a valid C++ name): name of the model
+        dyear(positive float): the year of the magnetic model, ex 2015.0
+        coeffs(list): the output of fixed_derivative_coeffs
+        coeffbits, secularbits(integers): the fractional bits of the main field and secular variation coefficents"""
+    head="""constexpr
+#ifdef PROGMEM
+    PROGMEM
+#endif /* PROGMEM */
+FixedModel %s_FIXED = {%d,\n"""%(modelname,int(round(dyear*2.0**FIXED_YEAR_BITS)))
+    main= ',\n'.join(fixed_format(row,coeffbits) for row in coeffs[0])
+    secular= ',\n'.join(fixed_format(row,secularbits) for row in coeffs[1])
+    return head+'{'+main+'},\n{'+secular+'}};\n\n'
+
+
 def parseescof(infilename, maxdegree):
     """return a list of lists from the infilename cof data file
     dyear,
@@ -399,6 +1390,10 @@ if __name__ == '__main__':
         WMM coefficents, download from https://www.ngdc.noaa.gov/geomag/WMM/DoDWMM.shtml.""")
     parser.add_argument('-o',type=str,default='../src/XYZgeomag.hpp',help='the c++ header filename to write the coefficents and model')
     parser.add_argument('-n',type=int,default=12,help='maximum number of degrees to use')
+    parser.add_argument('-x',type=str,help='instead write the integer only fixed point header to this filename, for example ../src/XYZgeomag_fixed.hpp')
     arg=parser.parse_args()
 
-    main(arg.f,arg.o,arg.n)
+    if arg.x:
+        fixed_main(arg.f,arg.x,arg.n)
+    else:
+        main(arg.f,arg.o,arg.n)
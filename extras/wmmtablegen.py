@@ -0,0 +1,424 @@
+# MIT License
+#
+# Copyright (c) 2019 Nathan Zimmerberg
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+#wmmtablegen.py
+#This is a simple script to sample a WMM.COF model into a c++ header file
+#with a quantized int16 latitude, longitude table of declination, inclination,
+#and total intensity at one decimal year and height, for microcontrollers.
+#To run, use command "python wmmtablegen.py", add -h flag for help
+#The field is calculated in double precision with the same recursion as GeoMag.
+import math
+from wmmcodeupdate import parseescof
+
+# WGS 84 constants, the same as geodetic2ecef
+WGS84_A= 6378137.0
+WGS84_E2= 0.0066943799901413165
+WGS84_E2M= 0.9933056200098587
+EARTH_R= 6371200.0
+# units of the stored int16 angles, degrees
+ANGLE_UNIT= 0.01
+# the declination error is only measured where the horizontal intensity
+# is at least this, in nT, outside the blackout and caution zones of the WMM
+MIN_HORIZONTAL= 6000.0
+# the declination error is also measured between these latitudes, in degrees
+MID_LATITUDE= 60.0
+# the largest errors found at the samples are multiplied by this, so the
+# documented errors also bound the errors at points between the samples
+ERROR_MARGIN= 1.1
+
+
+def main(infilename, headerfilename, maxdegree, dyear, height, resolution, samples):
+    """sample infilename into the headerfilename c++ header file
+
+    The table has a row every resolution degrees of latitude from -90 to 90,
+    and a column every resolution degrees of longitude from -180, wrapping at 180.
+    The errors of the bilinear interpolation versus the full model are measured
+    on a grid of samples+1 by samples+1 points in every cell, including its edges,
+    and the largest, times ERROR_MARGIN, are written in the header.
+    Args:
+        infilename(string ending in .COF): the .COF file that contains the
+            WMM coefficents, download this from https://www.ngdc.noaa.gov/geomag/WMM/DoDWMM.shtml
+        headerfilename(string ending in .hpp): the c++ header file.
+        maxdegree(positive integer): maximum degree
+        dyear(float): the decimal year of the table
+        height(float): height above the WGS 84 ellipsoid of the table, units m
+        resolution(float dividing 180): the spacing of the table, units degrees
+        samples(positive integer): the number of error sample intervals along each side of a cell"""
+    nlat= int(round(180.0/resolution))+1
+    nlon= int(round(360.0/resolution))
+    if abs((nlat-1)*resolution-180.0) > 1E-9:
+        raise ValueError('resolution must divide 180 degrees')
+    model= modelat(parseescof(infilename,maxdegree),maxdegree,dyear)
+    table= []
+    for i in range(nlat):
+        for j in range(nlon):
+            table.append(elements(model,maxdegree,-90.0+i*resolution,-180.0+j*resolution,height))
+    intensity_unit= 1.0
+    while max(e[2] for e in table)/intensity_unit > 32767:
+        intensity_unit*= 2.0
+    quantized= [[int(round(e[0]/ANGLE_UNIT)),int(round(e[1]/ANGLE_UNIT)),int(round(e[2]/intensity_unit))] for e in table]
+    # measure the error on a grid of points in every cell, including its edges
+    maxerr= [0.0,0.0,0.0,0.0]
+    for i in range(nlat-1):
+        for j in range(nlon):
+            for si in range(samples+1):
+                for sj in range(samples+1):
+                    u= float(si)/samples
+                    v= float(sj)/samples
+                    lat= -90.0+(i+u)*resolution
+                    lon= -180.0+(j+v)*resolution
+                    exact= elements(model,maxdegree,lat,lon,height)
+                    approx= interpolate(quantized,nlon,i,j,u,v,intensity_unit)
+                    ddec= abs((approx[0]-exact[0]+180.0)%360.0-180.0)
+                    if exact[3] >= MIN_HORIZONTAL:
+                        maxerr[0]= max(maxerr[0],ddec)
+                        if abs(lat) <= MID_LATITUDE:
+                            maxerr[3]= max(maxerr[3],ddec)
+                    maxerr[1]= max(maxerr[1],abs(approx[1]-exact[1]))
+                    maxerr[2]= max(maxerr[2],abs(approx[2]-exact[2]))
+    maxerr= [e*ERROR_MARGIN for e in maxerr]
+    modelname= infilename.split('/')[-1][:-4]
+    outstr= header_file_code(headerfilename,modelname,dyear,height,resolution,nlat,nlon,intensity_unit,samples,maxerr,quantized)
+    with open(headerfilename,'w') as f:
+        f.write(outstr)
+    print('max errors: declination %.3f deg (%.3f deg at mid latitudes), inclination %.3f deg, total intensity %.1f nT'%(maxerr[0],maxerr[3],maxerr[1],maxerr[2]))
+    print('table size %d bytes'%(6*nlat*nlon))
+
+
+def modelat(data, maxdegree, dyear):
+    """return the un Schmidt semi-normalized coefficents C[n][m], S[n][m]
+    at the decimal year dyear
+
+    Args:
+        data(list): the output of parseescof
+        maxdegree(positive integer): maximum degree
+        dyear(float): the decimal year"""
+    epoch= data[0]
+    C= [[0.0]*(maxdegree+1) for n in range(maxdegree+1)]
+    S= [[0.0]*(maxdegree+1) for n in range(maxdegree+1)]
+    for cof in data[1:]:
+        n,m,g,h,gsec,hsec= cof
+        if (m==0):
+            unnorm= 1.0
+        else:
+            unnorm= math.sqrt(2.0*float(math.factorial(n-m))/float(math.factorial(n+m)))
+        C[n][m]= (g+(dyear-epoch)*gsec)*unnorm
+        S[n][m]= (h+(dyear-epoch)*hsec)*unnorm
+    return (C,S)
+
+
+def fieldnt(model, maxdegree, x, y, z):
+    """return the magnetic field in ITRS coordinates, units nT, the same as GeoMag
+
+    Args:
+        model(tuple): the output of modelat
+        maxdegree(positive integer): maximum degree
+        x,y,z(float): the position in ITRS coordinates, units m"""
+    C,S= model
+    px= py= pz= 0.0
+    rsqrd= x*x+y*y+z*z
+    temp= EARTH_R/rsqrd
+    a= x*temp
+    b= y*temp
+    f= z*temp
+    g= EARTH_R*temp
+    Vtop= EARTH_R/math.sqrt(rsqrd)
+    Wtop= 0.0
+    for m in range(maxdegree+2):
+        if m!=0:
+            Vtop,Wtop= (2*m-1)*(a*Vtop-b*Wtop),(2*m-1)*(a*Wtop+b*Vtop)
+        Vprev= Wprev= 0.0
+        Vnm= Vtop
+        Wnm= Wtop
+        for n in range(m,maxdegree+2):
+            if n!=m:
+                Vnm,Vprev= ((2*n-1)*f*Vnm-(n+m-1)*g*Vprev)/(n-m),Vnm
+                Wnm,Wprev= ((2*n-1)*f*Wnm-(n+m-1)*g*Wprev)/(n-m),Wnm
+            if m<maxdegree and n>=m+2:
+                px+= 0.5*(n-m)*(n-m-1)*(C[n-1][m+1]*Vnm+S[n-1][m+1]*Wnm)
+                py+= 0.5*(n-m)*(n-m-1)*(-C[n-1][m+1]*Wnm+S[n-1][m+1]*Vnm)
+            if n>=2 and m>=2:
+                px+= 0.5*(-C[n-1][m-1]*Vnm-S[n-1][m-1]*Wnm)
+                py+= 0.5*(-C[n-1][m-1]*Wnm+S[n-1][m-1]*Vnm)
+            if m==1 and n>=2:
+                px+= -C[n-1][0]*Vnm
+                py+= -C[n-1][0]*Wnm
+            if n>=2 and n>m:
+                pz+= (n-m)*(-C[n-1][m]*Vnm-S[n-1][m]*Wnm)
+    return (-px,-py,-pz)
+
+
+def elements(model, maxdegree, lat, lon, height):
+    """return declination(deg), inclination(deg), total intensity(nT), and
+    horizontal intensity(nT) at a geodetic position, the same as GeoMagElements
+
+    Args:
+        model(tuple): the output of modelat
+        maxdegree(positive integer): maximum degree
+        lat,lon(float): geodetic latitude and longitude, units degrees
+        height(float): height above the WGS 84 ellipsoid, units m"""
+    sphi= math.sin(math.radians(lat))
+    cphi= math.cos(math.radians(lat))
+    slam= math.sin(math.radians(lon))
+    clam= math.cos(math.radians(lon))
+    n= WGS84_A/math.sqrt(1.0-WGS84_E2*sphi*sphi)
+    r= (n+height)*cphi
+    x,y,z= fieldnt(model,maxdegree,r*clam,r*slam,(WGS84_E2M*n+height)*sphi)
+    x1= clam*x+slam*y
+    north= -sphi*x1+cphi*z
+    east= -slam*x+clam*y
+    down= -cphi*x1-sphi*z
+    horizontal= math.sqrt(north*north+east*east)
+    total= math.sqrt(horizontal*horizontal+down*down)
+    return (math.degrees(math.atan2(east,north)),math.degrees(math.atan2(down,horizontal)),total,horizontal)
+
+
+def interpolate(quantized, nlon, i, j, u, v, intensity_unit):
+    """return declination(deg), inclination(deg), and total intensity(nT)
+    interpolated in cell i,j of the quantized table, the same as GeoMagTable
+
+    Args:
+        quantized(list): the table, stored by latitude row then longitude
+        nlon(positive integer): the number of longitudes
+        i,j(integers): the row and column of the cell
+        u,v(floats from 0 to 1): the position in the cell along latitude and longitude
+        intensity_unit(float): the unit of the stored total intensity, nT"""
+    j1= (j+1)%nlon
+    corners= [quantized[i*nlon+j],quantized[i*nlon+j1],quantized[(i+1)*nlon+j],quantized[(i+1)*nlon+j1]]
+    weights= [(1-u)*(1-v),(1-u)*v,u*(1-v),u*v]
+    out= []
+    for k in range(3):
+        total= 0.0
+        for c,w in zip(corners,weights):
+            value= c[k]
+            if k==0:
+                # unwrap the declination around the first corner
+                if value-corners[0][0] > 18000:
+                    value-= 36000
+                elif value-corners[0][0] < -18000:
+                    value+= 36000
+            total+= w*value
+        out.append(total)
+    declination= out[0]*ANGLE_UNIT
+    if declination > 180.0:
+        declination-= 360.0
+    elif declination < -180.0:
+        declination+= 360.0
+    return (declination,out[1]*ANGLE_UNIT,out[2]*intensity_unit)
+
+
+def cformat(values):
+    """return the values as a c++ initializer list, 16 per line"""
+    lines= []
+    for k in range(0,len(values),16):
+        lines.append(','.join(str(v) for v in values[k:k+16]))
+    return '{'+',\n'.join(lines)+'}'
+
+
+def header_file_code(headerfilename, modelname, dyear, height, resolution, nlat, nlon, intensity_unit, samples, maxerr, quantized):
+    """returns the code of the table header file
+
+    Args:
+        headerfilename(string ending in .hpp): the c++ header file
+        modelname(string): the name of the model, like WMM2020
+        dyear, height, resolution: the decimal year, height(m), and spacing(deg) of the table
+        nlat, nlon(positive integers): the number of latitudes and longitudes
+        intensity_unit(float): the unit of the stored total intensity, nT
+        samples(positive integer): the number of error sample intervals along each side of a cell
+        maxerr(list): the maximum declination(deg), inclination(deg), total intensity(nT),
+            and mid latitude declination(deg) errors, including ERROR_MARGIN
+        quantized(list): the table, stored by latitude row then longitude"""
+    head="""/*
+MIT License
+
+Copyright (c) 2019 Nathan Zimmerberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+// %(headerfilename)s Generated by python script wmmtablegen.py
+/** \\file
+ * \\brief Declination, inclination, and total intensity of %(modelname)s at decimal year %(dyear).3f
+and height %(height).1f m, by bilinear interpolation of a %(resolution)g degree table, without trig functions.
+ * \\details For microcontrollers where GeoMag is too slow, the table is stored in PROGMEM if it is defined.
+Does not need XYZgeomag.hpp, and uses float like the Arduino.
+
+Maximum errors versus the full model, the largest errors at %(points)dx%(points)d points in every cell,
+%(step)g degrees apart, times %(margin)g to bound the errors between them:
+  declination %(decerr).3f deg, where the horizontal intensity is at least %(minh).0f nT,
+    and %(middecerr).3f deg there between latitudes -%(midlat)g and %(midlat)g,
+    near the magnetic poles the declination is not reliable,
+  inclination %(incerr).3f deg,
+  total intensity %(toterr).1f nT.
+*/
+#ifndef GEOMAG_TABLE_HPP
+#define GEOMAG_TABLE_HPP
+
+#include <stdint.h>
+#include <math.h>
+
+namespace geomag
+{
+constexpr float TABLE_DYEAR= %(dyear)f;//decimal year of the table
+constexpr float TABLE_HEIGHT= %(height)f;//height above the WGS 84 ellipsoid of the table, units m
+constexpr float TABLE_RESOLUTION= %(resolution)f;//spacing of the table, units degrees
+constexpr int TABLE_NLAT= %(nlat)d;//latitudes from -90 to 90
+constexpr int TABLE_NLON= %(nlon)d;//longitudes from -180, wrapping at 180
+constexpr float TABLE_ANGLE_UNIT= %(angleunit)f;//unit of the stored angles, deg
+constexpr float TABLE_INTENSITY_UNIT= %(intensityunit)f;//unit of the stored total intensity, nT
+constexpr float TABLE_MIN_HORIZONTAL= %(minh).1ff;//the declination errors are measured where the horizontal intensity is at least this, nT
+constexpr float TABLE_DECLINATION_ERROR= %(decerr).3ff;//maximum declination error, deg
+constexpr float TABLE_MID_LATITUDE= %(midlat).1ff;//the mid latitude declination error is measured between -TABLE_MID_LATITUDE and TABLE_MID_LATITUDE, deg
+constexpr float TABLE_MID_LATITUDE_DECLINATION_ERROR= %(middecerr).3ff;//maximum declination error at mid latitudes, deg
+constexpr float TABLE_INCLINATION_ERROR= %(incerr).3ff;//maximum inclination error, deg
+constexpr float TABLE_TOTAL_ERROR= %(toterr).1ff;//maximum total intensity error, nT
+
+/** The quantized elements at each table point, stored by latitude row then longitude.*/
+struct ElementTable{
+    const int16_t declination[TABLE_NLAT*TABLE_NLON];//units TABLE_ANGLE_UNIT
+    const int16_t inclination[TABLE_NLAT*TABLE_NLON];//units TABLE_ANGLE_UNIT
+    const int16_t total[TABLE_NLAT*TABLE_NLON];//units TABLE_INTENSITY_UNIT
+};
+
+/** Declination, inclination, and total intensity, returned by GeoMagTable.*/
+typedef struct {
+    float declination;// deg, eastward of true North is positive
+    float inclination;// deg, downward is positive
+    float total;// nT
+} TableElements;
+
+/** Read the table entry at index.*/
+inline int16_t tableEntry(const int16_t* entries, int index){
+    #ifdef PROGMEM
+      return (int16_t)pgm_read_word_near(entries+index);
+    #endif /* PROGMEM */
+    return entries[index];
+}
+
+/** Return the declination, inclination, and total intensity at TABLE_DYEAR and TABLE_HEIGHT,
+interpolated from table, with the errors documented above.
+ INPUT:
+    lat: Geodetic latitude in degrees, -90 at the south pole, 90 at the north pole.
+    lon: Geodetic longitude in degrees.
+    table(): The table to use, for example %(modelname)s_TABLE.
+ */
+inline TableElements GeoMagTable(float lat, float lon, const ElementTable& table){
+    float u= (lat+90.0f)/TABLE_RESOLUTION;
+    if (u < 0){
+        u= 0;
+    }
+    int i= (int)u;
+    if (i > TABLE_NLAT-2){
+        i= TABLE_NLAT-2;
+    }
+    u-= i;
+    float v= fmodf((lon+180.0f)/TABLE_RESOLUTION, (float)TABLE_NLON);
+    if (v < 0){
+        v+= TABLE_NLON;
+    }
+    int j= (int)v;
+    if (j > TABLE_NLON-1){
+        j= TABLE_NLON-1;
+    }
+    v-= j;
+    int j1= (j+1 == TABLE_NLON) ? 0 : j+1;
+    const int corners[4]= {i*TABLE_NLON+j, i*TABLE_NLON+j1, (i+1)*TABLE_NLON+j, (i+1)*TABLE_NLON+j1};
+    const float weights[4]= {(1-u)*(1-v), (1-u)*v, u*(1-v), u*v};
+    float declination= 0;
+    float inclination= 0;
+    float total= 0;
+    int32_t first= tableEntry(table.declination, corners[0]);
+    for (int k = 0; k < 4; k++){
+        // unwrap the declination around the first corner
+        int32_t d= tableEntry(table.declination, corners[k]);
+        if (d-first > 18000){
+            d-= 36000;
+        } else if (d-first < -18000){
+            d+= 36000;
+        }
+        declination+= weights[k]*d;
+        inclination+= weights[k]*tableEntry(table.inclination, corners[k]);
+        total+= weights[k]*tableEntry(table.total, corners[k]);
+    }
+    declination*= TABLE_ANGLE_UNIT;
+    if (declination > 180.0f){
+        declination-= 360.0f;
+    } else if (declination < -180.0f){
+        declination+= 360.0f;
+    }
+    return {declination, inclination*TABLE_ANGLE_UNIT, total*TABLE_INTENSITY_UNIT};
+}
+
+// Table
+constexpr
+#ifdef PROGMEM
+    PROGMEM
+#endif /* PROGMEM */
+ElementTable %(modelname)s_TABLE = {
+"""%{'headerfilename':headerfilename,'modelname':modelname,'dyear':dyear,'height':height,
+    'resolution':resolution,'points':samples+1,'step':resolution/samples,'margin':ERROR_MARGIN,'decerr':maxerr[0],'minh':MIN_HORIZONTAL,
+    'incerr':maxerr[1],'toterr':maxerr[2],'middecerr':maxerr[3],'midlat':MID_LATITUDE,'nlat':nlat,'nlon':nlon,'angleunit':ANGLE_UNIT,
+    'intensityunit':intensity_unit}
+    body= ',\n'.join(cformat([q[k] for q in quantized]) for k in range(3))
+    return head+body+'};\n}\n#endif /* GEOMAG_TABLE_HPP */\n'
+
+
+
+if __name__ == '__main__':
+    import argparse
+
+    parser = argparse.ArgumentParser(
+    formatter_class=argparse.RawDescriptionHelpFormatter,
+    description="""
+    #wmmtablegen.py
+    #This is a simple script to sample a WMM.COF model into a c++ header file
+    #with a quantized int16 latitude, longitude table of declination, inclination,
+    #and total intensity at one decimal year and height, for microcontrollers.
+    """)
+    parser.add_argument('-f',type=str,default='WMM2020.COF',help="""the .COF file that contains the
+        WMM coefficents, download from https://www.ngdc.noaa.gov/geomag/WMM/DoDWMM.shtml.""")
+    parser.add_argument('-o',type=str,default='../src/XYZgeomag_table.hpp',help='the c++ header filename to write the table')
+    parser.add_argument('-n',type=int,default=12,help='maximum number of degrees to use')
+    parser.add_argument('-y',type=float,default=2022.5,help='decimal year of the table')
+    parser.add_argument('-a',type=float,default=0.0,help='height above the WGS 84 ellipsoid of the table, units m')
+    parser.add_argument('-r',type=float,default=5.0,help='spacing of the table, units degrees, must divide 180')
+    parser.add_argument('-s',type=int,default=20,help='number of error sample intervals along each side of a cell')
+    arg=parser.parse_args()
+
+    main(arg.f,arg.o,arg.n,arg.y,arg.a,arg.r,arg.s)
@@ -80,6 +80,173 @@ struct ConstModel{
       return Main_Field_Coeff_S[index]+(dyear-epoch)*Secular_Var_Coeff_S[index];
     }
 };
+/** The coefficients of a ConstModel resolved at one time, made by snapshotModel.
+Uses 2*NUMCOF numbers of ram, but removes the secular variation math from GeoMag.*/
+struct ModelSnapshot{
+    float dyear;//decimal year the coefficients are resolved at
+    TPrecision Coeff_C[NUMCOF];
+    TPrecision Coeff_S[NUMCOF];
+    /** Function for indexing the C spherical component n,m.*/
+    inline TPrecision C(int n, int m) const{
+      return Coeff_C[(m*(2*NMAX-m+1))/2+n];
+    }
+    /** Function for indexing the S spherical component n,m.*/
+    inline TPrecision S(int n, int m) const{
+      return Coeff_S[(m*(2*NMAX-m+1))/2+n];
+    }
+};
+
+/** Return the coefficients of WMM resolved at dyear.
+ INPUT:
+    dyear(should be around the epoch of the model): The decimal year, for example 2015.0
+    WMM(): Magnetic field model to use.
+ */
+inline ModelSnapshot snapshotModel(float dyear, const ConstModel& WMM){
+    ModelSnapshot snapshot;
+    snapshot.dyear= dyear;
+    for (int m = 0; m <= NMAX; m++){
+        for (int n = m; n <= NMAX; n++){
+            int index= (m*(2*NMAX-m+1))/2+n;
+            snapshot.Coeff_C[index]= WMM.C(n,m,dyear);
+            snapshot.Coeff_S[index]= WMM.S(n,m,dyear);
+        }
+    }
+    return snapshot;
+}
+
+/** A ConstModel at dyear, with the same C(n,m), S(n,m) interface as ModelSnapshot.*/
+struct ConstModelAt{
+    const ConstModel& WMM;
+    float dyear;
+    inline TPrecision C(int n, int m) const{
+      return WMM.C(n,m,dyear);
+    }
+    inline TPrecision S(int n, int m) const{
+      return WMM.S(n,m,dyear);
+    }
+};
+/** The secular variation of a ConstModel, units nT per year, with the same C(n,m), S(n,m) interface as ModelSnapshot.*/
+struct ConstModelSecular{
+    const ConstModel& WMM;
+    inline TPrecision C(int n, int m) const{
+      int index= (m*(2*NMAX-m+1))/2+n;
+      #ifdef PROGMEM
+        return pgm_read_float_near(WMM.Secular_Var_Coeff_C+index);
+      #endif /* PROGMEM */
+      return WMM.Secular_Var_Coeff_C[index];
+    }
+    inline TPrecision S(int n, int m) const{
+      int index= (m*(2*NMAX-m+1))/2+n;
+      #ifdef PROGMEM
+        return pgm_read_float_near(WMM.Secular_Var_Coeff_S+index);
+      #endif /* PROGMEM */
+      return WMM.Secular_Var_Coeff_S[index];
+    }
+};
+constexpr int NUMTERMS= (NMAX+2)*(NMAX+3)/2;//number of V,W terms, degree 0 to NMAX+1
+/** Index of the V,W term n,m, terms are stored by m then n, in the same order GeoMag visits them.*/
+constexpr int termIndex(int n, int m){
+    return (m*(2*(NMAX+1)-m+1))/2+n;
+}
+
+/** The constants of the V/W recursion, so GeoMag doesn't need integer math or divisions.
+    V(m,m)= diag[m]*(a*V(m-1,m-1)-b*W(m-1,m-1))
+    V(n,m)= fcoef[termIndex(n,m)]*f*V(n-1,m) - gcoef[termIndex(n,m)]*g*V(n-2,m)
+and the same for W.*/
+struct RecurrencePlan{
+    TPrecision diag[NMAX+2];// (2m-1)
+    TPrecision fcoef[NUMTERMS];// (2n-1)/(n-m), 0 for n==m
+    TPrecision gcoef[NUMTERMS];// (n+m-1)/(n-m), 0 for n==m
+    /** Functions for reading the constants, which may be in PROGMEM.*/
+    inline TPrecision diagAt(int m) const{
+      #ifdef PROGMEM
+        return pgm_read_float_near(diag+m);
+      #endif /* PROGMEM */
+      return diag[m];
+    }
+    inline TPrecision fcoefAt(int index) const{
+      #ifdef PROGMEM
+        return pgm_read_float_near(fcoef+index);
+      #endif /* PROGMEM */
+      return fcoef[index];
+    }
+    inline TPrecision gcoefAt(int index) const{
+      #ifdef PROGMEM
+        return pgm_read_float_near(gcoef+index);
+      #endif /* PROGMEM */
+      return gcoef[index];
+    }
+};
+
+/** The RecurrencePlan, written out by wmmcodeupdate.py so it needs no constexpr loops and can be in PROGMEM.*/
+constexpr
+#ifdef PROGMEM
+    PROGMEM
+#endif /* PROGMEM */
+RecurrencePlan RECURRENCE_PLAN= {{-1.0,1.0,3.0,5.0,7.0,9.0,11.0,13.0,15.0,17.0,19.0,21.0,23.0,25.0},
+{0.0,1.0,1.5,1.6666666666666667,1.75,1.8,1.8333333333333333,1.8571428571428572,1.875,1.8888888888888888,1.9,1.9090909090909092,1.9166666666666667,1.9230769230769231,0.0,3.0,2.5,2.3333333333333335,2.25,2.2,2.1666666666666665,2.142857142857143,2.125,2.111111111111111,2.1,2.090909090909091,2.0833333333333335,0.0,5.0,3.5,3.0,2.75,2.6,2.5,2.4285714285714284,2.375,2.3333333333333335,2.3,2.272727272727273,0.0,7.0,4.5,3.6666666666666665,3.25,3.0,2.8333333333333335,2.7142857142857144,2.625,2.5555555555555554,2.5,0.0,9.0,5.5,4.333333333333333,3.75,3.4,3.1666666666666665,3.0,2.875,2.7777777777777777,0.0,11.0,6.5,5.0,4.25,3.8,3.5,3.2857142857142856,3.125,0.0,13.0,7.5,5.666666666666667,4.75,4.2,3.8333333333333335,3.5714285714285716,0.0,15.0,8.5,6.333333333333333,5.25,4.6,4.166666666666667,0.0,17.0,9.5,7.0,5.75,5.0,0.0,19.0,10.5,7.666666666666667,6.25,0.0,21.0,11.5,8.333333333333334,0.0,23.0,12.5,0.0,25.0,0.0},
+{0.0,0.0,0.5,0.6666666666666666,0.75,0.8,0.8333333333333334,0.8571428571428571,0.875,0.8888888888888888,0.9,0.9090909090909091,0.9166666666666666,0.9230769230769231,0.0,2.0,1.5,1.3333333333333333,1.25,1.2,1.1666666666666667,1.1428571428571428,1.125,1.1111111111111112,1.1,1.0909090909090908,1.0833333333333333,0.0,4.0,2.5,2.0,1.75,1.6,1.5,1.4285714285714286,1.375,1.3333333333333333,1.3,1.2727272727272727,0.0,6.0,3.5,2.6666666666666665,2.25,2.0,1.8333333333333333,1.7142857142857142,1.625,1.5555555555555556,1.5,0.0,8.0,4.5,3.3333333333333335,2.75,2.4,2.1666666666666665,2.0,1.875,1.7777777777777777,0.0,10.0,5.5,4.0,3.25,2.8,2.5,2.2857142857142856,2.125,0.0,12.0,6.5,4.666666666666667,3.75,3.2,2.8333333333333335,2.5714285714285716,0.0,14.0,7.5,5.333333333333333,4.25,3.6,3.1666666666666665,0.0,16.0,8.5,6.0,4.75,4.0,0.0,18.0,9.5,6.666666666666667,5.25,0.0,20.0,10.5,7.333333333333333,0.0,22.0,11.5,0.0,24.0,0.0}};
+
+/** The coefficients of each V,W term in the three field components, made by derivativeCoeffs.
+The integer factors of the derivatives, the sign, and the conversion from nT to T are folded in,
+so the field is just the sum over the terms of
+    x: XV*V+XW*W, y: YV*V+YW*W, z: ZV*V+ZW*W
+Uses 6*NUMTERMS numbers of ram.*/
+struct DerivativeCoeffs{
+    float dyear;//decimal year the coefficients are resolved at
+    TPrecision XV[NUMTERMS];
+    TPrecision XW[NUMTERMS];
+    TPrecision YV[NUMTERMS];
+    TPrecision YW[NUMTERMS];
+    TPrecision ZV[NUMTERMS];
+    TPrecision ZW[NUMTERMS];
+};
+
+/** Return the derivative coefficients of a snapshot.*/
+inline DerivativeCoeffs derivativeCoeffs(const ModelSnapshot& snapshot){
+    DerivativeCoeffs coeffs;
+    coeffs.dyear= snapshot.dyear;
+    for (int m = 0; m <= NMAX+1; m++){
+        for (int n = m; n <= NMAX+1; n++){
+            TPrecision xv= 0;
+            TPrecision xw= 0;
+            TPrecision yv= 0;
+            TPrecision yw= 0;
+            TPrecision zv= 0;
+            TPrecision zw= 0;
+            if (m<NMAX && n>=m+2){
+                TPrecision k= 0.5f*(n-m)*(n-m-1);
+                xv+= k*snapshot.C(n-1,m+1);
+                xw+= k*snapshot.S(n-1,m+1);
+                yv+= k*snapshot.S(n-1,m+1);
+                yw+= -k*snapshot.C(n-1,m+1);
+            }
+            if (n>=2 && m>=2){
+                xv+= -0.5f*snapshot.C(n-1,m-1);
+                xw+= -0.5f*snapshot.S(n-1,m-1);
+                yv+= 0.5f*snapshot.S(n-1,m-1);
+                yw+= -0.5f*snapshot.C(n-1,m-1);
+            }
+            if (m==1 && n>=2){
+                xv+= -snapshot.C(n-1,0);
+                yw+= -snapshot.C(n-1,0);
+            }
+            if (n>=2 && n>m){
+                zv+= -(n-m)*snapshot.C(n-1,m);
+                zw+= -(n-m)*snapshot.S(n-1,m);
+            }
+            int index= termIndex(n,m);
+            coeffs.XV[index]= -1.0E-9f*xv;
+            coeffs.XW[index]= -1.0E-9f*xw;
+            coeffs.YV[index]= -1.0E-9f*yv;
+            coeffs.YW[index]= -1.0E-9f*yw;
+            coeffs.ZV[index]= -1.0E-9f*zv;
+            coeffs.ZW[index]= -1.0E-9f*zw;
+        }
+    }
+    return coeffs;
+}
+
 //mean radius of  ellipsoid in meters from section 1.2 of the WMM2015 Technical report
 constexpr TPrecision EARTH_R= 6371200.0;
 
@@ -104,24 +271,39 @@ typedef struct {
     // of the field, a eastward magnetic field of true North is positive (deg)
 } Elements;
 
-/** Return a struct containing the 7 magnetic elements.
-See https://www.geomag.nrcan.gc.ca/mag_fld/comp-en.php and
-https://www.ngdc.noaa.gov/geomag/icons/faqelems.gif for more info.
+/** Sines and cosines of a latitude and longitude, made by latLonTrig,
+so the conversions that need them can share one set of trig calls.*/
+typedef struct {
+    TPrecision sphi;// sin of latitude
+    TPrecision cphi;// cos of latitude
+    TPrecision slam;// sin of longitude
+    TPrecision clam;// cos of longitude
+} LatLonTrig;
+
+/** Return the sines and cosines of a latitude and longitude.
  INPUT:
-    mag_field_itrs: local magnetic field in the itrs coordinate system (T)
     lat: latitude in degrees, -90 at the south pole, 90 at the north pole.
     lon: longitude in degrees.
 **/
-inline Elements magField2Elements(Vector mag_field_itrs, TPrecision lat, TPrecision lon){
-    TPrecision x = mag_field_itrs.x*1E9f;
-    TPrecision y = mag_field_itrs.y*1E9f;
-    TPrecision z = mag_field_itrs.z*1E9f;
+inline LatLonTrig latLonTrig(TPrecision lat, TPrecision lon){
     TPrecision phi = lat*((TPrecision)(M_PI/180.0));
     TPrecision lam = lon*((TPrecision)(M_PI/180.0));
-    TPrecision sphi = std::sin(phi);
-    TPrecision cphi = std::cos(phi);
-    TPrecision slam = std::sin(lam);
-    TPrecision clam = std::cos(lam);
+    return {std::sin(phi), std::cos(phi), std::sin(lam), std::cos(lam)};
+}
+
+/** Return a struct containing the 7 magnetic elements.
+ INPUT:
+    mag_field_itrs_nT: local magnetic field in the itrs coordinate system (nT)
+    trig: sines and cosines of the latitude and longitude, from latLonTrig.
+**/
+inline Elements magFieldNT2Elements(Vector mag_field_itrs_nT, const LatLonTrig& trig){
+    TPrecision x = mag_field_itrs_nT.x;
+    TPrecision y = mag_field_itrs_nT.y;
+    TPrecision z = mag_field_itrs_nT.z;
+    TPrecision sphi = trig.sphi;
+    TPrecision cphi = trig.cphi;
+    TPrecision slam = trig.slam;
+    TPrecision clam = trig.clam;
     TPrecision x1 = clam*x + slam*y;
     TPrecision north = -sphi*x1 + cphi*z;
     TPrecision east = -slam*x + clam*y;
@@ -133,41 +315,152 @@ inline Elements magField2Elements(Vector mag_field_itrs, TPrecision lat, TPrecis
     return {north, east, down, horizontal, total, inclination, declination};
 }
 
+/** Return a struct containing the 7 magnetic elements.
+See https://www.geomag.nrcan.gc.ca/mag_fld/comp-en.php and
+https://www.ngdc.noaa.gov/geomag/icons/faqelems.gif for more info.
+ INPUT:
+    mag_field_itrs: local magnetic field in the itrs coordinate system (T)
+    lat: latitude in degrees, -90 at the south pole, 90 at the north pole.
+    lon: longitude in degrees.
+**/
+inline Elements magField2Elements(Vector mag_field_itrs, TPrecision lat, TPrecision lon){
+    Vector mag_field_itrs_nT = {mag_field_itrs.x*1E9f, mag_field_itrs.y*1E9f, mag_field_itrs.z*1E9f};
+    return magFieldNT2Elements(mag_field_itrs_nT, latLonTrig(lat, lon));
+}
+
 
 /** Return the position in International Terrestrial Reference System coordinates, units meters.
 Using the WGS 84 ellipsoid and the algorithm from https://geographiclib.sourceforge.io/
  INPUT:
-    lat: Geodetic latitude in degrees, -90 at the south pole, 90 at the north pole.
-    lon: Geodetic longitude in degrees.
+    trig: sines and cosines of the geodetic latitude and longitude, from latLonTrig.
     h: Height above the WGS 84 ellipsoid in meters.
 **/
-inline Vector geodetic2ecef(TPrecision lat, TPrecision lon, TPrecision h){
-    // Convert to radians
-    TPrecision phi = lat*((TPrecision)(M_PI/180.0));
-    TPrecision lam = lon*((TPrecision)(M_PI/180.0));
+inline Vector geodetic2ecef(const LatLonTrig& trig, TPrecision h){
     // WGS 84 constants
     const TPrecision a = 6378137;
     // const TPrecision f = 1.0/298.257223563;
     const TPrecision e2 = 0.0066943799901413165;//f*(2-f);
     const TPrecision e2m = 0.9933056200098587;//(1-f)*(1-f);
-    TPrecision sphi = std::sin(phi);
-    TPrecision cphi = std::cos(phi);
-    TPrecision slam = std::sin(lam);
-    TPrecision clam = std::cos(lam);
-    TPrecision n = a/std::sqrt(1.0f - e2*(sphi*sphi));
-    TPrecision z = (e2m*n + h) * sphi;
-    TPrecision r = (n + h) * cphi;
-    return {r*clam, r*slam, z};
+    TPrecision n = a/std::sqrt(1.0f - e2*(trig.sphi*trig.sphi));
+    TPrecision z = (e2m*n + h) * trig.sphi;
+    TPrecision r = (n + h) * trig.cphi;
+    return {r*trig.clam, r*trig.slam, z};
+}
+
+/** Return the position in International Terrestrial Reference System coordinates, units meters.
+Using the WGS 84 ellipsoid and the algorithm from https://geographiclib.sourceforge.io/
+ INPUT:
+    lat: Geodetic latitude in degrees, -90 at the south pole, 90 at the north pole.
+    lon: Geodetic longitude in degrees.
+    h: Height above the WGS 84 ellipsoid in meters.
+**/
+inline Vector geodetic2ecef(TPrecision lat, TPrecision lon, TPrecision h){
+    return geodetic2ecef(latLonTrig(lat, lon), h);
 }
 
 
-/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+/** Run the V/W recursion, calling visit(n, m, index, V, W) for every term of degree 0 to top, by m then n.
+index is where the term is stored when the terms up to degree Top are stored by m then n, termIndex for Top NMAX+1.
+GeoMagSeriesNT keeps its own streaming copy, so the embedded path needs no term arrays or plan in ram.
+ INPUT:
+    a, b, f, g: x, y, z and EARTH_R, each times EARTH_R/r^2.
+    V00: The V0,0 term, EARTH_R/r.
+    plan(): RecurrencePlan, or anything with diagAt, fcoefAt and gcoefAt stored by the same index.
+    top(0 to Top): The highest degree of the terms.
+ */
+template <int Top, class Plan, class Visitor>
+inline void recurseTerms(TPrecision a, TPrecision b, TPrecision f, TPrecision g, TPrecision V00, const Plan& plan, int top, Visitor&& visit){
+    TPrecision temp;
+    TPrecision Vtop= V00;//V0,0
+    TPrecision Wtop= 0;//W0,0
+    for (int m = 0; m <= top; m++){
+        if (m!=0){
+            temp= Vtop;
+            Vtop= plan.diagAt(m)*(a*Vtop-b*Wtop);
+            Wtop= plan.diagAt(m)*(a*Wtop+b*temp);
+        }
+        int index= (m*(2*Top-m+1))/2+m;
+        TPrecision Vprev= 0;
+        TPrecision Wprev= 0;
+        TPrecision Vnm= Vtop;
+        TPrecision Wnm= Wtop;
+        visit(m, m, index, Vnm, Wnm);
+        for (int n = m+1; n <= top; n++){
+            index++;
+            TPrecision fc= plan.fcoefAt(index)*f;
+            TPrecision gc= plan.gcoefAt(index)*g;
+            temp= Vnm;
+            Vnm= fc*Vnm - gc*Vprev;
+            Vprev= temp;
+            temp= Wnm;
+            Wnm= fc*Wnm - gc*Wprev;
+            Wprev= temp;
+            visit(n, m, index, Vnm, Wnm);
+        }
+    }
+}
+
+/** Run the V/W recursion at a position, calling visit(n, m, index, V, W) for every term of degree 0 to degree+1,
+with index= termIndex(n,m).
  INPUT:
     position_itrs(Above the surface of earth): The location where the field is predicted, units m.
-    dyear(should be around the epoch of the model): The decimal year, for example 2015.0
-    WMM(): Magnetic field model to use.
+    degree(0 to NMAX): The highest degree of the model to use.
  */
-inline Vector GeoMag(float dyear,Vector position_itrs, const ConstModel& WMM){
+template <class Visitor>
+inline void sphericalTerms(Vector position_itrs, int degree, Visitor&& visit){
+    TPrecision x= position_itrs.x;
+    TPrecision y= position_itrs.y;
+    TPrecision z= position_itrs.z;
+    TPrecision rsqrd= x*x+y*y+z*z;
+    TPrecision temp= EARTH_R/rsqrd;
+    recurseTerms<NMAX+1>(x*temp, y*temp, z*temp, EARTH_R*temp, EARTH_R/std::sqrt(rsqrd), RECURRENCE_PLAN, degree+1, visit);
+}
+
+/** Return the sums of GeoMagSeriesNT, units nT, the field is minus the sums.
+Each V,W term n,m is multiplied by the model coefficients of the derivative formulas of Montenbruck and Gill section 3.2.5.
+ INPUT:
+    model(): Coefficients to use, anything with C(n,m) and S(n,m) like ModelSnapshot or ConstModelAt.
+    V, W(): The V,W terms up to degree degree+1 stored by termIndex, like SphericalBasis.
+    degree(1 to NMAX): The highest degree of the model to use.
+ */
+template <class Model>
+inline Vector seriesSums(const Model& model, const TPrecision* V, const TPrecision* W, int degree){
+    TPrecision px= 0;
+    TPrecision py= 0;
+    TPrecision pz= 0;
+    for (int m = 0; m <= degree+1; m++){
+        for (int n = m; n <= degree+1; n++){
+            TPrecision Vnm= V[termIndex(n,m)];
+            TPrecision Wnm= W[termIndex(n,m)];
+            if (m<NMAX && n>=m+2){
+                px+= 0.5f*(n-m)*(n-m-1)*(model.C(n-1,m+1)*Vnm+model.S(n-1,m+1)*Wnm);
+                py+= 0.5f*(n-m)*(n-m-1)*(-model.C(n-1,m+1)*Wnm+model.S(n-1,m+1)*Vnm);
+            }
+            if (n>=2 && m>=2){
+                px+= 0.5f*(-model.C(n-1,m-1)*Vnm-model.S(n-1,m-1)*Wnm);
+                py+= 0.5f*(-model.C(n-1,m-1)*Wnm+model.S(n-1,m-1)*Vnm);
+            }
+            if (m==1 && n>=2){
+                px+= -model.C(n-1,0)*Vnm;
+                py+= -model.C(n-1,0)*Wnm;
+            }
+            if (n>=2 && n>m){
+                pz+= (n-m)*(-model.C(n-1,m)*Vnm-model.S(n-1,m)*Wnm);
+            }
+        }
+    }
+    return {px,py,pz};
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units nT.
+Only the terms of the model up to degree Degree are used.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    model(): Coefficients to use, anything with C(n,m) and S(n,m) like ModelSnapshot or ConstModelAt.
+ */
+template <int Degree, class Model>
+inline Vector GeoMagSeriesNT(Vector position_itrs, const Model& model){
+    static_assert(Degree>=1 && Degree<=NMAX, "Degree must be from 1 to NMAX");
     TPrecision x= position_itrs.x;
     TPrecision y= position_itrs.y;
     TPrecision z= position_itrs.z;
@@ -191,10 +484,10 @@ inline Vector GeoMag(float dyear,Vector position_itrs, const ConstModel& WMM){
     TPrecision Wnm= Wtop;
 
     //iterate through all ms
-    for ( m = 0; m <= NMAX+1; m++)
+    for ( m = 0; m <= Degree+1; m++)
     {
         // iterate through all ns
-        for (n = m; n <= NMAX+1; n++)
+        for (n = m; n <= Degree+1; n++)
         {
             if (n==m){
                 if(m!=0){
@@ -217,23 +510,334 @@ inline Vector GeoMag(float dyear,Vector position_itrs, const ConstModel& WMM){
                 Wprev= temp;
             }
             if (m<NMAX && n>=m+2){
-                px+= 0.5f*(n-m)*(n-m-1)*(WMM.C(n-1,m+1,dyear)*Vnm+WMM.S(n-1,m+1,dyear)*Wnm);
-                py+= 0.5f*(n-m)*(n-m-1)*(-WMM.C(n-1,m+1,dyear)*Wnm+WMM.S(n-1,m+1,dyear)*Vnm);
+                px+= 0.5f*(n-m)*(n-m-1)*(model.C(n-1,m+1)*Vnm+model.S(n-1,m+1)*Wnm);
+                py+= 0.5f*(n-m)*(n-m-1)*(-model.C(n-1,m+1)*Wnm+model.S(n-1,m+1)*Vnm);
             }
             if (n>=2 && m>=2){
-                px+= 0.5f*(-WMM.C(n-1,m-1,dyear)*Vnm-WMM.S(n-1,m-1,dyear)*Wnm);
-                py+= 0.5f*(-WMM.C(n-1,m-1,dyear)*Wnm+WMM.S(n-1,m-1,dyear)*Vnm);
+                px+= 0.5f*(-model.C(n-1,m-1)*Vnm-model.S(n-1,m-1)*Wnm);
+                py+= 0.5f*(-model.C(n-1,m-1)*Wnm+model.S(n-1,m-1)*Vnm);
             }
             if (m==1 && n>=2){
-                px+= -WMM.C(n-1,0,dyear)*Vnm;
-                py+= -WMM.C(n-1,0,dyear)*Wnm;
+                px+= -model.C(n-1,0)*Vnm;
+                py+= -model.C(n-1,0)*Wnm;
             }
             if (n>=2 && n>m){
-                pz+= (n-m)*(-WMM.C(n-1,m,dyear)*Vnm-WMM.S(n-1,m,dyear)*Wnm);
+                pz+= (n-m)*(-model.C(n-1,m)*Vnm-model.S(n-1,m)*Wnm);
             }
         }
     }
-    return {-px*1.0E-9f,-py*1.0E-9f,-pz*1E-9f};
+    return {-px,-py,-pz};
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+Only the terms of the model up to degree Degree are used.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    model(): Coefficients to use, anything with C(n,m) and S(n,m) like ModelSnapshot or ConstModelAt.
+ */
+template <int Degree, class Model>
+inline Vector GeoMagSeries(Vector position_itrs, const Model& model){
+    Vector field_nT= GeoMagSeriesNT<Degree>(position_itrs, model);
+    return {field_nT.x*1.0E-9f,field_nT.y*1.0E-9f,field_nT.z*1E-9f};
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+ INPUT:
+    dyear(should be around the epoch of the model): The decimal year, for example 2015.0
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    WMM(): Magnetic field model to use.
+ */
+inline Vector GeoMag(float dyear,Vector position_itrs, const ConstModel& WMM){
+    return GeoMagSeries<NMAX>(position_itrs, ConstModelAt{WMM,dyear});
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+Faster than the ConstModel version when many points share the same time.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    snapshot(): Model coefficients resolved at a time by snapshotModel.
+ */
+inline Vector GeoMag(Vector position_itrs, const ModelSnapshot& snapshot){
+    return GeoMagSeries<NMAX>(position_itrs, snapshot);
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+Only the terms of the model up to degree degree are used.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    coeffs(): Derivative coefficients made by derivativeCoeffs.
+    degree(1 to NMAX): The highest degree of the model to use.
+ */
+inline Vector GeoMag(Vector position_itrs, const DerivativeCoeffs& coeffs, int degree){
+    TPrecision bx= 0;
+    TPrecision by= 0;
+    TPrecision bz= 0;
+    sphericalTerms(position_itrs, degree, [&](int, int, int index, TPrecision Vnm, TPrecision Wnm){
+        bx+= coeffs.XV[index]*Vnm+coeffs.XW[index]*Wnm;
+        by+= coeffs.YV[index]*Vnm+coeffs.YW[index]*Wnm;
+        bz+= coeffs.ZV[index]*Vnm+coeffs.ZW[index]*Wnm;
+    });
+    return {bx,by,bz};
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+Only the terms of the model up to degree Degree are used, see the README for the error of each degree.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    coeffs(): Derivative coefficients made by derivativeCoeffs.
+ */
+template <int Degree>
+inline Vector GeoMag(Vector position_itrs, const DerivativeCoeffs& coeffs){
+    static_assert(Degree>=1 && Degree<=NMAX, "Degree must be from 1 to NMAX");
+    return GeoMag(position_itrs, coeffs, Degree);
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+The fastest scalar version, the inner loop is only multiply-adds using RECURRENCE_PLAN and the derivative coefficients.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    coeffs(): Derivative coefficients made by derivativeCoeffs.
+ */
+inline Vector GeoMag(Vector position_itrs, const DerivativeCoeffs& coeffs){
+    return GeoMag<NMAX>(position_itrs, coeffs);
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+Only the terms of the model up to degree Degree are used, see the README for the error of each degree.
+ INPUT:
+    dyear(should be around the epoch of the model): The decimal year, for example 2015.0
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    WMM(): Magnetic field model to use.
+ */
+template <int Degree>
+inline Vector GeoMag(float dyear,Vector position_itrs, const ConstModel& WMM){
+    return GeoMagSeries<Degree>(position_itrs, ConstModelAt{WMM,dyear});
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+Only the terms of the model up to degree Degree are used, see the README for the error of each degree.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    snapshot(): Model coefficients resolved at a time by snapshotModel.
+ */
+template <int Degree>
+inline Vector GeoMag(Vector position_itrs, const ModelSnapshot& snapshot){
+    return GeoMagSeries<Degree>(position_itrs, snapshot);
+}
+
+constexpr int MODEL_GROUP= 4;//number of coefficient sets in a ModelGroupCoeffs
+
+/** The derivative coefficients of up to MODEL_GROUP models or times, made by modelGroupCoeffs.
+The coefficients of a term are stored together, component then set, so GeoMagModels
+adds all the sets with a fixed length loop the compiler can vectorize.
+Uses 6*MODEL_GROUP*NUMTERMS numbers of ram.*/
+struct ModelGroupCoeffs{
+    int count;//number of sets used
+    TPrecision V[NUMTERMS][3][MODEL_GROUP];//V[t][k][s] is the V coefficient of term t in component k of set s
+    TPrecision W[NUMTERMS][3][MODEL_GROUP];//the same for W, the unused sets are zero
+};
+
+/** Return the number of ModelGroupCoeffs holding count coefficient sets.*/
+constexpr int modelGroups(int count){
+    return (count+MODEL_GROUP-1)/MODEL_GROUP;
+}
+
+/** Pack count coefficient sets into groups of MODEL_GROUP sets. Call once per list of sets.
+ INPUT:
+    coeffs(): Array of count pointers to derivative coefficients made by derivativeCoeffs,
+        for example of different models or times.
+    count(at least 1): Number of coefficient sets.
+ OUTPUT:
+    groups: Array of modelGroups(count) groups, set k is set k%MODEL_GROUP of group k/MODEL_GROUP.
+ */
+inline void modelGroupCoeffs(const DerivativeCoeffs* const* coeffs, int count, ModelGroupCoeffs* groups){
+    for (int first = 0; first < count; first+= MODEL_GROUP){
+        ModelGroupCoeffs& group= groups[first/MODEL_GROUP];
+        group.count= (count-first < MODEL_GROUP) ? count-first : MODEL_GROUP;
+        for (int t = 0; t < NUMTERMS; t++){
+            for (int s = 0; s < MODEL_GROUP; s++){
+                bool used= s < group.count;
+                const DerivativeCoeffs* set= coeffs[used ? first+s : first];
+                group.V[t][0][s]= used ? set->XV[t] : 0;
+                group.V[t][1][s]= used ? set->YV[t] : 0;
+                group.V[t][2][s]= used ? set->ZV[t] : 0;
+                group.W[t][0][s]= used ? set->XW[t] : 0;
+                group.W[t][1][s]= used ? set->YW[t] : 0;
+                group.W[t][2][s]= used ? set->ZW[t] : 0;
+            }
+        }
+    }
+}
+
+/** Calculate the magnetic field of many coefficient sets at one position
+in International Terrestrial Reference System coordinates, units Tesla, sharing one pass of the V/W recursion.
+The first group adds its sets during the recursion, the terms are kept for the later groups,
+each group adds all its sets with six multiply-adds per term, done together for the sets.
+Within rounding of GeoMag(position_itrs, *coeffs[k]) for each set k the groups were made from.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    groups(): Array of modelGroups(count) groups made by modelGroupCoeffs.
+    count: Number of coefficient sets, the count given to modelGroupCoeffs.
+ OUTPUT:
+    fields: Array of count magnetic fields, units Tesla.
+ */
+inline void GeoMagModels(Vector position_itrs, const ModelGroupCoeffs* groups, int count, Vector* fields){
+    TPrecision V[NUMTERMS];
+    TPrecision W[NUMTERMS];
+    TPrecision sums[3*MODEL_GROUP]= {0};
+    sphericalTerms(position_itrs, NMAX, [&](int, int, int index, TPrecision Vnm, TPrecision Wnm){
+        V[index]= Vnm;
+        W[index]= Wnm;
+        const TPrecision* cv= &groups[0].V[index][0][0];
+        const TPrecision* cw= &groups[0].W[index][0][0];
+        for (int j = 0; j < 3*MODEL_GROUP; j++){
+            sums[j]+= cv[j]*Vnm+cw[j]*Wnm;
+        }
+    });
+    for (int first = 0; first < count; first+= MODEL_GROUP){
+        const ModelGroupCoeffs& group= groups[first/MODEL_GROUP];
+        if (first!=0){
+            for (int j = 0; j < 3*MODEL_GROUP; j++){
+                sums[j]= 0;
+            }
+            for (int t = 0; t < NUMTERMS; t++){
+                const TPrecision* cv= &group.V[t][0][0];
+                const TPrecision* cw= &group.W[t][0][0];
+                for (int j = 0; j < 3*MODEL_GROUP; j++){
+                    sums[j]+= cv[j]*V[t]+cw[j]*W[t];
+                }
+            }
+        }
+        for (int s = 0; s < group.count; s++){
+            fields[first+s]= {sums[s], sums[MODEL_GROUP+s], sums[2*MODEL_GROUP+s]};
+        }
+    }
+}
+
+/** Return the 7 magnetic elements at a geodetic position, the same as
+magField2Elements(GeoMag(dyear,geodetic2ecef(lat,lon,h),WMM),lat,lon)
+but with the trig functions of lat and lon called once, and no conversion to Tesla and back.
+ INPUT:
+    dyear(should be around the epoch of the model): The decimal year, for example 2015.0
+    lat: Geodetic latitude in degrees, -90 at the south pole, 90 at the north pole.
+    lon: Geodetic longitude in degrees.
+    h(Above the surface of earth): Height above the WGS 84 ellipsoid in meters.
+    WMM(): Magnetic field model to use.
+ */
+inline Elements GeoMagElements(float dyear, TPrecision lat, TPrecision lon, TPrecision h, const ConstModel& WMM){
+    LatLonTrig trig= latLonTrig(lat, lon);
+    Vector position_itrs= geodetic2ecef(trig, h);
+    return magFieldNT2Elements(GeoMagSeriesNT<NMAX>(position_itrs, ConstModelAt{WMM,dyear}), trig);
+}
+
+/** The magnetic field at one fixed position, made by makeStation.
+The secular variation of the model is linear in time, so the field is
+    main+(dyear-epoch)*secular
+exactly, and field(dyear) only needs three multiply adds.*/
+struct Station{
+    float epoch;//epoch of the model
+    Vector main;//field at the epoch in International Terrestrial Reference System coordinates, units Tesla
+    Vector secular;//change of the field, units Tesla per year
+    /** Return the magnetic field at dyear in International Terrestrial Reference System coordinates, units Tesla.*/
+    inline Vector field(float dyear) const{
+      TPrecision dt= dyear-epoch;
+      return {main.x+dt*secular.x, main.y+dt*secular.y, main.z+dt*secular.z};
+    }
+};
+
+/** Return the Station at a position, the same as GeoMag(dyear,position_itrs,WMM) at any dyear up to rounding.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    WMM(): Magnetic field model to use.
+ */
+inline Station makeStation(Vector position_itrs, const ConstModel& WMM){
+    #ifdef PROGMEM
+      float epoch= pgm_read_float_near(&WMM.epoch);
+    #else
+      float epoch= WMM.epoch;
+    #endif /* PROGMEM */
+    // at the epoch the secular variation term is zero, so C(n,m,epoch) is the main field.
+    return {epoch, GeoMagSeries<NMAX>(position_itrs, ConstModelAt{WMM,epoch}),
+            GeoMagSeries<NMAX>(position_itrs, ConstModelSecular{WMM})};
+}
+
+/** Bounds on the size of each degree of a model, made by truncationBounds.*/
+struct TruncationBounds{
+    float dyear;//decimal year of the coefficients
+    TPrecision K[NMAX+1];//the field of degree n is at most K[n]*(EARTH_R/r)^(n+2), units nT
+};
+
+/** Return the truncation bounds of a snapshot.
+The field of degree n is at most sqrt((n+1)*(2n+1)) times the root sum square of the
+Schmidt semi-normalized coefficients of degree n, times (EARTH_R/r)^(n+2), anywhere at radius r.
+ INPUT:
+    snapshot(): Model coefficients resolved at a time by snapshotModel.
+ */
+inline TruncationBounds truncationBounds(const ModelSnapshot& snapshot){
+    TruncationBounds bounds;
+    bounds.dyear= snapshot.dyear;
+    bounds.K[0]= 0;
+    for (int n = 1; n <= NMAX; n++){
+        double sumsqrd= 0;
+        double factorial_ratio= 1;//(n-m)!/(n+m)!
+        for (int m = 0; m <= n; m++){
+            if (m!=0){
+                factorial_ratio/= (double)(n-m+1)*(n+m);
+            }
+            //undo the un Schmidt semi-normalization done by wmmcodeupdate.py
+            double unnorm= (m==0) ? 1.0 : std::sqrt(2.0*factorial_ratio);
+            double c= snapshot.C(n,m)/unnorm;
+            double s= snapshot.S(n,m)/unnorm;
+            sumsqrd+= c*c+s*s;
+        }
+        bounds.K[n]= std::sqrt((n+1)*(2*n+1)*sumsqrd);
+    }
+    return bounds;
+}
+
+/** Return the lowest degree whose truncation error is at most tolerance, from 1 to NMAX.
+ INPUT:
+    rsqrd(Above the surface of earth): The square of the distance from the center of earth, units m^2.
+    tolerance(>=0): The largest allowed truncation error of the field magnitude, units nT.
+    bounds(): Truncation bounds of the model, made by truncationBounds.
+ */
+inline int truncationDegree(TPrecision rsqrd, TPrecision tolerance, const TruncationBounds& bounds){
+    TPrecision q= EARTH_R/std::sqrt(rsqrd);
+    TPrecision qpow[NMAX+1];//(EARTH_R/r)^(n+2)
+    qpow[0]= q*q;
+    for (int n = 1; n <= NMAX; n++){
+        qpow[n]= qpow[n-1]*q;
+    }
+    TPrecision error= 0;
+    for (int n = NMAX; n > 1; n--){
+        error+= bounds.K[n]*qpow[n];
+        if (error > tolerance){
+            return n;
+        }
+    }
+    return 1;
+}
+
+/** The magnetic field and the degree of the model used to calculate it, returned by GeoMagAdaptive.*/
+typedef struct {
+    Vector field;//units Tesla
+    int degree;//highest degree of the model used, from 1 to NMAX
+} AdaptiveField;
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla,
+using the lowest degree that keeps the truncation error at most tolerance.
+High above the surface the higher degrees are tiny, so far fewer terms are used.
+Rounding error is not included in the tolerance, it is about 0.5 nT in single precision.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    coeffs(): Derivative coefficients made by derivativeCoeffs.
+    bounds(): Truncation bounds of the same model and time, made by truncationBounds.
+    tolerance(>=0): The largest allowed truncation error of the field magnitude, units nT.
+ */
+inline AdaptiveField GeoMagAdaptive(Vector position_itrs, const DerivativeCoeffs& coeffs, const TruncationBounds& bounds, TPrecision tolerance){
+    TPrecision rsqrd= position_itrs.x*position_itrs.x+position_itrs.y*position_itrs.y+position_itrs.z*position_itrs.z;
+    int degree= truncationDegree(rsqrd, tolerance, bounds);
+    return {GeoMag(position_itrs, coeffs, degree), degree};
 }
 // Model parameters
 constexpr
@@ -0,0 +1,144 @@
+/*
+MIT License
+
+Copyright (c) 2019 Nathan Zimmerberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+/** \file
+ * \brief The V/W terms of a position, stored so different coefficients can be applied later.
+ * \details The V/W recursion of GeoMag only depends on the position, and the field is linear
+in the coefficients, so after sphericalBasis the field of any model is a dot product
+of the stored terms with the coefficients. Re-evaluating a fixed point set with new coefficients
+then streams through the stored bases without any recursion.
+*/
+#ifndef GEOMAG_BASIS_HPP
+#define GEOMAG_BASIS_HPP
+
+#include <stddef.h>
+#include "XYZgeomag.hpp"
+
+namespace geomag
+{
+constexpr int BASIS_LANES= 4;//number of partial sums of each component in applyBasis
+
+/** The V,W terms of degree 0 to NMAX+1 at one position, made by sphericalBasis.
+Stored by termIndex, the same order as DerivativeCoeffs. Uses 2*NUMTERMS numbers of ram.*/
+struct SphericalBasis{
+    TPrecision V[NUMTERMS];
+    TPrecision W[NUMTERMS];
+};
+
+/** Return the V,W terms at a position, the same values GeoMag(position_itrs, coeffs) computes.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+ */
+inline SphericalBasis sphericalBasis(Vector position_itrs){
+    SphericalBasis basis;
+    sphericalTerms(position_itrs, NMAX, [&](int, int, int index, TPrecision Vnm, TPrecision Wnm){
+        basis.V[index]= Vnm;
+        basis.W[index]= Wnm;
+    });
+    return basis;
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+Within rounding of GeoMag(position_itrs, coeffs) at the position of the basis.
+ INPUT:
+    basis(): V,W terms made by sphericalBasis.
+    coeffs(): Derivative coefficients made by derivativeCoeffs.
+ */
+inline Vector applyBasis(const SphericalBasis& basis, const DerivativeCoeffs& coeffs){
+    // BASIS_LANES partial sums per component, so the compiler can vectorize the dot products
+    TPrecision sx[BASIS_LANES]= {0};
+    TPrecision sy[BASIS_LANES]= {0};
+    TPrecision sz[BASIS_LANES]= {0};
+    // the degree 0 term has no derivative coefficients, skipping it leaves 104 terms for NMAX 12, a multiple of BASIS_LANES
+    int i;
+    for (i = 1; i+BASIS_LANES <= NUMTERMS; i+= BASIS_LANES){
+        for (int j = 0; j < BASIS_LANES; j++){
+            TPrecision V= basis.V[i+j];
+            TPrecision W= basis.W[i+j];
+            sx[j]+= coeffs.XV[i+j]*V+coeffs.XW[i+j]*W;
+            sy[j]+= coeffs.YV[i+j]*V+coeffs.YW[i+j]*W;
+            sz[j]+= coeffs.ZV[i+j]*V+coeffs.ZW[i+j]*W;
+        }
+    }
+    for (; i < NUMTERMS; i++){
+        TPrecision V= basis.V[i];
+        TPrecision W= basis.W[i];
+        sx[0]+= coeffs.XV[i]*V+coeffs.XW[i]*W;
+        sy[0]+= coeffs.YV[i]*V+coeffs.YW[i]*W;
+        sz[0]+= coeffs.ZV[i]*V+coeffs.ZW[i]*W;
+    }
+    TPrecision bx= 0;
+    TPrecision by= 0;
+    TPrecision bz= 0;
+    for (int j = 0; j < BASIS_LANES; j++){
+        bx+= sx[j];
+        by+= sy[j];
+        bz+= sz[j];
+    }
+    return {bx,by,bz};
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+Uses the same sums as GeoMagSeries, so it works for coefficients that haven't been resolved with derivativeCoeffs.
+ INPUT:
+    basis(): V,W terms made by sphericalBasis.
+    model(): Coefficients to use, anything with C(n,m) and S(n,m) like ModelSnapshot or ConstModelAt.
+ */
+template <class Model>
+inline Vector applyBasis(const SphericalBasis& basis, const Model& model){
+    Vector sums= seriesSums(model, basis.V, basis.W, NMAX);
+    return {-sums.x*1.0E-9f,-sums.y*1.0E-9f,-sums.z*1.0E-9f};
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+Within rounding of GeoMag(dyear, position_itrs, WMM) at the position of the basis.
+ INPUT:
+    basis(): V,W terms made by sphericalBasis.
+    dyear(should be around the epoch of the model): The decimal year, for example 2015.0
+    WMM(): Magnetic field model to use.
+ */
+inline Vector applyBasis(const SphericalBasis& basis, float dyear, const ConstModel& WMM){
+    return applyBasis(basis, ConstModelAt{WMM,dyear});
+}
+
+/** Calculate the magnetic field at many stored bases in International Terrestrial Reference System coordinates, units Tesla.
+ INPUT:
+    bases(): Array of count V,W terms made by sphericalBasis.
+    count: Number of points.
+    coeffs(): Derivative coefficients made by derivativeCoeffs, shared by all points.
+ OUTPUT:
+    bx, by, bz: Arrays of count magnetic field components, units Tesla.
+ */
+inline void applyBasis(const SphericalBasis* bases, size_t count, const DerivativeCoeffs& coeffs, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    for (size_t i = 0; i < count; i++){
+        Vector field= applyBasis(bases[i], coeffs);
+        bx[i]= field.x;
+        by[i]= field.y;
+        bz[i]= field.z;
+    }
+}
+}
+#endif /* GEOMAG_BASIS_HPP */
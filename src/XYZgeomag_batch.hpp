@@ -0,0 +1,269 @@
+/*
+MIT License
+
+Copyright (c) 2019 Nathan Zimmerberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/** \file
+ * \brief Batched structure-of-arrays version of geomag::GeoMag for large point sets.
+ * \details Intended for host processing, the block state uses a few kB of stack.
+
+Points are advanced through the V/W recursion BATCH_BLOCK at a time,
+with the recursion state of each point stored in contiguous arrays,
+so the inner loops over points have no branches and can be vectorized by the compiler.
+The coefficients are resolved once per call with derivativeCoeffs instead of once per point,
+so the inner loops are only the multiply-adds of the recursion and the field sums.
+*/
+#ifndef GEOMAG_BATCH_HPP
+#define GEOMAG_BATCH_HPP
+
+#include <stddef.h>
+#include "XYZgeomag.hpp"
+
+namespace geomag
+{
+constexpr int BATCH_BLOCK= 64;//number of points advanced together through the recursion
+
+/** A batch kernel with the interface of GeoMagBatch, for example geomag::avx2::GeoMagBatch.*/
+typedef void (*BatchKernel)(const TPrecision* x, const TPrecision* y, const TPrecision* z, size_t count, const DerivativeCoeffs& coeffs, TPrecision* bx, TPrecision* by, TPrecision* bz);
+
+/** Calculate the magnetic field of Sets coefficient sets at count<=BATCH_BLOCK points,
+sharing one pass of the recursion, see GeoMagBatch.
+ INPUT:
+    x, y, z(Above the surface of earth): Arrays of count position components, units m.
+    count(at most BATCH_BLOCK): Number of points.
+    coeffs(): Sets pointers to derivative coefficients.
+ OUTPUT:
+    sums: sums[s][0], sums[s][1], sums[s][2] are the x, y, z field components of coeffs[s] at the points.
+ */
+template <int Sets>
+inline void GeoMagBlockSums(const TPrecision* x, const TPrecision* y, const TPrecision* z, int count, const DerivativeCoeffs* const* coeffs, TPrecision (*sums)[3][BATCH_BLOCK]){
+    const RecurrencePlan& plan= RECURRENCE_PLAN;
+    TPrecision a[BATCH_BLOCK];
+    TPrecision b[BATCH_BLOCK];
+    TPrecision f[BATCH_BLOCK];
+    TPrecision g[BATCH_BLOCK];
+    TPrecision Vtop[BATCH_BLOCK];
+    TPrecision Wtop[BATCH_BLOCK];
+    TPrecision Vprev[BATCH_BLOCK];
+    TPrecision Wprev[BATCH_BLOCK];
+    TPrecision Vnm[BATCH_BLOCK];
+    TPrecision Wnm[BATCH_BLOCK];
+    TPrecision xv[Sets], xw[Sets], yv[Sets], yw[Sets], zv[Sets], zw[Sets];
+    int i,n,m,s;
+    for (i = 0; i < count; i++){
+        TPrecision rsqrd= x[i]*x[i]+y[i]*y[i]+z[i]*z[i];
+        TPrecision temp= EARTH_R/rsqrd;
+        a[i]= x[i]*temp;
+        b[i]= y[i]*temp;
+        f[i]= z[i]*temp;
+        g[i]= EARTH_R*temp;
+        for (s = 0; s < Sets; s++){
+            sums[s][0][i]= 0;
+            sums[s][1][i]= 0;
+            sums[s][2][i]= 0;
+        }
+        Vtop[i]= EARTH_R/std::sqrt(rsqrd);//V0,0
+        Wtop[i]= 0;//W0,0
+    }
+
+    auto load= [&](int index){
+        for (s = 0; s < Sets; s++){
+            xv[s]= coeffs[s]->XV[index];
+            xw[s]= coeffs[s]->XW[index];
+            yv[s]= coeffs[s]->YV[index];
+            yw[s]= coeffs[s]->YW[index];
+            zv[s]= coeffs[s]->ZV[index];
+            zw[s]= coeffs[s]->ZW[index];
+        }
+    };
+    for (m = 0; m <= NMAX+1; m++){
+        TPrecision diag= plan.diag[m];
+        int index= termIndex(m,m);
+        load(index);
+        if (m!=0){
+            for (i = 0; i < count; i++){
+                TPrecision temp= Vtop[i];
+                Vtop[i]= diag*(a[i]*Vtop[i]-b[i]*Wtop[i]);
+                Wtop[i]= diag*(a[i]*Wtop[i]+b[i]*temp);
+            }
+        }
+        for (i = 0; i < count; i++){
+            Vprev[i]= 0;
+            Wprev[i]= 0;
+            Vnm[i]= Vtop[i];
+            Wnm[i]= Wtop[i];
+            for (s = 0; s < Sets; s++){
+                sums[s][0][i]+= xv[s]*Vnm[i]+xw[s]*Wnm[i];
+                sums[s][1][i]+= yv[s]*Vnm[i]+yw[s]*Wnm[i];
+                sums[s][2][i]+= zv[s]*Vnm[i]+zw[s]*Wnm[i];
+            }
+        }
+        for (n = m+1; n <= NMAX+1; n++){
+            index++;
+            TPrecision fcoef= plan.fcoef[index];
+            TPrecision gcoef= plan.gcoef[index];
+            load(index);
+            for (i = 0; i < count; i++){
+                TPrecision fc= fcoef*f[i];
+                TPrecision gc= gcoef*g[i];
+                TPrecision temp= Vnm[i];
+                Vnm[i]= fc*Vnm[i] - gc*Vprev[i];
+                Vprev[i]= temp;
+                temp= Wnm[i];
+                Wnm[i]= fc*Wnm[i] - gc*Wprev[i];
+                Wprev[i]= temp;
+                for (s = 0; s < Sets; s++){
+                    sums[s][0][i]+= xv[s]*Vnm[i]+xw[s]*Wnm[i];
+                    sums[s][1][i]+= yv[s]*Vnm[i]+yw[s]*Wnm[i];
+                    sums[s][2][i]+= zv[s]*Vnm[i]+zw[s]*Wnm[i];
+                }
+            }
+        }
+    }
+}
+
+/** Calculate the magnetic field at count<=BATCH_BLOCK points, see GeoMagBatch.*/
+inline void GeoMagBlock(const TPrecision* x, const TPrecision* y, const TPrecision* z, int count, const DerivativeCoeffs& coeffs, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    const DerivativeCoeffs* sets[1]= {&coeffs};
+    TPrecision sums[1][3][BATCH_BLOCK];
+    GeoMagBlockSums<1>(x, y, z, count, sets, sums);
+    for (int i = 0; i < count; i++){
+        bx[i]= sums[0][0][i];
+        by[i]= sums[0][1][i];
+        bz[i]= sums[0][2][i];
+    }
+}
+
+/** Calculate the magnetic field at many points in International Terrestrial Reference System coordinates, units Tesla.
+Gives the same results as calling GeoMag(position_itrs, coeffs) on each point.
+ INPUT:
+    x, y, z(Above the surface of earth): Arrays of count position components, units m.
+    count: Number of points.
+    coeffs(): Derivative coefficients made by derivativeCoeffs, shared by all points.
+ OUTPUT:
+    bx, by, bz: Arrays of count magnetic field components, units Tesla.
+ */
+inline void GeoMagBatch(const TPrecision* x, const TPrecision* y, const TPrecision* z, size_t count, const DerivativeCoeffs& coeffs, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    for (size_t start= 0; start < count; start+= BATCH_BLOCK){
+        int len= (count-start < BATCH_BLOCK) ? (int)(count-start) : BATCH_BLOCK;
+        GeoMagBlock(x+start, y+start, z+start, len, coeffs, bx+start, by+start, bz+start);
+    }
+}
+
+/** Calculate the magnetic field at many points in International Terrestrial Reference System coordinates, units Tesla.
+ INPUT:
+    x, y, z(Above the surface of earth): Arrays of count position components, units m.
+    count: Number of points.
+    snapshot(): Model coefficients resolved at a time by snapshotModel, shared by all points.
+ OUTPUT:
+    bx, by, bz: Arrays of count magnetic field components, units Tesla.
+ */
+inline void GeoMagBatch(const TPrecision* x, const TPrecision* y, const TPrecision* z, size_t count, const ModelSnapshot& snapshot, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    DerivativeCoeffs coeffs= derivativeCoeffs(snapshot);
+    GeoMagBatch(x, y, z, count, coeffs, bx, by, bz);
+}
+
+/** Calculate the magnetic field at many points in International Terrestrial Reference System coordinates, units Tesla.
+Gives the same results as calling GeoMag(position_itrs, derivativeCoeffs(snapshotModel(dyear, WMM))) on each point.
+That differs from GeoMag(dyear, position_itrs, WMM) only by rounding, because the factors of each term are folded
+into the coefficients ahead of time: up to about 0.13 nT in single precision and 1E-9 nT in double precision.
+ INPUT:
+    dyear(should be around the epoch of the model): The decimal year, shared by all points.
+    x, y, z(Above the surface of earth): Arrays of count position components, units m.
+    count: Number of points.
+    WMM(): Magnetic field model to use.
+ OUTPUT:
+    bx, by, bz: Arrays of count magnetic field components, units Tesla.
+ */
+inline void GeoMagBatch(float dyear, const TPrecision* x, const TPrecision* y, const TPrecision* z, size_t count, const ConstModel& WMM, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    GeoMagBatch(x, y, z, count, snapshotModel(dyear, WMM), bx, by, bz);
+}
+
+/** The derivative coefficients of a model at its epoch and of its secular variation, made by timeLinearCoeffs.
+The coefficients are linear in time, so the field at dyear is the main field plus (dyear-epoch) times the secular field.
+Uses 12*NUMTERMS numbers of ram.*/
+struct TimeLinearCoeffs{
+    float epoch;//epoch of the model
+    DerivativeCoeffs main;//field at the epoch, units T
+    DerivativeCoeffs secular;//change of the field, units T per year
+};
+
+/** Return the time linear coefficients of a model. Slow, call once per model.*/
+inline TimeLinearCoeffs timeLinearCoeffs(const ConstModel& WMM){
+    TimeLinearCoeffs coeffs;
+    coeffs.epoch= WMM.epoch;
+    coeffs.main= derivativeCoeffs(snapshotModel(WMM.epoch, WMM));
+    ModelSnapshot secular;
+    secular.dyear= WMM.epoch;
+    ConstModelSecular rates= {WMM};
+    for (int m = 0; m <= NMAX; m++){
+        for (int n = m; n <= NMAX; n++){
+            int index= (m*(2*NMAX-m+1))/2+n;
+            secular.Coeff_C[index]= rates.C(n,m);
+            secular.Coeff_S[index]= rates.S(n,m);
+        }
+    }
+    coeffs.secular= derivativeCoeffs(secular);
+    return coeffs;
+}
+
+/** Calculate the magnetic field at many points, each at its own time, in International Terrestrial Reference System coordinates, units Tesla.
+The main and secular fields are summed in one pass of the recursion and combined with the time of each point,
+so the coefficients are never resolved per point. Within rounding of GeoMag(dyear[i], position_itrs, WMM).
+ INPUT:
+    dyear(should be around the epoch of the model): Array of count decimal years.
+    x, y, z(Above the surface of earth): Arrays of count position components, units m.
+    count: Number of points.
+    coeffs(): Time linear coefficients made by timeLinearCoeffs, shared by all points.
+ OUTPUT:
+    bx, by, bz: Arrays of count magnetic field components, units Tesla.
+ */
+inline void GeoMagBatch(const float* dyear, const TPrecision* x, const TPrecision* y, const TPrecision* z, size_t count, const TimeLinearCoeffs& coeffs, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    const DerivativeCoeffs* sets[2]= {&coeffs.main, &coeffs.secular};
+    TPrecision sums[2][3][BATCH_BLOCK];
+    for (size_t start= 0; start < count; start+= BATCH_BLOCK){
+        int len= (count-start < BATCH_BLOCK) ? (int)(count-start) : BATCH_BLOCK;
+        GeoMagBlockSums<2>(x+start, y+start, z+start, len, sets, sums);
+        for (int i = 0; i < len; i++){
+            TPrecision dt= dyear[start+i]-coeffs.epoch;
+            bx[start+i]= sums[0][0][i]+dt*sums[1][0][i];
+            by[start+i]= sums[0][1][i]+dt*sums[1][1][i];
+            bz[start+i]= sums[0][2][i]+dt*sums[1][2][i];
+        }
+    }
+}
+
+/** Calculate the magnetic field at many points, each at its own time, in International Terrestrial Reference System coordinates, units Tesla.
+ INPUT:
+    dyear(should be around the epoch of the model): Array of count decimal years.
+    x, y, z(Above the surface of earth): Arrays of count position components, units m.
+    count: Number of points.
+    WMM(): Magnetic field model to use.
+ OUTPUT:
+    bx, by, bz: Arrays of count magnetic field components, units Tesla.
+ */
+inline void GeoMagBatch(const float* dyear, const TPrecision* x, const TPrecision* y, const TPrecision* z, size_t count, const ConstModel& WMM, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    GeoMagBatch(dyear, x, y, z, count, timeLinearCoeffs(WMM), bx, by, bz);
+}
+}
+#endif /* GEOMAG_BATCH_HPP */
@@ -0,0 +1,361 @@
+/*
+MIT License
+
+Copyright (c) 2019 Nathan Zimmerberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/** \file
+ * \brief Caches of the magnetic field at quantized positions and times, in front of GeoMag.
+ * \details The position and decimal year are rounded to a grid of the chosen resolutions,
+and the field is calculated at the grid point, so a lookup returns the same field
+whether it hits or misses. Both caches never grow past the memory they are made with.
+
+FieldCache is set associative, with CACHE_WAYS entries per set
+and least recently used eviction in each set. Not thread safe.
+
+ConcurrentFieldCache is for many threads. It is split into shards by the hash of the key,
+each with its own statistics. Each slot holds one entry protected by a sequence lock,
+in sets of CACHE_WAYS slots with CLOCK eviction: a hit sets the slot's reference bit,
+and a miss fills an empty slot, or replaces the first slot without a reference bit, clearing the bits it passes.
+Readers never wait: a slot that is being written counts as a miss,
+and a miss that finds its slot being written doesn't store its result.
+*/
+#ifndef GEOMAG_CACHE_HPP
+#define GEOMAG_CACHE_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <cmath>
+#include <vector>
+#include "XYZgeomag.hpp"
+
+namespace geomag
+{
+constexpr int CACHE_WAYS= 4;//entries per set
+
+/** The position and decimal year divided by the cache resolutions and rounded.*/
+struct CacheKey{
+    int64_t x;
+    int64_t y;
+    int64_t z;
+    int64_t t;
+};
+
+/** One cached field.*/
+struct CacheEntry{
+    CacheKey key;
+    Vector field;//units Tesla
+    uint64_t stamp;//time of the last use, 0 if empty
+};
+
+/** A fixed size cache of GeoMag results, used by GeoMagCached.*/
+struct FieldCache{
+    TPrecision resolution;//position grid spacing, units m
+    float dyear_resolution;//decimal year grid spacing, units years
+    size_t setmask;//number of sets minus one, the number of sets is a power of two
+    uint64_t clock;//number of lookups, used to stamp entries
+    uint64_t hits;//lookups found in the cache
+    uint64_t misses;//lookups calculated by GeoMag
+    std::vector<CacheEntry> entries;//set s is entries s*CACHE_WAYS to s*CACHE_WAYS+CACHE_WAYS-1
+
+    /** Make an empty cache.
+     INPUT:
+        bytes: Memory budget of the entries, at least one set of CACHE_WAYS entries is made.
+        resolution(positive): Position grid spacing, units m.
+        dyear_resolution(positive): Decimal year grid spacing, units years.
+     */
+    FieldCache(size_t bytes, TPrecision resolution, float dyear_resolution)
+        : resolution(resolution), dyear_resolution(dyear_resolution), setmask(0), clock(0), hits(0), misses(0){
+        size_t sets= 1;
+        while (2*sets*CACHE_WAYS*sizeof(CacheEntry) <= bytes){
+            sets*= 2;
+        }
+        setmask= sets-1;
+        entries.assign(sets*CACHE_WAYS, CacheEntry());
+    }
+};
+
+/** Return the key of a position and decimal year, with grid spacings resolution(m) and dyear_resolution(years).*/
+inline CacheKey cacheKey(TPrecision resolution, float dyear_resolution, float dyear, Vector position_itrs){
+    return {std::llround(position_itrs.x/resolution), std::llround(position_itrs.y/resolution),
+            std::llround(position_itrs.z/resolution), std::llround(dyear/dyear_resolution)};
+}
+
+/** Return the key of a position and decimal year in cache.*/
+inline CacheKey cacheKey(const FieldCache& cache, float dyear, Vector position_itrs){
+    return cacheKey(cache.resolution, cache.dyear_resolution, dyear, position_itrs);
+}
+
+/** Return a 64 bit hash of key, mixing with the splitmix64 finalizer.*/
+inline uint64_t hashKey(const CacheKey& key){
+    uint64_t h= 0;
+    const int64_t parts[4]= {key.x, key.y, key.z, key.t};
+    for (int64_t part : parts){
+        h= (h^(uint64_t)part)+0x9E3779B97F4A7C15ULL;
+        h= (h^(h>>30))*0xBF58476D1CE4E5B9ULL;
+        h= (h^(h>>27))*0x94D049BB133111EBULL;
+        h= h^(h>>31);
+    }
+    return h;
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla,
+at the grid point of cache nearest to the position and decimal year.
+The result is GeoMag at the grid point, from the cache if it is there.
+The difference from the field at the position is at most the change of the field over
+half a grid spacing in each coordinate, about 0.03 nT per m of resolution at the surface,
+plus the secular variation over half dyear_resolution, up to about 230 nT per year for WMM2020.
+ INPUT:
+    cache(): The cache to use, updated with the result and the hit and miss counters.
+    dyear(should be around the epoch of the model): The decimal year, for example 2015.0
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    WMM(): Magnetic field model to use, all lookups in one cache should use the same model.
+ */
+inline Vector GeoMagCached(FieldCache& cache, float dyear, Vector position_itrs, const ConstModel& WMM){
+    CacheKey key= cacheKey(cache, dyear, position_itrs);
+    CacheEntry* set= &cache.entries[(hashKey(key)&cache.setmask)*CACHE_WAYS];
+    uint64_t stamp= ++cache.clock;
+    CacheEntry* victim= set;
+    for (int i = 0; i < CACHE_WAYS; i++){
+        CacheEntry& entry= set[i];
+        if (entry.stamp!=0 && entry.key.x==key.x && entry.key.y==key.y && entry.key.z==key.z && entry.key.t==key.t){
+            cache.hits++;
+            entry.stamp= stamp;
+            return entry.field;
+        }
+        if (entry.stamp < victim->stamp){
+            victim= &entry;
+        }
+    }
+    cache.misses++;
+    Vector grid_point= {key.x*cache.resolution, key.y*cache.resolution, key.z*cache.resolution};
+    victim->key= key;
+    victim->field= GeoMag(key.t*cache.dyear_resolution, grid_point, WMM);
+    victim->stamp= stamp;
+    return victim->field;
+}
+
+/** Remove all entries of cache and reset its counters.*/
+inline void clearCache(FieldCache& cache){
+    cache.entries.assign(cache.entries.size(), CacheEntry());
+    cache.clock= 0;
+    cache.hits= 0;
+    cache.misses= 0;
+}
+
+/** One entry of a ConcurrentFieldCache. The key and field are atomics read and written relaxed,
+ordered by the sequence number, so a reader that races a writer sees a changed
+sequence number instead of undefined behavior.*/
+struct CacheSlot{
+    std::atomic<uint32_t> seq;//odd while being written, 0 if empty
+    std::atomic<uint32_t> referenced;//CLOCK reference bit, set by hits
+    std::atomic<int64_t> key[4];//x, y, z, t of the CacheKey
+    std::atomic<TPrecision> field[3];//units Tesla
+};
+
+/** Lookup counts of a shard of a ConcurrentFieldCache, or of all shards.*/
+typedef struct {
+    uint64_t hits;//lookups found in the cache
+    uint64_t misses;//lookups calculated by GeoMag
+    uint64_t skipped;//misses not stored because another thread was writing the slot
+} CacheStats;
+
+constexpr size_t CACHE_LINE= 64;//bytes of a cache line
+
+/** Counters of one shard, aligned to a cache line, so shards don't share one.
+Store them with CacheLineAllocator, std::vector only aligns elements to alignof(std::max_align_t) before C++17.*/
+struct alignas(CACHE_LINE) CacheShard{
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> skipped;
+};
+static_assert(sizeof(CacheShard) == CACHE_LINE, "CacheShard must fill one cache line");
+
+/** Allocator for std::vector that starts the elements at a cache line.
+Each block is made with room to move its start to a cache line, and the start of the block is kept just before it.*/
+template <class T>
+struct CacheLineAllocator{
+    typedef T value_type;
+    CacheLineAllocator()= default;
+    template <class U>
+    CacheLineAllocator(const CacheLineAllocator<U>&){}
+    T* allocate(size_t n){
+        void* block= ::operator new(n*sizeof(T)+CACHE_LINE+sizeof(void*));
+        uintptr_t start= ((uintptr_t)block+sizeof(void*)+CACHE_LINE-1) & ~(uintptr_t)(CACHE_LINE-1);
+        ((void**)start)[-1]= block;
+        return (T*)start;
+    }
+    void deallocate(T* p, size_t){
+        ::operator delete(((void**)p)[-1]);
+    }
+};
+template <class T, class U>
+bool operator==(const CacheLineAllocator<T>&, const CacheLineAllocator<U>&){ return true; }
+template <class T, class U>
+bool operator!=(const CacheLineAllocator<T>&, const CacheLineAllocator<U>&){ return false; }
+
+/** A fixed size cache of GeoMag results shared by many threads, used by GeoMagCached.*/
+struct ConcurrentFieldCache{
+    TPrecision resolution;//position grid spacing, units m
+    float dyear_resolution;//decimal year grid spacing, units years
+    size_t shardmask;//number of shards minus one, the number of shards is a power of two
+    size_t setmask;//sets per shard minus one, the sets per shard is a power of two
+    std::vector<CacheShard, CacheLineAllocator<CacheShard>> shards;
+    std::vector<CacheSlot> slots;//set s of shard h is the CACHE_WAYS slots starting at (h*(setmask+1)+s)*CACHE_WAYS
+
+    /** Make an empty cache.
+     INPUT:
+        bytes: Memory budget of the slots, at least one set of CACHE_WAYS slots per shard is made.
+        resolution(positive): Position grid spacing, units m.
+        dyear_resolution(positive): Decimal year grid spacing, units years.
+        numshards(positive): Number of shards, rounded up to a power of two,
+            more shards than threads keeps the statistics counters from being contended.
+     */
+    ConcurrentFieldCache(size_t bytes, TPrecision resolution, float dyear_resolution, size_t numshards= 256)
+        : resolution(resolution), dyear_resolution(dyear_resolution){
+        size_t nshards= 1;
+        while (nshards < numshards){
+            nshards*= 2;
+        }
+        size_t sets= 1;
+        while (2*sets*nshards*CACHE_WAYS*sizeof(CacheSlot) <= bytes){
+            sets*= 2;
+        }
+        shardmask= nshards-1;
+        setmask= sets-1;
+        // value initialization zeros the atomics
+        shards= std::vector<CacheShard, CacheLineAllocator<CacheShard>>(nshards);
+        slots= std::vector<CacheSlot>(nshards*sets*CACHE_WAYS);
+    }
+};
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla,
+at the grid point of cache nearest to the position and decimal year, see GeoMagCached for FieldCache.
+Safe to call from many threads at once, and never waits for other threads.
+ INPUT:
+    cache(): The cache to use, updated with the result and the shard counters.
+    dyear(should be around the epoch of the model): The decimal year, for example 2015.0
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    WMM(): Magnetic field model to use, all lookups in one cache should use the same model.
+ */
+inline Vector GeoMagCached(ConcurrentFieldCache& cache, float dyear, Vector position_itrs, const ConstModel& WMM){
+    CacheKey key= cacheKey(cache.resolution, cache.dyear_resolution, dyear, position_itrs);
+    uint64_t hash= hashKey(key);
+    size_t shardindex= (hash>>32)&cache.shardmask;
+    CacheShard& shard= cache.shards[shardindex];
+    CacheSlot* set= &cache.slots[(shardindex*(cache.setmask+1)+(hash&cache.setmask))*CACHE_WAYS];
+    const int64_t parts[4]= {key.x, key.y, key.z, key.t};
+    for (int w = 0; w < CACHE_WAYS; w++){
+        CacheSlot& slot= set[w];
+        uint32_t seq= slot.seq.load(std::memory_order_acquire);
+        if (seq==0 || (seq&1)!=0){
+            continue;
+        }
+        bool match= true;
+        for (int i = 0; i < 4; i++){
+            match= match && slot.key[i].load(std::memory_order_relaxed)==parts[i];
+        }
+        Vector field= {slot.field[0].load(std::memory_order_relaxed),
+                       slot.field[1].load(std::memory_order_relaxed),
+                       slot.field[2].load(std::memory_order_relaxed)};
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (match && slot.seq.load(std::memory_order_relaxed)==seq){
+            // only write the bit if it changes, so hot slots stay shared between cores
+            if (slot.referenced.load(std::memory_order_relaxed)==0){
+                slot.referenced.store(1, std::memory_order_relaxed);
+            }
+            shard.hits.fetch_add(1, std::memory_order_relaxed);
+            return field;
+        }
+    }
+    shard.misses.fetch_add(1, std::memory_order_relaxed);
+    Vector grid_point= {key.x*cache.resolution, key.y*cache.resolution, key.z*cache.resolution};
+    Vector field= GeoMag(key.t*cache.dyear_resolution, grid_point, WMM);
+    // use an empty slot, or the first without a reference bit
+    CacheSlot* victim= nullptr;
+    for (int w = 0; w < CACHE_WAYS && victim==nullptr; w++){
+        if (set[w].seq.load(std::memory_order_relaxed)==0){
+            victim= &set[w];
+        }
+    }
+    for (int w = 0; w < CACHE_WAYS && victim==nullptr; w++){
+        if (set[w].referenced.load(std::memory_order_relaxed)==0){
+            victim= &set[w];
+        } else {
+            set[w].referenced.store(0, std::memory_order_relaxed);
+        }
+    }
+    if (victim==nullptr){
+        victim= set;
+    }
+    CacheSlot& slot= *victim;
+    uint32_t seq= slot.seq.load(std::memory_order_relaxed);
+    if ((seq&1)==0 && slot.seq.compare_exchange_strong(seq, seq+1, std::memory_order_acquire, std::memory_order_relaxed)){
+        std::atomic_thread_fence(std::memory_order_release);
+        for (int i = 0; i < 4; i++){
+            slot.key[i].store(parts[i], std::memory_order_relaxed);
+        }
+        slot.field[0].store(field.x, std::memory_order_relaxed);
+        slot.field[1].store(field.y, std::memory_order_relaxed);
+        slot.field[2].store(field.z, std::memory_order_relaxed);
+        // skip 0 when the sequence number wraps, so the slot doesn't look empty
+        slot.referenced.store(0, std::memory_order_relaxed);
+        slot.seq.store((seq+2==0) ? 2 : seq+2, std::memory_order_release);
+    } else {
+        shard.skipped.fetch_add(1, std::memory_order_relaxed);
+    }
+    return field;
+}
+
+/** Return the counters of shard shardindex of cache.*/
+inline CacheStats shardStats(const ConcurrentFieldCache& cache, size_t shardindex){
+    const CacheShard& shard= cache.shards[shardindex];
+    return {shard.hits.load(std::memory_order_relaxed), shard.misses.load(std::memory_order_relaxed),
+            shard.skipped.load(std::memory_order_relaxed)};
+}
+
+/** Return the counters of cache summed over the shards.*/
+inline CacheStats cacheStats(const ConcurrentFieldCache& cache){
+    CacheStats total= {0, 0, 0};
+    for (size_t s = 0; s < cache.shards.size(); s++){
+        CacheStats stats= shardStats(cache, s);
+        total.hits+= stats.hits;
+        total.misses+= stats.misses;
+        total.skipped+= stats.skipped;
+    }
+    return total;
+}
+
+/** Remove all entries of cache and reset its counters, must not run at the same time as lookups.*/
+inline void clearCache(ConcurrentFieldCache& cache){
+    for (CacheSlot& slot : cache.slots){
+        slot.seq.store(0, std::memory_order_relaxed);
+        slot.referenced.store(0, std::memory_order_relaxed);
+    }
+    for (CacheShard& shard : cache.shards){
+        shard.hits.store(0, std::memory_order_relaxed);
+        shard.misses.store(0, std::memory_order_relaxed);
+        shard.skipped.store(0, std::memory_order_relaxed);
+    }
+}
+}
+#endif /* GEOMAG_CACHE_HPP */
@@ -0,0 +1,217 @@
+/*
+MIT License
+
+Copyright (c) 2019 Nathan Zimmerberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+/** \file
+ * \brief Single point version of geomag::GeoMag with the orders m in parallel lanes, for low latency.
+ * \details The V/W recursion of each order m only depends on the diagonal term V(m,m), W(m,m),
+so after the short diagonal recursion the columns are independent.
+GeoMagColumns advances Lanes columns together, one degree n per step, with the recurrence constants
+and the derivative coefficients of each step interleaved by lane in ColumnCoeffs,
+so the loops over the lanes can be vectorized.
+The columns get shorter with m, the lanes past the end of their column have zero constants and coefficients.
+XYZgeomag_simd.hpp has AVX2 and AVX-512 versions with the lanes in registers.
+*/
+#ifndef GEOMAG_COLUMNS_HPP
+#define GEOMAG_COLUMNS_HPP
+
+#include "XYZgeomag.hpp"
+
+namespace geomag
+{
+/** Return the number of steps of GeoMagColumns with lanes columns per group.*/
+constexpr int columnSteps(int lanes){
+    int steps= 0;
+    for (int m0 = 0; m0 <= NMAX+1; m0+= lanes){
+        steps+= NMAX+2-m0;
+    }
+    return steps;
+}
+
+/** The recurrence constants and derivative coefficients of one step of Lanes columns.*/
+template <int Lanes>
+struct ColumnStep{
+    TPrecision fcoef[Lanes];
+    TPrecision gcoef[Lanes];
+    TPrecision XV[Lanes];
+    TPrecision XW[Lanes];
+    TPrecision YV[Lanes];
+    TPrecision YW[Lanes];
+    TPrecision ZV[Lanes];
+    TPrecision ZW[Lanes];
+};
+
+/** The derivative coefficients interleaved by column, made by columnCoeffs.
+The columns m0 to m0+Lanes-1 of each group take NMAX+2-m0 steps, stored one after the other.
+Uses 8*Lanes*columnSteps(Lanes) numbers of ram.*/
+template <int Lanes>
+struct ColumnCoeffs{
+    ColumnStep<Lanes> steps[columnSteps(Lanes)];
+};
+
+/** Return the derivative coefficients interleaved for GeoMagColumns. Call once per snapshot.*/
+template <int Lanes>
+inline ColumnCoeffs<Lanes> columnCoeffs(const DerivativeCoeffs& coeffs){
+    const RecurrencePlan& plan= RECURRENCE_PLAN;
+    ColumnCoeffs<Lanes> packed;
+    int step= 0;
+    for (int m0 = 0; m0 <= NMAX+1; m0+= Lanes){
+        for (int s = 0; s <= NMAX+1-m0; s++, step++){
+            ColumnStep<Lanes>& out= packed.steps[step];
+            for (int j = 0; j < Lanes; j++){
+                int m= m0+j;
+                int n= m+s;
+                bool used= n <= NMAX+1;
+                int index= used ? termIndex(n,m) : 0;
+                out.fcoef[j]= used ? plan.fcoef[index] : 0;
+                out.gcoef[j]= used ? plan.gcoef[index] : 0;
+                out.XV[j]= used ? coeffs.XV[index] : 0;
+                out.XW[j]= used ? coeffs.XW[index] : 0;
+                out.YV[j]= used ? coeffs.YV[index] : 0;
+                out.YW[j]= used ? coeffs.YW[index] : 0;
+                out.ZV[j]= used ? coeffs.ZV[index] : 0;
+                out.ZW[j]= used ? coeffs.ZW[index] : 0;
+            }
+        }
+    }
+    return packed;
+}
+
+/** The constants of columnSeeds.*/
+struct DiagonalPlan{
+    TPrecision product[NMAX+2];// diag[1]*...*diag[m] of the RecurrencePlan, so V(m,m)+iW(m,m) is product[m]*V(0,0)*(a+ib)^m
+    int split[NMAX+2];// the largest power of two less than m, (a+ib)^m is (a+ib)^split times (a+ib)^(m-split)
+};
+
+/** Return the DiagonalPlan, evaluated at compile time for DIAGONAL_PLAN.*/
+constexpr DiagonalPlan makeDiagonalPlan(){
+    DiagonalPlan plan{};
+    plan.product[0]= 1;
+    for (int m = 1; m <= NMAX+1; m++){
+        plan.product[m]= plan.product[m-1]*(2*m-1);
+        plan.split[m]= 1;
+        while (2*plan.split[m] < m){
+            plan.split[m]*= 2;
+        }
+    }
+    return plan;
+}
+constexpr DiagonalPlan DIAGONAL_PLAN= makeDiagonalPlan();
+
+/** Calculate the diagonal terms V(m,m), W(m,m) for m from 0 to NMAX+1, the first term of each column.
+(a+ib)^m is made by multiplying two lower powers, log2(m) complex multiplies deep
+instead of the m deep chain of the diagonal recursion, to shorten the latency of a single point.
+ INPUT:
+    a, b: x*EARTH_R/r^2, y*EARTH_R/r^2.
+    V00: EARTH_R/r.
+ OUTPUT:
+    Vtop, Wtop: Arrays of at least NMAX+2 diagonal terms.
+ */
+inline void columnSeeds(TPrecision a, TPrecision b, TPrecision V00, TPrecision* Vtop, TPrecision* Wtop){
+    TPrecision re[NMAX+2];
+    TPrecision im[NMAX+2];
+    re[0]= 1;
+    im[0]= 0;
+    re[1]= a;
+    im[1]= b;
+    for (int m = 2; m <= NMAX+1; m++){
+        int p= DIAGONAL_PLAN.split[m];
+        int q= m-p;
+        re[m]= re[p]*re[q]-im[p]*im[q];
+        im[m]= re[p]*im[q]+im[p]*re[q];
+    }
+    for (int m = 0; m <= NMAX+1; m++){
+        TPrecision scale= DIAGONAL_PLAN.product[m]*V00;
+        Vtop[m]= scale*re[m];
+        Wtop[m]= scale*im[m];
+    }
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+Within rounding of GeoMag(position_itrs, coeffs) for the coefficients the columns were made from.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    columns(): Derivative coefficients made by columnCoeffs.
+ */
+template <int Lanes>
+inline Vector GeoMagColumns(Vector position_itrs, const ColumnCoeffs<Lanes>& columns){
+    constexpr int GROUPS= (NMAX+2+Lanes-1)/Lanes;
+    TPrecision x= position_itrs.x;
+    TPrecision y= position_itrs.y;
+    TPrecision z= position_itrs.z;
+    TPrecision rsqrd= x*x+y*y+z*z;
+    TPrecision temp= EARTH_R/rsqrd;
+    TPrecision a= x*temp;
+    TPrecision b= y*temp;
+    TPrecision f= z*temp;
+    TPrecision g= EARTH_R*temp;
+
+    // the diagonal terms, the first term of each column, zero past the last column
+    TPrecision Vtop[GROUPS*Lanes]= {0};
+    TPrecision Wtop[GROUPS*Lanes]= {0};
+    columnSeeds(a, b, EARTH_R/std::sqrt(rsqrd), Vtop, Wtop);
+    TPrecision bx[Lanes]= {0};
+    TPrecision by[Lanes]= {0};
+    TPrecision bz[Lanes]= {0};
+    const ColumnStep<Lanes>* step= columns.steps;
+    for (int m0 = 0; m0 <= NMAX+1; m0+= Lanes){
+        TPrecision Vnm[Lanes];
+        TPrecision Wnm[Lanes];
+        TPrecision Vprev[Lanes]= {0};
+        TPrecision Wprev[Lanes]= {0};
+        for (int j = 0; j < Lanes; j++){
+            Vnm[j]= Vtop[m0+j];
+            Wnm[j]= Wtop[m0+j];
+            bx[j]+= step->XV[j]*Vnm[j]+step->XW[j]*Wnm[j];
+            by[j]+= step->YV[j]*Vnm[j]+step->YW[j]*Wnm[j];
+            bz[j]+= step->ZV[j]*Vnm[j]+step->ZW[j]*Wnm[j];
+        }
+        step++;
+        for (int s = 1; s <= NMAX+1-m0; s++, step++){
+            for (int j = 0; j < Lanes; j++){
+                TPrecision fc= step->fcoef[j]*f;
+                TPrecision gc= step->gcoef[j]*g;
+                TPrecision V= fc*Vnm[j] - gc*Vprev[j];
+                TPrecision W= fc*Wnm[j] - gc*Wprev[j];
+                Vprev[j]= Vnm[j];
+                Wprev[j]= Wnm[j];
+                Vnm[j]= V;
+                Wnm[j]= W;
+                bx[j]+= step->XV[j]*V+step->XW[j]*W;
+                by[j]+= step->YV[j]*V+step->YW[j]*W;
+                bz[j]+= step->ZV[j]*V+step->ZW[j]*W;
+            }
+        }
+    }
+    Vector field= {0, 0, 0};
+    for (int j = 0; j < Lanes; j++){
+        field.x+= bx[j];
+        field.y+= by[j];
+        field.z+= bz[j];
+    }
+    return field;
+}
+}
+#endif /* GEOMAG_COLUMNS_HPP */
@@ -0,0 +1,200 @@
+/*
+MIT License
+
+Copyright (c) 2019 Nathan Zimmerberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/** \file
+ * \brief Run time choice between the scalar, SSE2, AVX2, and AVX-512 kernels.
+ * \details For one binary shipped to CPUs with different instruction sets.
+The instruction sets are detected once, on the first call of dispatch::kernels(),
+and the batch and single point calls in namespace geomag::dispatch go to the fastest kernels the CPU supports.
+Setting the environment variable XYZGEOMAG_KERNEL to scalar, sse, avx2, or avx512 overrides the choice, for benchmarking.
+An override the CPU doesn't support is ignored, so it can't cause an illegal instruction.
+Without XYZgeomag_HAVE_SIMD only the scalar kernels are available.
+*/
+#ifndef GEOMAG_DISPATCH_HPP
+#define GEOMAG_DISPATCH_HPP
+
+#include <stdlib.h>
+#include <string.h>
+#include "XYZgeomag_simd.hpp"
+
+namespace geomag
+{
+namespace dispatch
+{
+/** The instruction sets with kernels, from slowest to fastest.*/
+enum Isa{
+    ISA_SCALAR,
+    ISA_SSE,
+    ISA_AVX2,
+    ISA_AVX512
+};
+constexpr int NUM_ISAS= 4;
+
+/** Return the name of isa, as used by XYZGEOMAG_KERNEL.*/
+inline const char* isaName(Isa isa){
+    static const char* const names[NUM_ISAS]= {"scalar", "sse", "avx2", "avx512"};
+    return names[isa];
+}
+
+/** Return true if the running CPU supports the kernels of isa.*/
+inline bool isaSupported(Isa isa){
+#if defined(XYZgeomag_HAVE_SIMD)
+    switch (isa){
+        case ISA_SSE: return sse::supported();
+        case ISA_AVX2: return avx2::supported();
+        case ISA_AVX512: return avx512::supported();
+        default: return true;
+    }
+#else
+    return isa == ISA_SCALAR;
+#endif
+}
+
+/** Return the fastest instruction set the running CPU supports.*/
+inline Isa bestIsa(){
+    for (int isa = NUM_ISAS-1; isa > ISA_SCALAR; isa--){
+        if (isaSupported(Isa(isa))){
+            return Isa(isa);
+        }
+    }
+    return ISA_SCALAR;
+}
+
+/** Return the instruction set named by name, like the value of XYZGEOMAG_KERNEL.
+ INPUT:
+    name: Name from isaName, may be null.
+    fallback: Returned if name is null, unknown, or not supported by the running CPU.
+ */
+inline Isa chooseIsa(const char* name, Isa fallback){
+    if (name == nullptr){
+        return fallback;
+    }
+    for (int isa = 0; isa < NUM_ISAS; isa++){
+        if (strcmp(name, isaName(Isa(isa))) == 0){
+            return isaSupported(Isa(isa)) ? Isa(isa) : fallback;
+        }
+    }
+    return fallback;
+}
+
+/** The coefficients of every single point kernel, made by pointCoeffs. Call once per snapshot.*/
+struct PointCoeffs{
+    DerivativeCoeffs coeffs;
+#if defined(XYZgeomag_HAVE_SIMD)
+    sse::Columns sse;
+    avx2::Columns avx2;
+#endif
+};
+
+/** Return the coefficients of every single point kernel.
+The columns are packed by the portable geomag::columnCoeffs, so this is safe on any CPU.*/
+inline PointCoeffs pointCoeffs(const DerivativeCoeffs& coeffs){
+    PointCoeffs point;
+    point.coeffs= coeffs;
+#if defined(XYZgeomag_HAVE_SIMD)
+    point.sse= geomag::columnCoeffs<sse::L::WIDTH>(coeffs);
+    point.avx2= geomag::columnCoeffs<avx2::L::WIDTH>(coeffs);
+#endif
+    return point;
+}
+
+/** A single point kernel with the interface of dispatch::GeoMag.*/
+typedef Vector (*PointKernel)(Vector position_itrs, const PointCoeffs& coeffs);
+
+/** The kernels of one instruction set, made by kernelsFor.*/
+struct Kernels{
+    Isa isa;
+    BatchKernel batch;
+    PointKernel point;
+};
+
+/** The single point kernels of each instruction set.*/
+inline Vector scalarPoint(Vector position_itrs, const PointCoeffs& coeffs){
+    return geomag::GeoMag(position_itrs, coeffs.coeffs);
+}
+#if defined(XYZgeomag_HAVE_SIMD)
+inline Vector ssePoint(Vector position_itrs, const PointCoeffs& coeffs){
+    return sse::GeoMagColumns(position_itrs, coeffs.sse);
+}
+inline Vector avx2Point(Vector position_itrs, const PointCoeffs& coeffs){
+    return avx2::GeoMagColumns(position_itrs, coeffs.avx2);
+}
+#endif
+
+/** Return the fastest kernels of isa.
+In single precision at -O2 the tiled GeoMagGemm is the fastest batch except with SSE2, where GeoMagBatch is slightly faster,
+and the AVX2 GeoMagColumns has a lower latency than the AVX-512 one, so it is also used with AVX-512,
+if the CPU has AVX2 and FMA too, AVX-512F alone doesn't include them, else the SSE2 one is.
+ INPUT:
+    isa(supported by the running CPU): Instruction set.
+ */
+inline Kernels kernelsFor(Isa isa){
+#if defined(XYZgeomag_HAVE_SIMD)
+    switch (isa){
+        case ISA_SSE: return {ISA_SSE, sse::GeoMagBatch, ssePoint};
+        case ISA_AVX2: return {ISA_AVX2, avx2::GeoMagGemm, avx2Point};
+        case ISA_AVX512: return {ISA_AVX512, avx512::GeoMagGemm, avx2::supported() ? avx2Point : ssePoint};
+        default: break;
+    }
+#endif
+    (void)isa;
+    return {ISA_SCALAR, geomag::GeoMagGemm, scalarPoint};
+}
+
+/** Return the kernels used by the calls in namespace geomag::dispatch,
+chosen on the first call from the running CPU and XYZGEOMAG_KERNEL.*/
+inline const Kernels& kernels(){
+    static const Kernels selected= kernelsFor(chooseIsa(getenv("XYZGEOMAG_KERNEL"), bestIsa()));
+    return selected;
+}
+
+/** Calculate the magnetic field at count points with the selected batch kernel.
+Same interface as geomag::GeoMagBatch.*/
+inline void GeoMagBatch(const TPrecision* x, const TPrecision* y, const TPrecision* z, size_t count, const DerivativeCoeffs& coeffs, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    kernels().batch(x, y, z, count, coeffs, bx, by, bz);
+}
+
+/** Same as above, with the coefficients of a snapshot.*/
+inline void GeoMagBatch(const TPrecision* x, const TPrecision* y, const TPrecision* z, size_t count, const ModelSnapshot& snapshot, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    (GeoMagBatch)(x, y, z, count, derivativeCoeffs(snapshot), bx, by, bz);
+}
+
+/** Same as above, with the coefficients of WMM at dyear.*/
+inline void GeoMagBatch(float dyear, const TPrecision* x, const TPrecision* y, const TPrecision* z, size_t count, const ConstModel& WMM, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    (GeoMagBatch)(x, y, z, count, snapshotModel(dyear, WMM), bx, by, bz);
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla,
+with the selected single point kernel. Within 0.5 nT of geomag::GeoMag(position_itrs, coeffs.coeffs).
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    coeffs(): Coefficients made by pointCoeffs.
+ */
+inline Vector GeoMag(Vector position_itrs, const PointCoeffs& coeffs){
+    return kernels().point(position_itrs, coeffs);
+}
+}
+}
+#endif /* GEOMAG_DISPATCH_HPP */
@@ -0,0 +1,296 @@
+/*
+MIT License
+
+Copyright (c) 2019 Nathan Zimmerberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+/** \file
+ * \brief Magnetic field of an ensemble of perturbed models, for Monte Carlo uncertainty propagation.
+ * \details The field is linear in the model coefficients, so at a point the field of a perturbed model is
+the nominal field plus the sensitivity of the field to each coefficient times the perturbations.
+The perturbations are of the Schmidt semi-normalized Gauss coefficients g(n,m), h(n,m) of the .COF files, units nT,
+the same units as published coefficient uncertainties, not the un-normalized C, S coefficients of ConstModel.
+The V/W recursion and the sensitivities are computed once per point with sphericalBasis and fieldSensitivity,
+then each member is three dot products with its perturbations, with no allocation.
+The perturbations are rows of a matrix, PerturbationMatrix, or drawn from a seeded Gaussian generator, GaussianPerturbations.
+*/
+#ifndef GEOMAG_ENSEMBLE_HPP
+#define GEOMAG_ENSEMBLE_HPP
+
+#include <stdint.h>
+#include <math.h>
+#include "XYZgeomag_basis.hpp"
+
+namespace geomag
+{
+constexpr int ENSEMBLE_COEFFS= 2*NUMCOF;//number of perturbed coefficients of a member, the g coefficients then the h coefficients
+constexpr int ENSEMBLE_LANES= 4;//number of partial sums of each component in perturbationField
+
+/** Return the index of Gauss coefficient g(n,m) in a row of perturbations, add NUMCOF for h(n,m).*/
+constexpr int coeffIndex(int n, int m){
+    return (m*(2*NMAX-m+1))/2+n;
+}
+
+/** The factors sqrt(2(n-m)!/(n+m)!), 1 for m=0, that un Schmidt semi-normalize the Gauss coefficients
+of the .COF files into the C and S coefficients of a ConstModel, like wmmcodeupdate.py.*/
+struct SchmidtFactors{
+    TPrecision factor[NUMCOF];//indexed by coeffIndex
+};
+
+/** Return the un Schmidt semi-normalizing factors, computed once.*/
+inline const SchmidtFactors& schmidtFactors(){
+    static const SchmidtFactors factors= [](){
+        SchmidtFactors f;
+        for (int m = 0; m <= NMAX; m++){
+            for (int n = m; n <= NMAX; n++){
+                double ratio= 1;// (n+m)!/(n-m)!
+                for (int k = n-m+1; k <= n+m; k++){
+                    ratio*= k;
+                }
+                f.factor[coeffIndex(n,m)]= (m==0) ? 1 : sqrt(2/ratio);
+            }
+        }
+        return f;
+    }();
+    return factors;
+}
+
+/** The change of the field at one point for each Gauss coefficient, made by fieldSensitivity.*/
+struct FieldSensitivity{
+    TPrecision dB[3][ENSEMBLE_COEFFS];//dB[k][i] is the change of field component k, units T, per nT of Gauss coefficient i
+};
+
+/** Return the sensitivity of the field to each Gauss coefficient at the position of basis.
+The same sums as applyBasis with a model, differentiated by each coefficient,
+times the Schmidt factors so the perturbations are in the units of the .COF files.
+ INPUT:
+    basis(): V,W terms made by sphericalBasis.
+ */
+inline FieldSensitivity fieldSensitivity(const SphericalBasis& basis){
+    FieldSensitivity sens;
+    for (int k = 0; k < 3; k++){
+        for (int i = 0; i < ENSEMBLE_COEFFS; i++){
+            sens.dB[k][i]= 0;
+        }
+    }
+    TPrecision (&x)[ENSEMBLE_COEFFS]= sens.dB[0];
+    TPrecision (&y)[ENSEMBLE_COEFFS]= sens.dB[1];
+    TPrecision (&z)[ENSEMBLE_COEFFS]= sens.dB[2];
+    for (int m = 0; m <= NMAX+1; m++){
+        for (int n = m; n <= NMAX+1; n++){
+            // the field is -1E-9 times the nT sums of GeoMagSeriesNT
+            TPrecision V= -1.0E-9f*basis.V[termIndex(n,m)];
+            TPrecision W= -1.0E-9f*basis.W[termIndex(n,m)];
+            if (m<NMAX && n>=m+2){
+                TPrecision k= 0.5f*(n-m)*(n-m-1);
+                int c= coeffIndex(n-1,m+1);
+                int s= c+NUMCOF;
+                x[c]+= k*V;
+                x[s]+= k*W;
+                y[c]+= -k*W;
+                y[s]+= k*V;
+            }
+            if (n>=2 && m>=2){
+                int c= coeffIndex(n-1,m-1);
+                int s= c+NUMCOF;
+                x[c]+= -0.5f*V;
+                x[s]+= -0.5f*W;
+                y[c]+= -0.5f*W;
+                y[s]+= 0.5f*V;
+            }
+            if (m==1 && n>=2){
+                int c= coeffIndex(n-1,0);
+                x[c]+= -V;
+                y[c]+= -W;
+            }
+            if (n>=2 && n>m){
+                int c= coeffIndex(n-1,m);
+                int s= c+NUMCOF;
+                z[c]+= -(n-m)*V;
+                z[s]+= -(n-m)*W;
+            }
+        }
+    }
+    const SchmidtFactors& factors= schmidtFactors();
+    for (int k = 0; k < 3; k++){
+        for (int i = 0; i < NUMCOF; i++){
+            sens.dB[k][i]*= factors.factor[i];
+            sens.dB[k][NUMCOF+i]*= factors.factor[i];
+        }
+    }
+    return sens;
+}
+
+/** Return the change of the field for a row of coefficient perturbations, units T.
+ INPUT:
+    sens(): Sensitivity made by fieldSensitivity.
+    delta(): ENSEMBLE_COEFFS Gauss coefficient perturbations, the g coefficients then the h coefficients, units nT.
+ */
+inline Vector perturbationField(const FieldSensitivity& sens, const TPrecision* delta){
+    // ENSEMBLE_LANES partial sums per component, so the compiler can vectorize the dot products
+    TPrecision sx[ENSEMBLE_LANES]= {0};
+    TPrecision sy[ENSEMBLE_LANES]= {0};
+    TPrecision sz[ENSEMBLE_LANES]= {0};
+    int i;
+    for (i = 0; i+ENSEMBLE_LANES <= ENSEMBLE_COEFFS; i+= ENSEMBLE_LANES){
+        for (int j = 0; j < ENSEMBLE_LANES; j++){
+            sx[j]+= sens.dB[0][i+j]*delta[i+j];
+            sy[j]+= sens.dB[1][i+j]*delta[i+j];
+            sz[j]+= sens.dB[2][i+j]*delta[i+j];
+        }
+    }
+    for (; i < ENSEMBLE_COEFFS; i++){
+        sx[0]+= sens.dB[0][i]*delta[i];
+        sy[0]+= sens.dB[1][i]*delta[i];
+        sz[0]+= sens.dB[2][i]*delta[i];
+    }
+    TPrecision bx= 0;
+    TPrecision by= 0;
+    TPrecision bz= 0;
+    for (int j = 0; j < ENSEMBLE_LANES; j++){
+        bx+= sx[j];
+        by+= sy[j];
+        bz+= sz[j];
+    }
+    return {bx,by,bz};
+}
+
+/** The perturbations of each member stored as rows of a matrix.*/
+struct PerturbationMatrix{
+    const TPrecision* rows;//members rows of ENSEMBLE_COEFFS perturbations, the g coefficients then the h coefficients, units nT
+    int members;//number of members
+    /** Return the perturbations of member k, scratch isn't used.*/
+    inline const TPrecision* member(int k, TPrecision* scratch) const{
+        (void)scratch;
+        return rows+(size_t)k*ENSEMBLE_COEFFS;
+    }
+};
+
+/** Independent Gaussian perturbations of each Gauss coefficient, regenerated from the seed,
+so every point of a trajectory sees the same members without storing them.*/
+struct GaussianPerturbations{
+    uint64_t seed;//seed of the generator
+    const TPrecision* sigma;//ENSEMBLE_COEFFS standard deviations, the g coefficients then the h coefficients, units nT
+    int members;//number of members
+    /** Return the perturbations of member k, written to scratch.*/
+    inline const TPrecision* member(int k, TPrecision* scratch) const{
+        // splitmix64 stream of member k, pairs of uniforms turned into pairs of normals by Marsaglia's polar method
+        uint64_t state= seed^((uint64_t)k*0xD1B54A32D192ED03ULL);
+        auto next= [&state](){
+            state+= 0x9E3779B97F4A7C15ULL;
+            uint64_t h= state;
+            h= (h^(h>>30))*0xBF58476D1CE4E5B9ULL;
+            h= (h^(h>>27))*0x94D049BB133111EBULL;
+            h= h^(h>>31);
+            return (int64_t)h*(1.0/9223372036854775808.0);//uniform in [-1,1)
+        };
+        for (int i = 0; i < ENSEMBLE_COEFFS; i+= 2){
+            double u, v, r2;
+            do {
+                u= next();
+                v= next();
+                r2= u*u+v*v;
+            } while (r2 >= 1 || r2 == 0);
+            double scale= sqrt(-2*log(r2)/r2);
+            scratch[i]= sigma[i]*u*scale;
+            scratch[i+1]= sigma[i+1]*v*scale;
+        }
+        return scratch;
+    }
+};
+
+/** Running mean and covariance of the members of an ensemble, updated by addSample with Welford's method.*/
+struct EnsembleStats{
+    int count;//number of samples
+    Vector mean;//mean field, units T
+    TPrecision m2[3][3];//sum of the products of the deviations from the mean, units T^2
+};
+
+/** Add one field to the running statistics.*/
+inline void addSample(EnsembleStats& stats, Vector field){
+    TPrecision sample[3]= {field.x, field.y, field.z};
+    TPrecision mean[3]= {stats.mean.x, stats.mean.y, stats.mean.z};
+    TPrecision before[3];
+    stats.count++;
+    for (int k = 0; k < 3; k++){
+        before[k]= sample[k]-mean[k];
+        mean[k]+= before[k]/stats.count;
+    }
+    for (int k = 0; k < 3; k++){
+        for (int l = 0; l < 3; l++){
+            stats.m2[k][l]+= before[k]*(sample[l]-mean[l]);
+        }
+    }
+    stats.mean= {mean[0], mean[1], mean[2]};
+}
+
+/** Return the sample covariance of field components k and l, units T^2, needs at least 2 samples.*/
+inline TPrecision ensembleCovariance(const EnsembleStats& stats, int k, int l){
+    return stats.m2[k][l]/(stats.count-1);
+}
+
+/** Calculate the magnetic field of each member of an ensemble at one position
+in International Terrestrial Reference System coordinates, units Tesla.
+Within rounding of GeoMag with the nominal coefficients plus the un-normalized perturbations of each member.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    nominal(): Nominal coefficients, anything with C(n,m) and S(n,m) like ModelSnapshot or ConstModelAt.
+    perturbations(): PerturbationMatrix or GaussianPerturbations.
+ OUTPUT:
+    fields: Array of perturbations.members magnetic fields, units Tesla.
+ */
+template <class Model, class Perturbations>
+inline void GeoMagEnsemble(Vector position_itrs, const Model& nominal, const Perturbations& perturbations, Vector* fields){
+    SphericalBasis basis= sphericalBasis(position_itrs);
+    Vector center= applyBasis(basis, nominal);
+    FieldSensitivity sens= fieldSensitivity(basis);
+    TPrecision scratch[ENSEMBLE_COEFFS];
+    for (int k = 0; k < perturbations.members; k++){
+        Vector delta= perturbationField(sens, perturbations.member(k, scratch));
+        fields[k]= {center.x+delta.x, center.y+delta.y, center.z+delta.z};
+    }
+}
+
+/** Return the mean and covariance of the magnetic field of the members of an ensemble at one position
+in International Terrestrial Reference System coordinates, units Tesla, without storing the members.
+The statistics are accumulated on the changes from the nominal field, which keeps their rounding small.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    nominal(): Nominal coefficients, anything with C(n,m) and S(n,m) like ModelSnapshot or ConstModelAt.
+    perturbations(): PerturbationMatrix or GaussianPerturbations.
+ */
+template <class Model, class Perturbations>
+inline EnsembleStats GeoMagEnsembleStats(Vector position_itrs, const Model& nominal, const Perturbations& perturbations){
+    SphericalBasis basis= sphericalBasis(position_itrs);
+    Vector center= applyBasis(basis, nominal);
+    FieldSensitivity sens= fieldSensitivity(basis);
+    TPrecision scratch[ENSEMBLE_COEFFS];
+    EnsembleStats stats= {};
+    for (int k = 0; k < perturbations.members; k++){
+        addSample(stats, perturbationField(sens, perturbations.member(k, scratch)));
+    }
+    stats.mean= {center.x+stats.mean.x, center.y+stats.mean.y, center.z+stats.mean.z};
+    return stats;
+}
+}
+#endif /* GEOMAG_ENSEMBLE_HPP */
@@ -0,0 +1,486 @@
+/*
+MIT License
+
+Copyright (c) 2019 Nathan Zimmerberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+// ../src/XYZgeomag_fixed.hpp Generated by python script wmmcodeupdate.py
+/** \file
+ * \brief Integer only version of GeoMag in Q format fixed point, for microcontrollers without a floating point unit.
+ * \details Does not need XYZgeomag.hpp, the models and constants are stored in PROGMEM if it is defined.
+
+The V,W terms are Schmidt semi-normalized, which scales the terms of each degree and order
+so they are at most about 1 above the surface of the earth, instead of growing like (2m-1)!!,
+and are stored in Q30 int32_t. The recurrence constants are Q28.
+The derivative coefficients of the normalized terms are stored as int32_t in units of
+2^-7 nT for the main field and 2^-16 nT/year for the secular variation,
+and the products are added in int64_t.
+Each multiply is a 32 by 32 bit multiply with a 64 bit result, one instruction on Cortex-M3 and up.
+
+Supported targets are 32 bit microcontrollers without a floating point unit that have that multiply,
+like Cortex-M3, Cortex-M4 without an FPU, and RV32IM. Each term takes 18 of those multiplies,
+and each call 64 bit shifts and one 64 by 32 bit division, which is emulated on 8 bit AVR like the Arduino Uno,
+so it isn't meant for those, where XYZgeomag_table.hpp is the fast option.
+The cycle count hasn't been measured on a target.
+*/
+#ifndef GEOMAG_FIXED_HPP
+#define GEOMAG_FIXED_HPP
+
+#include <stdint.h>
+
+namespace geomag
+{
+constexpr int FIXED_NMAX= 12;//order of the Model
+constexpr int FIXED_NUMTERMS= (FIXED_NMAX+2)*(FIXED_NMAX+3)/2;//number of V,W terms, degree 0 to FIXED_NMAX+1
+constexpr int FIXED_TERM_BITS= 30;//fractional bits of the V,W terms
+constexpr int FIXED_PLAN_BITS= 28;//fractional bits of the recurrence constants
+constexpr int FIXED_YEAR_BITS= 16;//fractional bits of the decimal years
+constexpr int FIXED_COEFF_BITS= 7;//fractional bits of the main field coefficients, units nT
+constexpr int FIXED_SECULAR_BITS= 16;//fractional bits of the secular variation coefficients, units nT/year
+constexpr int32_t FIXED_EARTH_R= 6371200;//mean radius of  ellipsoid in meters from section 1.2 of the WMM2015 Technical report
+
+/** A position in meters or a magnetic field in nT, in International Terrestrial Reference System coordinates.*/
+typedef struct {
+    int32_t x;
+    int32_t y;
+    int32_t z;
+} FixedVector;
+
+/** The constants of the recursion of the normalized V,W terms, in Q FIXED_PLAN_BITS:
+    V(m,m)= diag[m]*(a*V(m-1,m-1) - b*W(m-1,m-1))
+    V(n,m)= fcoef[termIndex(n,m)]*f*V(n-1,m) - gcoef[termIndex(n,m)]*g*V(n-2,m)
+and the same for W, with W(m,m)= diag[m]*(a*W(m-1,m-1) + b*V(m-1,m-1)).*/
+struct FixedPlan{
+    int32_t diag[FIXED_NMAX+2];
+    int32_t fcoef[FIXED_NUMTERMS];
+    int32_t gcoef[FIXED_NUMTERMS];
+};
+
+/** The derivative coefficients of a model in fixed point, made by wmmcodeupdate.py.
+The field in nT is the sum over the normalized terms of
+    x: XV*V+XW*W, y: YV*V+YW*W, z: ZV*V+ZW*W
+with the coefficients main+(dyear-epoch)*secular, and coeffs[0] to coeffs[5] are XV, XW, YV, YW, ZV, ZW.*/
+struct FixedModel{
+    int32_t epoch;//decimal year, Q FIXED_YEAR_BITS
+    int32_t main[6][FIXED_NUMTERMS];//units 2^-FIXED_COEFF_BITS nT
+    int32_t secular[6][FIXED_NUMTERMS];//units 2^-FIXED_SECULAR_BITS nT/year
+};
+
+constexpr
+#ifdef PROGMEM
+    PROGMEM
+#endif /* PROGMEM */
+FixedPlan FIXED_PLAN = {
+{0,268435456,232471924,245046924,251098377,254660234,257007382,258670878,259911513,260872372,261638518,262263701,262783550,263222621},
+{0,268435456,402653184,447392427,469762048,483183821,492131669,498522990,503316480,507044750,510027366,512467689,514501291,516222031,0,464943848,
+474531328,485168157,493147422,499112609,503689169,507295328,510203938,512596790,514598541,516297112,517756126,0,600239927,542434490,527196770,521984461,
+520207937,519823025,520048008,520544501,521154200,521799546,522441798,0,710213460,603979776,568264704,551763840,542937443,537802172,534653955,532660095,
+531374648,530542154,0,805306368,660263920,607471994,581179810,566020449,556485479,550128980,545711027,542543009,0,890299688,712324054,644761110,
+609810343,588928875,575338659,565971072,559240533,0,967857801,760942992,680271917,637534208,611434177,594094917,581907650,0,1039646051,806703258,
+714181163,664343859,633440624,612617310,0,1106787739,850045611,746658039,690275916,654915453,0,1170083026,891310818,777852837,715382894,0,
+1230125796,930767856,807895784,0,1287371222,968633017,0,1342177280,0},
+{0,0,134217728,178956971,201326592,214748365,223696213,230087534,234881024,238609294,241591910,244032233,246065835,247786575,0,0,
+164382474,196037539,212216861,222285676,229220408,234309675,238212836,241305530,243818611,245902239,247658510,0,0,173274342,202918131,217457573,
+226364652,232471924,236957326,240408393,243154642,245396741,247264589,0,0,177553365,206641710,220542232,228922526,234614568,238773118,241964450,
+244501769,246573711,0,0,180071978,208976719,222574922,230676747,236133125,240095971,243124958,245526938,0,0,181731663,210578097,
+224015551,231954745,237265664,241102667,244023759,0,0,182907932,211744743,225089973,232927305,238142804,241894468,0,0,183785193,
+212632566,225922101,233692258,238842197,0,0,184464623,213330868,226585604,234309675,0,0,185006371,213894491,227127028,0,
+0,185448441,214358975,0,0,185816030,0,0,0}};
+
+/** Read the fixed point number at index.*/
+inline int32_t fixedEntry(const int32_t* entries, int index){
+    #ifdef PROGMEM
+      return (int32_t)pgm_read_dword_near(entries+index);
+    #endif /* PROGMEM */
+    return entries[index];
+}
+
+/** Return the index of the V,W term of degree n order m.*/
+constexpr int fixedTermIndex(int n, int m){
+    return (m*(2*(FIXED_NMAX+1)-m+1))/2+n;
+}
+
+/** Return the floor of the square root of value.*/
+inline uint32_t fixedSqrt(uint64_t value){
+    uint64_t root= 0;
+    uint64_t bit= ((uint64_t)1)<<62;
+    while (bit > value){
+        bit>>= 2;
+    }
+    while (bit != 0){
+        if (value >= root+bit){
+            value-= root+bit;
+            root= (root>>1)+bit;
+        } else {
+            root>>= 1;
+        }
+        bit>>= 2;
+    }
+    return (uint32_t)root;
+}
+
+/** Return the product of two Q bits fixed point numbers, in Q bits.*/
+inline int32_t fixedMul(int32_t a, int32_t b, int bits){
+    return (int32_t)(((int64_t)a*b)>>bits);
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units nT,
+using only integer math. Within 1 nT of GeoMag at the test points, plus the rounding of the position to 1 m.
+ INPUT:
+    dyear(should be around the epoch of the model): The decimal year times 2^FIXED_YEAR_BITS, for example 2022.5*65536
+    position_itrs(Above the surface of earth, and within 2^30 m of its center): The location where the field is predicted, units m.
+    model(): Magnetic field model to use, for example WMM2020_FIXED.
+ */
+inline FixedVector GeoMagFixed(int32_t dyear, FixedVector position_itrs, const FixedModel& model){
+    const int T= FIXED_TERM_BITS;
+    const int P= FIXED_PLAN_BITS;
+    int32_t x= position_itrs.x;
+    int32_t y= position_itrs.y;
+    int32_t z= position_itrs.z;
+    uint64_t rsqrd= (uint64_t)((int64_t)x*x+(int64_t)y*y+(int64_t)z*z);
+    uint32_t r= fixedSqrt(rsqrd);
+    // the only division, inv is 2^(T+23)/r, below 2^31 above 2^22 m from the center
+    int32_t inv= (int32_t)((((int64_t)1)<<(T+23))/r);
+    int32_t u= (int32_t)(((int64_t)FIXED_EARTH_R*inv)>>23);//EARTH_R/r, V(0,0)
+    int32_t a= fixedMul((int32_t)(((int64_t)x*inv)>>23), u, T);//x*EARTH_R/r^2
+    int32_t b= fixedMul((int32_t)(((int64_t)y*inv)>>23), u, T);//y*EARTH_R/r^2
+    int32_t f= fixedMul((int32_t)(((int64_t)z*inv)>>23), u, T);//z*EARTH_R/r^2
+    int32_t g= fixedMul(u, u, T);//EARTH_R^2/r^2
+
+    int64_t sums[6]= {0, 0, 0, 0, 0, 0};//main field x, y, z, then secular variation x, y, z
+    int32_t Vtop= u;
+    int32_t Wtop= 0;
+    for (int m = 0; m <= FIXED_NMAX+1; m++){
+        if (m!=0){
+            int32_t diag= fixedEntry(FIXED_PLAN.diag, m);
+            int32_t temp= Vtop;
+            Vtop= fixedMul((int32_t)(((int64_t)a*Vtop-(int64_t)b*Wtop)>>T), diag, P);
+            Wtop= fixedMul((int32_t)(((int64_t)a*Wtop+(int64_t)b*temp)>>T), diag, P);
+        }
+        int32_t Vprev= 0;
+        int32_t Wprev= 0;
+        int32_t Vnm= Vtop;
+        int32_t Wnm= Wtop;
+        for (int n = m; n <= FIXED_NMAX+1; n++){
+            int index= fixedTermIndex(n,m);
+            if (n!=m){
+                int32_t fc= fixedMul(fixedEntry(FIXED_PLAN.fcoef, index), f, T);
+                int32_t gc= fixedMul(fixedEntry(FIXED_PLAN.gcoef, index), g, T);
+                int32_t temp= Vnm;
+                Vnm= (int32_t)(((int64_t)fc*Vnm-(int64_t)gc*Vprev)>>P);
+                Vprev= temp;
+                temp= Wnm;
+                Wnm= (int32_t)(((int64_t)fc*Wnm-(int64_t)gc*Wprev)>>P);
+                Wprev= temp;
+            }
+            for (int k = 0; k < 3; k++){
+                sums[k]+= (int64_t)fixedEntry(model.main[2*k], index)*Vnm+(int64_t)fixedEntry(model.main[2*k+1], index)*Wnm;
+                sums[3+k]+= (int64_t)fixedEntry(model.secular[2*k], index)*Vnm+(int64_t)fixedEntry(model.secular[2*k+1], index)*Wnm;
+            }
+        }
+    }
+    // combine in Q FIXED_YEAR_BITS nT, then round to nT
+    const int Y= FIXED_YEAR_BITS;
+    int64_t dt= (int64_t)dyear-fixedEntry(&model.epoch, 0);
+    int32_t field[3];
+    for (int k = 0; k < 3; k++){
+        int64_t mainfield= sums[k]>>(FIXED_COEFF_BITS+T-Y);
+        int64_t secular= sums[3+k]>>(FIXED_SECULAR_BITS+T-Y);
+        int64_t total= mainfield+((secular*dt)>>Y);
+        field[k]= (int32_t)((total+(((int64_t)1)<<(Y-1)))>>Y);
+    }
+    return {field[0], field[1], field[2]};
+}
+
+// Model parameters
+constexpr
+#ifdef PROGMEM
+    PROGMEM
+#endif /* PROGMEM */
+FixedModel WMM2015_FIXED = {132055040,
+{{0,0,192141,-667879,737528,-329363,-178517,-39535,51543,-6605,-7556,6170,1560,339,0,-6526589,
+-918435,354753,423066,-191504,21554,65489,28702,3443,-2097,5048,-2736,-332798,862228,-877249,390013,203724,
+73753,-64398,7100,7955,-5522,-2570,-1151,587719,508339,51253,129160,50630,-8858,-5205,2229,460,
+-1644,943,278691,-181924,-85998,-89196,36100,-6365,1986,-149,1795,883,42683,-105653,-14907,12429,
+-20380,585,-350,-660,-1055,3162,10552,7423,14843,-15116,1193,602,858,-61216,-2597,11781,
+1321,-1294,-1315,265,6643,-16888,10690,2768,294,770,-2239,-10770,3195,2167,-595,-13100,
+-2361,-592,-435,-4952,576,301,5263,-1411,0},
+{0,0,-613914,630877,36151,-114712,-23498,12142,36643,-7834,18547,-3133,104,1130,0,0,
+58107,-38408,41813,-56356,-11638,8046,8669,-5865,182,-1410,-368,1063330,-814458,8304,89186,49173,
+-28071,-34810,1372,-21486,140,339,-2136,-225048,101618,-60504,104404,34901,-20006,-8191,11454,-2366,
+2545,1831,-257809,98239,-81555,38324,3386,5915,12521,7543,-1029,1737,-200058,10807,-54555,23815,
+-13869,-8539,4573,-1078,-2798,73604,5835,3057,16451,-7063,-7165,1520,397,53963,-25505,5452,
+8844,-51,193,768,-2280,-9605,350,-4680,-2066,-188,2463,-4616,-2706,-1654,612,10605,
+-1443,-3231,319,-11968,-2879,-1417,-3458,-314,1142},
+{0,0,-613914,630877,36151,-114712,-23498,12142,36643,-7834,18547,-3133,104,1130,0,0,
+58107,-38408,41813,-56356,-11638,8046,8669,-5865,182,-1410,-368,-1063330,814458,89139,-145904,3770,
+-5588,30884,-12322,10279,-5136,511,-281,225048,-101618,120150,-109452,-5414,6038,18427,-5813,-1848,
+-1350,840,257809,-98239,63435,-40613,-4849,-15188,-7683,-990,359,-2063,200058,-10807,43241,-15193,
+11342,4074,-4152,1244,2128,-73604,-5835,-2641,-13598,6620,9512,-48,-314,-53963,25505,-5851,
+-7622,1292,666,-978,2280,9605,-1889,5025,3174,74,-2463,4616,4281,2281,-213,-10605,
+1443,3647,-257,11968,2879,1290,3458,314,-1142},
+{0,0,-192141,667879,-737528,329363,178517,39535,-51543,6605,7556,-6170,-1560,-339,0,-6526589,
+-614938,739021,476408,-81368,72593,59848,12514,6810,-1854,1961,-2148,-332798,862228,-771913,284979,141203,
+-549,-28012,4445,4986,-4870,-20,594,587719,508339,63978,79809,37772,-271,-19648,2727,-115,
+-2622,-150,278691,-181924,-85220,-85057,40224,1249,-7339,1262,2369,1861,42683,-105653,-27741,11551,
+-15192,528,-840,-1240,-960,3162,10552,8636,9827,-11258,2395,742,1273,-61216,-2597,11419,
+-1532,-274,-342,-15,6643,-16888,8790,2203,205,541,-2239,-10770,2544,2292,-506,-13100,
+-2361,42,-717,-4952,576,301,5263,-1411,0},
+{0,0,-7536256,-938995,691763,580608,-178637,62272,83558,27648,6912,-2675,4762,-3328,0,-332798,
+1090641,-1166134,510246,272689,59771,-77315,9846,11208,-9114,-2296,-498,0,479871,543437,70564,139312,
+62510,-6742,-18982,3888,277,-3483,658,0,197064,-171520,-93780,-105079,49267,-3476,-3785,813,
+3123,2105,0,26995,-90101,-21324,13302,-21259,704,-787,-1303,-1425,0,1825,8277,7434,
+12740,-14743,2132,838,1382,0,-32721,-1896,10046,-102,-826,-931,148,0,3321,-11585,
+7953,2281,250,701,0,-1056,-6989,2223,1946,-525,0,-5858,-1457,-203,-480,0,
+-2112,340,213,0,2149,-798,0,0,0},
+{0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1063330,
+-1030217,-57159,177711,35894,-18357,-54964,11678,-27509,4627,-153,-1659,0,-183751,108634,-110627,142571,
+28507,-19235,-20330,13545,-415,3180,822,0,-182299,92621,-79414,47601,5316,14337,14286,6231,
+-1041,2914,0,-126528,9216,-48898,21638,-15067,-7977,5771,-1593,-3483,0,42495,4578,2638,
+15517,-7649,-9908,977,461,0,28844,-18626,4894,7987,-708,-266,1033,0,-1140,-6589,
+914,-4453,-2620,-140,0,1161,-2995,-2706,-1717,393,0,4742,-890,-2540,240,0,
+-5103,-1698,-957,0,-1412,-177,0,448,0}},
+{{0,0,-1173094,374589,995285,-165794,-25382,60065,69357,-39322,43963,0,0,0,0,1214575,
+-1491774,674559,942780,145095,-65705,163588,122607,27805,31086,34367,62517,2031859,-483592,-630816,-151171,24521,
+-407312,-295494,-71813,-135733,-83414,-31086,-34367,430747,-84944,-2061330,-493608,-61656,-166778,-152342,65253,-19685,
+-47485,31086,-2550218,1112183,-176096,800737,534823,146019,212721,163692,50764,54042,-1305631,446776,-483635,154093,
+-111115,-252081,-32816,0,-81842,1430607,122782,-190728,222047,-101528,-54042,0,0,663097,-427368,87626,
+70095,-34618,0,63877,152292,-216169,4634,8026,0,0,171962,-121197,-118485,8026,0,-63877,
+-67154,4634,0,-140864,-73710,0,-76987,0,0},
+{0,0,1756365,3076167,-1348450,124346,-101528,0,-242749,117965,87926,-48603,0,0,0,0,
+616335,32106,-601612,-234469,394851,-106180,-73564,27805,31086,-34367,0,-3042113,-3971314,1401029,-368211,222948,
+102580,253501,-166810,-26252,40927,0,34367,-2387054,-84944,1545237,179999,-695253,186491,5256,-62163,-44206,
+19681,0,563990,834137,-346585,-320836,4163,137436,-106361,42472,0,-54042,-1647582,1134123,-22596,-48954,
+287941,47485,-17948,54042,0,37648,409272,-314079,-71565,73466,-93430,-17948,0,574684,47485,-101528,
+-32106,80023,0,0,50764,162127,-128543,-68625,75228,0,0,242395,-123119,0,0,191630,
+67154,-65798,0,-70432,0,0,-76987,0,0},
+{0,0,1756365,3076167,-1348450,124346,-101528,0,-242749,117965,87926,-48603,0,0,0,0,
+616335,32106,-601612,-234469,394851,-106180,-73564,27805,31086,-34367,0,3042113,3971314,-1614197,-113378,26778,
+102580,-181710,39394,124338,-40927,0,34367,2387054,84944,-1054023,-709747,672551,-157183,-220629,19691,44206,
+-75290,0,-563990,-834137,337317,160307,154753,-108127,70465,42472,0,54042,1647582,-1134123,-97891,32901,
+-242536,-47485,-17948,-54042,0,-37648,-409272,304811,23406,-28062,122739,-17948,0,-574684,-47485,101528,
+-32106,-34618,0,0,-50764,-162127,100739,52572,-52525,0,0,-242395,132387,0,0,-191630,
+-67154,75066,0,70432,0,0,76987,0,0},
+{0,0,1173094,-374589,-995285,165794,25382,-60065,-69357,39322,-43963,0,0,0,0,1214575,
+-1269338,610347,-1145835,-265225,-281079,-6301,-122607,-27805,-31086,-34367,62517,2031859,-483592,-1594708,490948,24521,
+296094,171148,140548,60438,83414,31086,34367,430747,-84944,-2450594,-284920,-311382,-108161,-224133,-147108,-68728,
+-47485,-31086,-2550218,1112183,176096,848896,444014,263253,140930,121220,50764,54042,-1305631,446776,-344612,9616,
+-65711,-222772,-68712,0,-32799,1430607,122782,-162924,157835,-101528,-54042,0,0,663097,-427368,115430,
+37989,-80023,0,63877,152292,-216169,-4634,-8026,0,0,171962,-121197,-137021,-8026,0,-63877,
+-67154,-4634,0,-140864,-73710,0,-76987,0,0},
+{0,0,1402470,-1690829,812646,-131072,-78643,-229376,104858,0,0,0,0,85197,0,2031859,
+-611701,-1573683,256848,38772,-90809,-104035,58617,-65207,0,0,0,0,351703,-90809,-2762978,-519019,
+-263777,-203056,-287538,-64212,-70888,-77543,0,0,-1803276,1048576,0,994767,631836,278046,250069,208070,
+76146,82897,0,-825754,381012,-414123,90809,-105674,-300324,-67154,0,-81064,0,825962,96318,-163709,
+196171,-113512,-64212,0,0,0,354440,-312106,87926,52429,-60421,0,75580,0,76146,-148291,
+0,0,0,0,0,81064,-78643,-98957,0,0,0,-28566,-41449,0,0,0,
+-60065,-43472,0,0,-31430,0,0,0,0},
+{0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,-3042113,
+-5023359,2132087,-192636,155086,0,364123,-175852,-130415,71791,0,0,0,-1949021,-90809,1591716,593164,
+-967183,253820,172523,-64212,-70888,77543,0,0,398802,786432,-374589,-290140,-97206,166827,-125035,0,
+0,-82897,0,-1042022,967183,37648,-45405,317021,60065,0,74146,0,0,21736,321060,-286491,
+-49043,56756,-128424,0,0,0,307181,34678,-87926,0,60421,0,0,0,25382,111218,
+-93604,-55609,63877,0,0,0,157286,-98957,0,0,0,85699,41449,-52018,0,0,
+-30032,0,0,0,-31430,0,0,0,0}}};
+
+constexpr
+#ifdef PROGMEM
+    PROGMEM
+#endif /* PROGMEM */
+FixedModel WMM2015v2_FIXED = {132055040,
+{{0,0,191168,-668367,737308,-329808,-178517,-39711,51408,-6835,-7556,5791,1456,113,0,-6526523,
+-918401,355350,423769,-191480,21661,65690,28873,3592,-2201,4935,-2810,-331113,862857,-877039,390564,203790,
+73716,-64382,7260,8003,-5202,-2484,-898,588561,507509,50110,128748,50194,-9059,-5170,2149,412,
+-1699,1042,278882,-182250,-86488,-88789,36365,-6285,1864,-190,1795,778,42319,-105519,-14520,12461,
+-20444,585,-250,-554,-1055,5662,10871,7323,14890,-15016,1270,637,816,-60698,-2782,11691,
+1321,-1316,-1315,265,5850,-17205,10681,2886,169,930,-2351,-10770,3320,2167,-595,-12975,
+-2361,-592,-579,-4952,576,301,5263,-1411,0},
+{0,0,-613926,630167,35649,-114672,-23250,11790,36778,-7757,18719,-3133,0,1130,0,0,
+57818,-38643,41813,-56242,-11498,8088,8764,-5811,243,-1410,-221,1063352,-813542,8783,89176,49044,
+-27831,-35072,1263,-21681,140,364,-2136,-223927,102240,-60458,104203,34791,-20101,-8373,11374,-2453,
+2545,1633,-257378,98131,-81903,38400,3636,5995,12607,7543,-930,1737,-200362,10740,-54941,23927,
+-13850,-8568,4573,-1078,-2798,73972,6475,3284,16467,-7063,-7136,1520,397,53445,-25690,5732,
+8950,-29,193,768,-2875,-9711,350,-4799,-2044,-188,2687,-4616,-2822,-1654,612,10605,
+-1443,-3368,319,-12106,-2879,-1426,-3458,-314,1305},
+{0,0,-613926,630167,35649,-114672,-23250,11790,36778,-7757,18719,-3133,0,1130,0,0,
+57818,-38643,41813,-56242,-11498,8088,8764,-5811,243,-1410,-221,-1063352,813542,88497,-145831,4120,
+-6000,30865,-12296,10378,-5136,364,-281,223927,-102240,120195,-109219,-5039,6077,18539,-5733,-1762,
+-1350,1038,257378,-98131,63693,-40940,-5188,-15268,-7769,-990,260,-2063,200362,-10740,43736,-15242,
+11189,4046,-4152,1244,2128,-73972,-6475,-2759,-13582,6620,9541,-48,-314,-53445,25690,-6166,
+-7727,1315,666,-978,2875,9711,-1889,5143,3196,74,-2687,4616,4414,2281,-213,-10605,
+1443,3785,-257,12106,2879,1281,3458,314,-1305},
+{0,0,-191168,668367,-737308,329808,178517,39711,-51408,6835,7556,-5791,-1456,-113,0,-6526523,
+-614470,738991,476002,-81744,72350,59801,12685,6850,-1958,1848,-2074,-331113,862857,-771632,285341,141137,
+-186,-27785,4688,4938,-4550,66,713,588561,507509,62727,79460,37601,-473,-19683,2647,-67,
+-2568,-51,278882,-182250,-85094,-84525,40400,1329,-7390,1303,2369,1755,42319,-105519,-27245,11520,
+-15301,528,-741,-1135,-960,5662,10871,8391,9780,-11159,2530,707,1314,-60698,-2782,11311,
+-1532,-252,-342,-15,5850,-17205,8799,2322,80,644,-2351,-10770,2668,2292,-506,-12975,
+-2361,42,-861,-4952,576,301,5263,-1411,0},
+{0,0,-7536179,-938688,692122,580800,-178867,62182,83661,27878,7040,-2816,4608,-3328,0,-331113,
+1091438,-1165787,510936,272689,60037,-77112,10189,11208,-8553,-2143,-166,0,480558,542550,69098,138806,
+62080,-7040,-18982,3762,277,-3483,822,0,197199,-171827,-93980,-104512,49552,-3367,-3907,813,
+3123,1943,0,26765,-89987,-20883,13302,-21362,704,-656,-1159,-1425,0,3269,8528,7274,
+12740,-14632,2257,838,1382,0,-32444,-2032,9960,-102,-826,-931,148,0,2925,-11802,
+7953,2389,125,841,0,-1108,-6989,2319,1946,-525,0,-5803,-1457,-203,-600,0,
+-2112,340,213,0,2149,-798,0,0,0},
+{0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1063352,
+-1029059,-56366,177649,35515,-17825,-55167,11563,-27764,4627,0,-1659,0,-182835,109299,-110627,142281,
+28164,-19334,-20554,13419,-554,3180,493,0,-181994,92518,-79746,47844,5696,14445,14408,6231,
+-892,2914,0,-126720,9159,-49339,21727,-14964,-7977,5771,-1593,-3483,0,42708,5079,2798,
+15517,-7649,-9908,977,461,0,28568,-18762,5152,8090,-708,-266,1033,0,-1438,-6662,
+914,-4562,-2620,-140,0,1267,-2995,-2802,-1717,393,0,4742,-890,-2642,240,0,
+-5162,-1698,-957,0,-1412,-177,0,512,0}},
+{{0,0,-589824,703772,915020,186519,-152292,150162,69357,-78643,43963,0,0,0,0,794582,
+-1779730,336854,534770,27137,-259479,-54257,5080,-48603,31086,0,0,1021605,-908566,-513273,-608502,135777,
+-373492,-223703,-37446,-135733,-55609,0,0,53843,424722,-1408522,-318754,150532,-117756,-57347,84944,-19685,
+0,31086,-2697346,1445838,-33791,549878,406935,146019,176826,137443,24521,0,-1243458,412408,-657970,113166,
+-89611,-233904,-50764,0,-57321,527066,0,-297677,197968,0,-93430,-57321,0,530477,-427368,184519,
+162127,22702,0,0,355348,-54042,13902,-52572,11351,0,229282,0,-127753,0,0,-191630,
+-67154,-65798,0,0,0,4634,-76987,0,-83542},
+{0,0,1979187,3359946,-1043443,82897,-50764,-90097,-208070,157286,131889,0,0,0,0,0,
+801698,64212,-658368,-337049,269217,-106180,-147128,-27805,-31086,-34367,0,-3428053,-4337671,1259287,-389951,49043,
+259265,330101,-116233,-14857,55609,0,34367,-3104965,-169889,1584430,374631,-511701,201145,118199,-22781,19685,
+19681,-31086,-490427,1056574,27805,-428461,-176318,-11619,-194774,-73735,0,-54042,-1088026,1134123,90347,-89881,
+321995,142456,32816,54042,57321,-225885,81854,-495539,-135103,62115,-54042,-17948,0,574684,47485,-258454,
+-40132,68672,0,0,101528,270212,-66589,-16053,75228,0,57321,302993,-63877,0,0,127753,
+134309,-65798,0,0,0,4634,-76987,0,-83542},
+{0,0,1979187,3359946,-1043443,82897,-50764,-90097,-208070,157286,131889,0,0,0,0,0,
+801698,64212,-658368,-337049,269217,-106180,-147128,-27805,-31086,-34367,0,3428053,4337671,-1073923,-220062,-49043,
+92438,-42937,158706,211028,55609,0,34367,3104965,169889,-1260044,-904379,420892,-142528,-333572,-104635,-68728,
+-75290,-31086,490427,-1056574,27805,396355,426043,70236,158878,116207,0,54042,1088026,-1134123,-210833,73828,
+-208483,-142456,-68712,-54042,-57321,225885,-81854,477003,54838,-39413,54042,-17948,0,-574684,-47485,249186,
+-40132,-45969,0,0,-101528,-270212,48052,-16053,-52525,0,-57321,-302993,63877,0,0,-127753,
+-134309,75066,0,0,0,4634,76987,0,83542},
+{0,0,589824,-703772,-915020,-186519,152292,-150162,-69357,78643,-43963,0,0,0,0,794582,
+-1751925,657913,-940882,-207331,-295375,-181673,-93006,-48603,-31086,0,0,1021605,-908566,-1532773,226253,158479,
+95446,99357,174915,60438,55609,0,0,53843,424722,-1779250,-126119,-212705,-88448,-93243,-84944,-68728,
+0,-31086,-2697346,1445838,95964,549878,270721,263253,176826,52499,-24521,0,-1243458,412408,-546752,-31311,
+1198,-145978,-50764,0,-57321,527066,0,-232800,181915,0,-122739,-57321,0,530477,-427368,221592,
+162127,-22702,0,0,355348,-54042,-13902,-68625,-11351,0,229282,0,-127753,0,0,-191630,
+-67154,-75066,0,0,0,-4634,-76987,0,-83542},
+{0,0,917504,-2162688,629146,-262144,-117965,-367002,-157286,-58982,-65536,0,0,0,0,1021605,
+-1149256,-1446773,-288954,232630,-227023,-104035,117234,-65207,0,0,0,0,43963,454047,-1952104,-296582,
+-43963,-152292,-115015,0,-70888,0,0,0,-1907312,1363149,34054,663178,437425,278046,250069,138714,
+0,0,0,-786432,351703,-602361,45405,-52837,-240259,-67154,0,-81064,0,304302,0,-245563,
+196171,0,-128424,-71491,0,0,283552,-312106,175852,157286,0,0,0,0,177674,-37073,
+0,-55609,0,0,0,108085,0,-98957,0,0,0,-85699,-41449,-52018,0,0,
+0,0,0,0,-31430,0,0,-32768,0},
+{0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,-3428053,
+-5486768,1649829,-128424,77543,136214,312106,-234469,-195622,0,0,0,0,-2535193,-181619,1741877,852673,
+-659443,253820,345046,64212,70888,77543,0,0,-346784,996147,0,-497383,-388822,-55609,-250069,-138714,
+0,-82897,0,-688128,967183,150590,-90809,317021,180194,67154,74146,81064,0,-130415,64212,-450199,
+-98085,56756,-64212,0,0,0,307181,34678,-219814,0,60421,0,0,0,50764,185364,
+-46802,0,63877,0,0,27021,196608,-49479,0,0,0,57133,82897,-52018,0,0,
+0,0,0,0,-31430,0,0,-32768,0}}};
+
+constexpr
+#ifdef PROGMEM
+    PROGMEM
+#endif /* PROGMEM */
+FixedModel WMM2020_FIXED = {132382720,
+{{0,0,185690,-661117,746526,-327622,-180004,-38479,52018,-7526,-7041,5885,1456,113,0,-6519051,
+-935603,358272,428594,-191243,19045,65343,28645,3171,-1915,5069,-2810,-321624,853498,-882222,384217,205094,
+70400,-66435,6744,6700,-5879,-2666,-965,587790,512735,36949,125690,52348,-10093,-5471,2774,345,
+-1830,1224,251775,-168022,-86667,-83672,40126,-4699,3453,1328,2236,992,29083,-101491,-20762,13759,
+-21255,-1335,-577,-660,-1487,10074,10791,4639,16777,-15160,89,371,621,-55862,-6678,13610,
+2619,-1318,-1229,444,9717,-17416,11041,2625,8,799,-336,-11007,2100,1805,-297,-14846,
+-3148,-1106,-547,-5365,288,178,4661,-1724,-490},
+{0,0,-595571,663245,25773,-114146,-23647,11203,34814,-6451,20007,-3228,0,1357,0,0,
+66507,-37906,35118,-59648,-8764,6968,7328,-6028,121,-1745,-368,1031560,-856246,20323,85642,49738,
+-25456,-32014,329,-21826,817,304,-1986,-257579,100291,-44175,108125,29457,-18003,-7114,10988,-2472,
+2629,1589,-260012,108503,-82618,33963,2179,5967,10635,6813,-783,1318,-212566,21614,-53517,23049,
+-10986,-6962,4794,-339,-2350,72869,7194,-1728,14901,-6236,-7875,1268,160,58798,-25227,3316,
+8468,642,221,663,-1884,-7283,-430,-4955,-1456,-188,3135,-1775,-3445,-1785,1025,12102,
+-131,-3892,288,-12106,-2879,-1399,-3910,0,816},
+{0,0,-595571,663245,25773,-114146,-23647,11203,34814,-6451,20007,-3228,0,1357,0,0,
+66507,-37906,35118,-59648,-8764,6968,7328,-6028,121,-1745,-368,-1031560,856246,77952,-148287,4047,
+-4711,30402,-10947,12439,-4619,304,240,257579,-100291,107550,-118221,-901,4551,15387,-6758,-2126,
+-2194,597,260012,-108503,64679,-36785,-1203,-14496,-6288,321,208,-1426,212566,-21614,41190,-14521,
+9390,2497,-4724,505,1680,-72869,-7194,2071,-12737,6059,10280,-76,-77,-58798,25227,-3823,
+-7998,866,695,-1084,1884,7283,-1326,4987,2786,74,-3135,1775,5038,2412,-626,-12102,
+131,4362,-288,12106,2879,1308,3910,0,-816},
+{0,0,-185690,661117,-746526,327622,180004,38479,-52018,7526,7041,-5885,-1456,-113,0,-6519051,
+-632070,745864,466815,-83740,70224,58458,11883,6321,-2036,1713,-2074,-321624,853498,-787061,287209,142707,
+849,-26824,6412,5359,-4033,248,780,587790,512735,45619,78283,36297,-1049,-20264,1862,-517,
+-2807,-233,251775,-168022,-84187,-79439,42964,4059,-5871,1826,2523,1752,29083,-101491,-32474,11501,
+-15181,-705,-1208,-1240,-1200,10074,10791,6413,11603,-11214,1177,301,1036,-55862,-6678,13556,
+-297,-697,-428,304,9717,-17416,8887,1873,-258,513,-336,-11007,1394,1868,-253,-14846,
+-3148,-545,-892,-5365,288,123,4661,-1724,-490},
+{0,0,-7527552,-960000,698317,577984,-180019,59046,82534,27187,6400,-2675,4608,-3328,0,-321624,
+1079599,-1180361,507550,274960,58175,-78026,11220,10443,-8693,-2143,-166,0,479928,548137,50562,135982,
+62681,-8229,-19656,3637,-138,-3786,822,0,178032,-158413,-93581,-98359,53634,-434,-1709,2303,
+3569,2105,0,18394,-86552,-26618,14012,-21775,-1290,-1180,-1303,-1900,0,5816,8465,5116,
+14655,-14743,752,419,1075,0,-29860,-4877,11764,1126,-1062,-931,443,0,4858,-11947,
+8136,2064,-125,701,0,-158,-7142,1353,1603,-262,0,-6639,-1943,-610,-600,0,
+-2288,170,106,0,1903,-975,0,-192,0},
+{0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1031560,
+-1083075,-40750,176834,36121,-16938,-52221,9617,-29675,4767,0,-1991,0,-210312,107215,-92913,150898,
+21466,-16657,-17185,13921,-277,3938,822,0,-183856,102298,-80678,42663,2183,13902,11966,4741,
+-744,2105,0,-134438,18432,-47354,20840,-12177,-5983,6296,-579,-2850,0,42071,5644,-1759,
+14272,-6873,-10786,838,154,0,31429,-18423,3091,7987,-118,-266,1033,0,-942,-4996,
+366,-4562,-2121,-140,0,1478,-1152,-3286,-1832,787,0,5412,-81,-3048,240,0,
+-5162,-1698,-957,0,-1596,0,0,320,0}},
+{{0,0,-504627,805933,995285,331589,-152292,120129,104035,-39322,87926,0,53242,0,0,760528,
+-1744142,307380,401868,12483,-297809,-18086,-19442,-48603,0,0,0,874040,-1040455,-547402,-773208,135777,
+-316378,-218894,-71813,-173380,-55609,-44206,0,-394851,722027,-1216404,-290950,314349,-63676,-19700,63708,24521,
+0,0,-2991602,1501447,-15254,481143,320289,146019,176826,137443,24521,0,-1709755,412408,-564139,146066,
+-100962,-186419,-50764,0,0,376476,0,-267373,189941,0,-93430,-57321,0,353652,-379883,235283,
+162127,22702,14654,0,507640,0,18536,-52572,11351,0,229282,0,-127753,-59128,0,-255506,
+-67154,-65798,0,0,-73710,4634,-76987,0,-83542},
+{0,0,1644954,3428053,-915020,-41449,-25382,-30032,-173392,117965,131889,0,0,0,0,0,
+1107549,80265,-783231,-366357,323060,-127417,-171649,-55609,-31086,-34367,0,-2849143,-4425597,972048,-254508,126682,
+232965,281067,-60630,-14857,83414,0,34367,-4289518,-212361,1951481,454320,-661717,235513,173794,-3090,19685,
+-8124,-31086,269735,1028769,-302949,-489170,-127319,-37892,-194774,-99984,0,-54042,-1740841,1031021,292487,-97907,
+277788,189941,32816,108085,57321,188238,40927,-544380,-174562,73466,-108085,-17948,0,442064,94971,-258454,
+-40132,68672,0,-17948,152292,216169,-123909,-16053,75228,0,57321,302993,-63877,0,70432,127753,
+134309,-70432,0,0,0,4634,0,0,-83542},
+{0,0,1644954,3428053,-915020,-41449,-25382,-30032,-173392,117965,131889,0,0,0,0,0,
+1107549,80265,-783231,-366357,323060,-127417,-171649,-55609,-31086,-34367,0,2849143,4425597,-1073998,-339452,77639,
+177356,-29798,145574,211028,83414,0,34367,4289518,212361,-1432462,-935909,457396,-176896,-353272,-166799,-68728,
+-103094,-31086,-269735,-1028769,256608,473117,399747,125817,158878,184928,0,54042,1740841,-1031021,-385169,65801,
+-164276,-189941,-68712,-108085,-57321,-188238,-40927,516575,110350,-28062,108085,-17948,0,-442064,-94971,249186,
+-40132,-45969,0,-17948,-152292,-216169,105373,-16053,-52525,0,-57321,-302993,63877,0,-70432,-127753,
+-134309,70432,0,0,0,4634,0,0,83542},
+{0,0,504627,-805933,-995285,-331589,152292,-120129,-104035,39322,-87926,0,-53242,0,0,760528,
+-1948042,853181,-960272,-192677,-118331,-60558,-68484,-48603,0,0,0,874040,-1040455,-1678122,93653,158479,
+93942,32375,140548,22790,55609,-44206,0,-394851,722027,-1726155,-98314,-3484,-5059,-55595,-63708,-24521,
+0,0,-2991602,1501447,77427,481143,206777,263253,176826,52499,-24521,0,-1709755,412408,-489993,17643,
+12549,-98493,-50764,0,0,376476,0,-174691,189941,0,-122739,-57321,0,353652,-379883,272356,
+162127,-22702,-14654,0,507640,0,-18536,-68625,-11351,0,229282,0,-127753,-75181,0,-255506,
+-67154,-75066,0,0,-73710,-4634,-76987,0,-83542},
+{0,0,878182,-2260992,734003,-360448,-117965,-275251,-52429,-58982,-65536,0,0,0,0,874040,
+-1316083,-1573683,-513695,232630,-181619,-156053,58617,-130415,0,-78370,0,0,-322394,771879,-1801942,-259509,
+219814,-50764,-57508,0,0,0,0,0,-2115382,1415578,34054,580280,340220,278046,250069,138714,
+0,0,0,-1081344,351703,-527066,90809,-52837,-180194,-67154,0,0,0,217358,0,-204636,
+196171,0,-128424,-71491,0,0,189035,-277427,219814,157286,0,0,0,0,253820,0,
+0,-55609,0,0,0,108085,0,-98957,-58617,0,0,-114266,-41449,-52018,0,0,
+0,-43472,0,0,-31430,0,0,-32768,0},
+{0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,-2849143,
+-5597987,1446773,64212,38772,45405,260088,-175852,-195622,0,0,0,0,-3502377,-227023,2072233,926819,
+-791332,304584,402553,128424,70888,77543,0,0,190731,969933,-306482,-580280,-340220,-111218,-250069,-208070,
+0,-82897,0,-1101005,879258,338828,-90809,264184,240259,67154,148291,81064,0,108679,32106,-491127,
+-147128,56756,-128424,0,0,0,236293,69357,-219814,0,60421,0,0,0,76146,148291,
+-93604,0,63877,0,0,27021,196608,-49479,0,67154,0,57133,82897,-52018,0,0,
+0,0,0,0,0,0,0,-32768,0}}};
+
+}
+#endif /* GEOMAG_FIXED_HPP */
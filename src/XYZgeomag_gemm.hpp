@@ -0,0 +1,248 @@
+/*
+MIT License
+
+Copyright (c) 2019 Nathan Zimmerberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+/** \file
+ * \brief Batch version of geomag::GeoMag written as a matrix product, for very large point sets.
+ * \details Intended for host processing, the tiles use about 30 kB of stack.
+
+At a fixed time the field of a batch of points is the product of the basis matrix,
+the V,W terms of each point, and the derivative coefficient matrix, NUMTERMS V and W rows by 3 components.
+The V,W terms of GEMM_TILE points are built into a tile small enough to stay in the L1 cache,
+then a micro-kernel contracts the tile with the coefficients packed by term,
+adding GEMM_TERMS terms in registers between updates of the sums, so each basis number is loaded once
+and used for six multiply-adds. XYZgeomag_simd.hpp has versions with explicit register tiles.
+*/
+#ifndef GEOMAG_GEMM_HPP
+#define GEOMAG_GEMM_HPP
+
+#include <stddef.h>
+#include "XYZgeomag.hpp"
+
+namespace geomag
+{
+constexpr int GEMM_TILE= 128/sizeof(TPrecision);//number of points in a basis tile, about 27 kB, 32 in single and 16 in double precision
+constexpr int GEMM_TERMS= 4;//number of terms added together by the micro-kernel before updating the sums
+
+/** The V,W terms of GEMM_TILE points, stored by term then point, made by basisTile.*/
+struct BasisTile{
+    TPrecision V[NUMTERMS][GEMM_TILE];
+    TPrecision W[NUMTERMS][GEMM_TILE];
+};
+
+/** The derivative coefficients packed by term, so the micro-kernel reads them sequentially, made by packCoeffs.*/
+struct PackedCoeffs{
+    TPrecision terms[NUMTERMS][6];//XV, XW, YV, YW, ZV, ZW of each term
+};
+
+/** Return the derivative coefficients packed by term.*/
+inline PackedCoeffs packCoeffs(const DerivativeCoeffs& coeffs){
+    PackedCoeffs packed;
+    for (int t = 0; t < NUMTERMS; t++){
+        packed.terms[t][0]= coeffs.XV[t];
+        packed.terms[t][1]= coeffs.XW[t];
+        packed.terms[t][2]= coeffs.YV[t];
+        packed.terms[t][3]= coeffs.YW[t];
+        packed.terms[t][4]= coeffs.ZV[t];
+        packed.terms[t][5]= coeffs.ZW[t];
+    }
+    return packed;
+}
+
+/** Build the V,W terms of count<=GEMM_TILE points into a tile.
+The unused points of the tile are filled with the terms at (EARTH_R,0,0), so the micro-kernel can run on whole register blocks.
+ INPUT:
+    x, y, z(Above the surface of earth): Arrays of count position components, units m.
+    count(at most GEMM_TILE): Number of points.
+ OUTPUT:
+    tile: The V,W terms of the points.
+ */
+inline void basisTile(const TPrecision* x, const TPrecision* y, const TPrecision* z, int count, BasisTile& tile){
+    const RecurrencePlan& plan= RECURRENCE_PLAN;
+    TPrecision a[GEMM_TILE];
+    TPrecision b[GEMM_TILE];
+    TPrecision f[GEMM_TILE];
+    TPrecision g[GEMM_TILE];
+    TPrecision Vtop[GEMM_TILE];
+    TPrecision Wtop[GEMM_TILE];
+    TPrecision Vprev[GEMM_TILE];
+    TPrecision Wprev[GEMM_TILE];
+    TPrecision Vnm[GEMM_TILE];
+    TPrecision Wnm[GEMM_TILE];
+    int i,n,m;
+    for (i = 0; i < GEMM_TILE; i++){
+        TPrecision px= (i < count) ? x[i] : EARTH_R;
+        TPrecision py= (i < count) ? y[i] : 0;
+        TPrecision pz= (i < count) ? z[i] : 0;
+        TPrecision rsqrd= px*px+py*py+pz*pz;
+        TPrecision temp= EARTH_R/rsqrd;
+        a[i]= px*temp;
+        b[i]= py*temp;
+        f[i]= pz*temp;
+        g[i]= EARTH_R*temp;
+        Vtop[i]= EARTH_R/std::sqrt(rsqrd);//V0,0
+        Wtop[i]= 0;//W0,0
+    }
+    for (m = 0; m <= NMAX+1; m++){
+        int index= termIndex(m,m);
+        if (m!=0){
+            TPrecision diag= plan.diag[m];
+            for (i = 0; i < GEMM_TILE; i++){
+                TPrecision temp= Vtop[i];
+                Vtop[i]= diag*(a[i]*Vtop[i]-b[i]*Wtop[i]);
+                Wtop[i]= diag*(a[i]*Wtop[i]+b[i]*temp);
+            }
+        }
+        for (i = 0; i < GEMM_TILE; i++){
+            Vprev[i]= 0;
+            Wprev[i]= 0;
+            Vnm[i]= Vtop[i];
+            Wnm[i]= Wtop[i];
+            tile.V[index][i]= Vnm[i];
+            tile.W[index][i]= Wnm[i];
+        }
+        for (n = m+1; n <= NMAX+1; n++){
+            index++;
+            TPrecision fcoef= plan.fcoef[index];
+            TPrecision gcoef= plan.gcoef[index];
+            for (i = 0; i < GEMM_TILE; i++){
+                TPrecision fc= fcoef*f[i];
+                TPrecision gc= gcoef*g[i];
+                TPrecision temp= Vnm[i];
+                Vnm[i]= fc*Vnm[i] - gc*Vprev[i];
+                Vprev[i]= temp;
+                temp= Wnm[i];
+                Wnm[i]= fc*Wnm[i] - gc*Wprev[i];
+                Wprev[i]= temp;
+                tile.V[index][i]= Vnm[i];
+                tile.W[index][i]= Wnm[i];
+            }
+        }
+    }
+}
+
+/** Contract the GEMM_TILE points of a tile with the packed coefficients.
+GEMM_TERMS terms are added together before each sum is updated, so the sums are loaded and stored
+once per GEMM_TERMS terms, and the loop over the points can be vectorized.
+ INPUT:
+    tile(): V,W terms made by basisTile.
+    packed(): Derivative coefficients made by packCoeffs.
+ OUTPUT:
+    bx, by, bz: Arrays of GEMM_TILE magnetic field components, units Tesla.
+ */
+inline void gemmMicroKernel(const BasisTile& tile, const PackedCoeffs& packed, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    // local sums can't alias the tile, so the compiler doesn't need runtime overlap checks to vectorize
+    TPrecision sx[GEMM_TILE]= {0};
+    TPrecision sy[GEMM_TILE]= {0};
+    TPrecision sz[GEMM_TILE]= {0};
+    int i,t,k;
+    // the degree 0 term has no derivative coefficients, skipping it leaves 104 terms for NMAX 12, a multiple of GEMM_TERMS
+    for (t = 1; t+GEMM_TERMS <= NUMTERMS; t+= GEMM_TERMS){
+        for (i = 0; i < GEMM_TILE; i++){
+            TPrecision x= sx[i];
+            TPrecision y= sy[i];
+            TPrecision z= sz[i];
+            for (k = t; k < t+GEMM_TERMS; k++){
+                const TPrecision* c= packed.terms[k];
+                TPrecision V= tile.V[k][i];
+                TPrecision W= tile.W[k][i];
+                x+= c[0]*V+c[1]*W;
+                y+= c[2]*V+c[3]*W;
+                z+= c[4]*V+c[5]*W;
+            }
+            sx[i]= x;
+            sy[i]= y;
+            sz[i]= z;
+        }
+    }
+    for (; t < NUMTERMS; t++){
+        const TPrecision* c= packed.terms[t];
+        for (i = 0; i < GEMM_TILE; i++){
+            TPrecision V= tile.V[t][i];
+            TPrecision W= tile.W[t][i];
+            sx[i]+= c[0]*V+c[1]*W;
+            sy[i]+= c[2]*V+c[3]*W;
+            sz[i]+= c[4]*V+c[5]*W;
+        }
+    }
+    for (i = 0; i < GEMM_TILE; i++){
+        bx[i]= sx[i];
+        by[i]= sy[i];
+        bz[i]= sz[i];
+    }
+}
+
+/** Calculate the magnetic field at many points in International Terrestrial Reference System coordinates, units Tesla.
+Within rounding of GeoMag(position_itrs, coeffs) on each point.
+ INPUT:
+    x, y, z(Above the surface of earth): Arrays of count position components, units m.
+    count: Number of points.
+    coeffs(): Derivative coefficients made by derivativeCoeffs, shared by all points.
+ OUTPUT:
+    bx, by, bz: Arrays of count magnetic field components, units Tesla.
+ */
+inline void GeoMagGemm(const TPrecision* x, const TPrecision* y, const TPrecision* z, size_t count, const DerivativeCoeffs& coeffs, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    PackedCoeffs packed= packCoeffs(coeffs);
+    BasisTile tile;
+    TPrecision sums[3][GEMM_TILE];
+    for (size_t start= 0; start < count; start+= GEMM_TILE){
+        int len= (count-start < GEMM_TILE) ? (int)(count-start) : GEMM_TILE;
+        basisTile(x+start, y+start, z+start, len, tile);
+        gemmMicroKernel(tile, packed, sums[0], sums[1], sums[2]);
+        for (int i = 0; i < len; i++){
+            bx[start+i]= sums[0][i];
+            by[start+i]= sums[1][i];
+            bz[start+i]= sums[2][i];
+        }
+    }
+}
+
+/** Calculate the magnetic field at many points in International Terrestrial Reference System coordinates, units Tesla.
+ INPUT:
+    x, y, z(Above the surface of earth): Arrays of count position components, units m.
+    count: Number of points.
+    snapshot(): Model coefficients resolved at a time by snapshotModel, shared by all points.
+ OUTPUT:
+    bx, by, bz: Arrays of count magnetic field components, units Tesla.
+ */
+inline void GeoMagGemm(const TPrecision* x, const TPrecision* y, const TPrecision* z, size_t count, const ModelSnapshot& snapshot, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    DerivativeCoeffs coeffs= derivativeCoeffs(snapshot);
+    GeoMagGemm(x, y, z, count, coeffs, bx, by, bz);
+}
+
+/** Calculate the magnetic field at many points in International Terrestrial Reference System coordinates, units Tesla.
+ INPUT:
+    dyear(should be around the epoch of the model): The decimal year, shared by all points.
+    x, y, z(Above the surface of earth): Arrays of count position components, units m.
+    count: Number of points.
+    WMM(): Magnetic field model to use.
+ OUTPUT:
+    bx, by, bz: Arrays of count magnetic field components, units Tesla.
+ */
+inline void GeoMagGemm(float dyear, const TPrecision* x, const TPrecision* y, const TPrecision* z, size_t count, const ConstModel& WMM, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    GeoMagGemm(x, y, z, count, snapshotModel(dyear, WMM), bx, by, bz);
+}
+}
+#endif /* GEOMAG_GEMM_HPP */
@@ -0,0 +1,213 @@
+/*
+MIT License
+
+Copyright (c) 2019 Nathan Zimmerberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/** \file
+ * \brief Magnetic field and its gradient tensor from one pass of the V/W recursion.
+ * \details The recursion is extended to degree NMAX+2, and the derivative formulas
+of Montenbruck and Gill section 3.2.5 are applied twice to the model coefficients,
+so the gradient is a sum over the V,W terms, like the field.
+*/
+#ifndef GEOMAG_GRADIENT_HPP
+#define GEOMAG_GRADIENT_HPP
+
+#include "XYZgeomag.hpp"
+
+namespace geomag
+{
+constexpr int NUMGRADTERMS= (NMAX+3)*(NMAX+4)/2;//number of V,W terms, degree 0 to NMAX+2
+/** Index of the V,W term n,m up to degree NMAX+2, stored by m then n.*/
+constexpr int gradTermIndex(int n, int m){
+    return (m*(2*(NMAX+2)-m+1))/2+n;
+}
+
+/** The constants of the V/W recursion up to degree NMAX+2, see RecurrencePlan.*/
+struct GradientPlan{
+    TPrecision diag[NMAX+3];// (2m-1)
+    TPrecision fcoef[NUMGRADTERMS];// (2n-1)/(n-m), 0 for n==m
+    TPrecision gcoef[NUMGRADTERMS];// (n+m-1)/(n-m), 0 for n==m
+    inline TPrecision diagAt(int m) const{ return diag[m]; }
+    inline TPrecision fcoefAt(int index) const{ return fcoef[index]; }
+    inline TPrecision gcoefAt(int index) const{ return gcoef[index]; }
+};
+
+/** Return the GradientPlan, evaluated at compile time for GRADIENT_PLAN.*/
+constexpr GradientPlan makeGradientPlan(){
+    GradientPlan plan{};
+    for (int m = 0; m <= NMAX+2; m++){
+        plan.diag[m]= 2*m-1;
+        for (int n = m+1; n <= NMAX+2; n++){
+            plan.fcoef[gradTermIndex(n,m)]= ((TPrecision)(2*n-1))/((TPrecision)(n-m));
+            plan.gcoef[gradTermIndex(n,m)]= ((TPrecision)(n+m-1))/((TPrecision)(n-m));
+        }
+    }
+    return plan;
+}
+constexpr GradientPlan GRADIENT_PLAN= makeGradientPlan();
+
+/** Sums of the field and gradient, in the order they are stored in GradientCoeffs.
+The zz gradient is not stored, because the gradient has zero trace.*/
+enum GradientSum { SUM_X, SUM_Y, SUM_Z, SUM_XX, SUM_XY, SUM_XZ, SUM_YY, SUM_YZ, NUMGRADSUMS };
+
+/** The coefficients of each V,W term in the field and gradient, made by gradientCoeffs.
+Sum k is the sum over the terms of V[k]*V+W[k]*W, in T for the field and T/m for the gradient.
+Uses 2*NUMGRADSUMS*NUMGRADTERMS numbers of ram.*/
+struct GradientCoeffs{
+    float dyear;//decimal year the coefficients are resolved at
+    TPrecision V[NUMGRADSUMS][NUMGRADTERMS];
+    TPrecision W[NUMGRADSUMS][NUMGRADTERMS];
+};
+
+/** Replace the sum of A*V+B*W over the terms up to degree degree by its derivative along axis,
+a sum of dA*V+dB*W over the terms up to degree degree+1, with x,y,z in units of EARTH_R.
+ INPUT:
+    axis(0, 1, or 2): x, y, or z.
+    A, B(NUMGRADTERMS long): The coefficients, indexed by gradTermIndex.
+    degree(at most NMAX+1): The highest degree with non zero coefficients.
+ OUTPUT:
+    dA, dB(NUMGRADTERMS long): The coefficients of the derivative, indexed by gradTermIndex.
+ */
+inline void deriveTerms(int axis, const TPrecision* A, const TPrecision* B, int degree, TPrecision* dA, TPrecision* dB){
+    for (int i = 0; i < NUMGRADTERMS; i++){
+        dA[i]= 0;
+        dB[i]= 0;
+    }
+    for (int m = 0; m <= degree; m++){
+        for (int n = m; n <= degree; n++){
+            TPrecision a= A[gradTermIndex(n,m)];
+            TPrecision b= (m==0) ? 0 : B[gradTermIndex(n,m)];//W(n,0) is zero
+            TPrecision k= 0.5f*(n-m+2)*(n-m+1);
+            int up= gradTermIndex(n+1,m+1);
+            int down= (m==0) ? 0 : gradTermIndex(n+1,m-1);
+            switch (axis){
+            case 0:
+                if (m==0){
+                    dA[up]+= -a;
+                } else {
+                    dA[up]+= -0.5f*a;
+                    dA[down]+= k*a;
+                    dB[up]+= -0.5f*b;
+                    dB[down]+= k*b;
+                }
+                break;
+            case 1:
+                if (m==0){
+                    dB[up]+= -a;
+                } else {
+                    dB[up]+= -0.5f*a;
+                    dB[down]+= -k*a;
+                    dA[up]+= 0.5f*b;
+                    dA[down]+= k*b;
+                }
+                break;
+            default:
+                dA[gradTermIndex(n+1,m)]+= -(n-m+1)*a;
+                dB[gradTermIndex(n+1,m)]+= -(n-m+1)*b;
+                break;
+            }
+        }
+    }
+}
+
+/** Return the gradient coefficients of a snapshot. Slow, call once per snapshot.*/
+inline GradientCoeffs gradientCoeffs(const ModelSnapshot& snapshot){
+    GradientCoeffs coeffs;
+    coeffs.dyear= snapshot.dyear;
+    TPrecision A[NUMGRADTERMS]= {0};
+    TPrecision B[NUMGRADTERMS]= {0};
+    for (int m = 0; m <= NMAX; m++){
+        for (int n = m; n <= NMAX; n++){
+            A[gradTermIndex(n,m)]= snapshot.C(n,m);
+            B[gradTermIndex(n,m)]= snapshot.S(n,m);
+        }
+    }
+    // the field is minus the gradient of the potential, in nT,
+    // and each derivative divides by EARTH_R because V,W use units of EARTH_R.
+    const TPrecision field_scale= -1.0E-9f;
+    const TPrecision gradient_scale= -1.0E-9f/EARTH_R;
+    const int first[]= {SUM_X, SUM_Y, SUM_Z};
+    const int second[][3]= {{SUM_XX, SUM_XY, SUM_XZ}, {-1, SUM_YY, SUM_YZ}};
+    for (int i = 0; i < 3; i++){
+        TPrecision dA[NUMGRADTERMS];
+        TPrecision dB[NUMGRADTERMS];
+        deriveTerms(i, A, B, NMAX, dA, dB);
+        for (int t = 0; t < NUMGRADTERMS; t++){
+            coeffs.V[first[i]][t]= field_scale*dA[t];
+            coeffs.W[first[i]][t]= field_scale*dB[t];
+        }
+        if (i==2){
+            continue;
+        }
+        for (int j = i; j < 3; j++){
+            TPrecision ddA[NUMGRADTERMS];
+            TPrecision ddB[NUMGRADTERMS];
+            deriveTerms(j, dA, dB, NMAX+1, ddA, ddB);
+            for (int t = 0; t < NUMGRADTERMS; t++){
+                coeffs.V[second[i][j]][t]= gradient_scale*ddA[t];
+                coeffs.W[second[i][j]][t]= gradient_scale*ddB[t];
+            }
+        }
+    }
+    return coeffs;
+}
+
+/** The magnetic field and its gradient tensor, returned by GeoMagGradient.*/
+typedef struct {
+    Vector field;//units Tesla
+    TPrecision gradient[3][3];//gradient[i][j] is the derivative of field component i along axis j, units Tesla/m
+} FieldGradient;
+
+/** Return the magnetic field and its gradient in International Terrestrial Reference System coordinates.
+The field is the same as GeoMag(position_itrs, derivativeCoeffs(snapshot)) up to rounding.
+ INPUT:
+    position_itrs(Above the surface of earth): The location where the field is predicted, units m.
+    coeffs(): Gradient coefficients made by gradientCoeffs.
+ */
+inline FieldGradient GeoMagGradient(Vector position_itrs, const GradientCoeffs& coeffs){
+    TPrecision x= position_itrs.x;
+    TPrecision y= position_itrs.y;
+    TPrecision z= position_itrs.z;
+    TPrecision sums[NUMGRADSUMS]= {0};
+    TPrecision rsqrd= x*x+y*y+z*z;
+    TPrecision temp= EARTH_R/rsqrd;
+    recurseTerms<NMAX+2>(x*temp, y*temp, z*temp, EARTH_R*temp, EARTH_R/std::sqrt(rsqrd), GRADIENT_PLAN, NMAX+2, [&](int, int, int index, TPrecision Vnm, TPrecision Wnm){
+        for (int k = 0; k < NUMGRADSUMS; k++){
+            sums[k]+= coeffs.V[k][index]*Vnm+coeffs.W[k][index]*Wnm;
+        }
+    });
+    FieldGradient out;
+    out.field= {sums[SUM_X], sums[SUM_Y], sums[SUM_Z]};
+    out.gradient[0][0]= sums[SUM_XX];
+    out.gradient[0][1]= sums[SUM_XY];
+    out.gradient[0][2]= sums[SUM_XZ];
+    out.gradient[1][0]= sums[SUM_XY];
+    out.gradient[1][1]= sums[SUM_YY];
+    out.gradient[1][2]= sums[SUM_YZ];
+    out.gradient[2][0]= sums[SUM_XZ];
+    out.gradient[2][1]= sums[SUM_YZ];
+    out.gradient[2][2]= -sums[SUM_XX]-sums[SUM_YY];
+    return out;
+}
+}
+#endif /* GEOMAG_GRADIENT_HPP */
@@ -0,0 +1,476 @@
+/*
+MIT License
+
+Copyright (c) 2019 Nathan Zimmerberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/** \file
+ * \brief Magnetic field on a regular geodetic latitude, longitude, height grid.
+ * \details All the points of a row of constant latitude and height have the same
+distance from the center of earth and the same z, so the V,W terms at longitude lon are
+    V(n,m)= U(n,m)*cos(m*lon), W(n,m)= U(n,m)*sin(m*lon)
+where U is V at longitude 0. The V/W recursion is done once per row,
+and the sums over n are done once per row for each m,
+so each grid point only needs cos(m*lon), sin(m*lon) from the angle addition formulas
+and a sum over m.
+*/
+#ifndef GEOMAG_GRID_HPP
+#define GEOMAG_GRID_HPP
+
+#include <stddef.h>
+#include <complex>
+#include <vector>
+#include "XYZgeomag.hpp"
+
+namespace geomag
+{
+/** A regular grid of geodetic positions.
+Point i_lon, i_lat, i_h is at lon0+i_lon*dlon, lat0+i_lat*dlat, h0+i_h*dh,
+and is stored at index (i_h*nlat+i_lat)*nlon+i_lon of the outputs.*/
+struct GeodeticGrid{
+    TPrecision lat0;// first geodetic latitude in degrees
+    TPrecision dlat;// latitude spacing in degrees
+    int nlat;// number of latitudes
+    TPrecision lon0;// first geodetic longitude in degrees
+    TPrecision dlon;// longitude spacing in degrees
+    int nlon;// number of longitudes
+    TPrecision h0;// first height above the WGS 84 ellipsoid in meters
+    TPrecision dh;// height spacing in meters
+    int nh;// number of heights
+};
+
+/** Number of points in a grid.*/
+inline size_t gridSize(const GeodeticGrid& grid){
+    return (size_t)grid.nh*grid.nlat*grid.nlon;
+}
+
+/** Output coordinates of GeoMagGrid.*/
+enum GridFrame{
+    GRID_ITRS,// International Terrestrial Reference System x, y, z, units Tesla, like GeoMag
+    GRID_NED// local north, east, down, units nT, like magField2Elements
+};
+
+/** The field along a row of constant latitude and height as a sum over the orders m,
+    field k= sum over m of A[k][m]*cos(m*lon)+B[k][m]*sin(m*lon)
+for k= 0, 1, 2 the x, y, z field components, made by gridRowSums.*/
+struct GridRowSums{
+    LatLonTrig trig;// sin and cos of the latitude, longitude 0
+    TPrecision A[3][NMAX+2];
+    TPrecision B[3][NMAX+2];
+};
+
+/** Return the sums over n of the V,W terms along a row of constant latitude and height.
+ INPUT:
+    lat: Geodetic latitude in degrees.
+    h(Above the surface of earth): Height above the WGS 84 ellipsoid in meters.
+    coeffs(): Derivative coefficients made by derivativeCoeffs.
+    scale(): Multiplies the sums, 1 for Tesla, 1E9 for nT.
+ */
+inline GridRowSums gridRowSums(TPrecision lat, TPrecision h, const DerivativeCoeffs& coeffs, TPrecision scale){
+    const RecurrencePlan& plan= RECURRENCE_PLAN;
+    GridRowSums row;
+    row.trig= latLonTrig(lat, 0);
+    Vector position= geodetic2ecef(row.trig, h);
+    TPrecision x= position.x;
+    TPrecision z= position.z;
+    TPrecision rsqrd= x*x+z*z;
+    TPrecision temp= EARTH_R/rsqrd;
+    TPrecision a= x*temp;
+    TPrecision f= z*temp;
+    TPrecision g= EARTH_R*temp;
+    TPrecision Utop= EARTH_R/std::sqrt(rsqrd);//U0,0
+    for (int m = 0; m <= NMAX+1; m++){
+        if (m!=0){
+            Utop= plan.diag[m]*a*Utop;
+        }
+        int index= termIndex(m,m);
+        TPrecision Uprev= 0;
+        TPrecision Unm= Utop;
+        TPrecision ax= coeffs.XV[index]*Unm;
+        TPrecision bx= coeffs.XW[index]*Unm;
+        TPrecision ay= coeffs.YV[index]*Unm;
+        TPrecision by= coeffs.YW[index]*Unm;
+        TPrecision az= coeffs.ZV[index]*Unm;
+        TPrecision bz= coeffs.ZW[index]*Unm;
+        for (int n = m+1; n <= NMAX+1; n++){
+            index++;
+            temp= Unm;
+            Unm= plan.fcoef[index]*f*Unm - plan.gcoef[index]*g*Uprev;
+            Uprev= temp;
+            ax+= coeffs.XV[index]*Unm;
+            bx+= coeffs.XW[index]*Unm;
+            ay+= coeffs.YV[index]*Unm;
+            by+= coeffs.YW[index]*Unm;
+            az+= coeffs.ZV[index]*Unm;
+            bz+= coeffs.ZW[index]*Unm;
+        }
+        row.A[0][m]= scale*ax;
+        row.B[0][m]= scale*bx;
+        row.A[1][m]= scale*ay;
+        row.B[1][m]= scale*by;
+        row.A[2][m]= scale*az;
+        row.B[2][m]= scale*bz;
+    }
+    return row;
+}
+
+/** Calculate the magnetic field on a regular geodetic grid.
+Within rounding, gives the same results as GeoMag(geodetic2ecef(lat,lon,h), coeffs) at each point,
+optionally converted to north, east, down as in magField2Elements.
+Return false without writing the outputs if grid.nlat, grid.nlon, or grid.nh is negative.
+ INPUT:
+    grid(Above the surface of earth): The grid points.
+    coeffs(): Derivative coefficients made by derivativeCoeffs, shared by all points.
+    frame(): Coordinates of the output, GRID_ITRS or GRID_NED.
+ OUTPUT:
+    out0, out1, out2: Arrays of gridSize(grid) field components, x, y, z in Tesla or north, east, down in nT.
+ */
+inline bool GeoMagGrid(const GeodeticGrid& grid, const DerivativeCoeffs& coeffs, GridFrame frame, TPrecision* out0, TPrecision* out1, TPrecision* out2){
+    if (grid.nlat < 0 || grid.nlon < 0 || grid.nh < 0){
+        return false;
+    }
+    const TPrecision scale= (frame==GRID_NED) ? 1E9f : 1;
+    // per column cos and sin of longitude, the rest of the harmonics come from angle addition.
+    std::vector<TPrecision> clam(grid.nlon);
+    std::vector<TPrecision> slam(grid.nlon);
+    for (int i = 0; i < grid.nlon; i++){
+        LatLonTrig trig= latLonTrig(0, grid.lon0+i*grid.dlon);
+        clam[i]= trig.clam;
+        slam[i]= trig.slam;
+    }
+    size_t out= 0;
+    for (int ih = 0; ih < grid.nh; ih++){
+        for (int ilat = 0; ilat < grid.nlat; ilat++){
+            GridRowSums row= gridRowSums(grid.lat0+ilat*grid.dlat, grid.h0+ih*grid.dh, coeffs, scale);
+            for (int ilon = 0; ilon < grid.nlon; ilon++, out++){
+                TPrecision c1= clam[ilon];
+                TPrecision s1= slam[ilon];
+                TPrecision cm= 1;
+                TPrecision sm= 0;
+                TPrecision bx= row.A[0][0];
+                TPrecision by= row.A[1][0];
+                TPrecision bz= row.A[2][0];
+                for (int m = 1; m <= NMAX+1; m++){
+                    TPrecision temp= cm;
+                    cm= cm*c1-sm*s1;
+                    sm= sm*c1+temp*s1;
+                    bx+= row.A[0][m]*cm+row.B[0][m]*sm;
+                    by+= row.A[1][m]*cm+row.B[1][m]*sm;
+                    bz+= row.A[2][m]*cm+row.B[2][m]*sm;
+                }
+                if (frame==GRID_NED){
+                    TPrecision x1= c1*bx + s1*by;
+                    out0[out]= -row.trig.sphi*x1 + row.trig.cphi*bz;
+                    out1[out]= -s1*bx + c1*by;
+                    out2[out]= -row.trig.cphi*x1 + -row.trig.sphi*bz;
+                } else {
+                    out0[out]= bx;
+                    out1[out]= by;
+                    out2[out]= bz;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/** Calculate the magnetic field on a regular geodetic grid, see GeoMagGrid.
+Return false without writing the outputs if grid.nlat, grid.nlon, or grid.nh is negative.
+ INPUT:
+    dyear(should be around the epoch of the model): The decimal year, shared by all points.
+    grid(Above the surface of earth): The grid points.
+    WMM(): Magnetic field model to use.
+    frame(): Coordinates of the output, GRID_ITRS or GRID_NED.
+ OUTPUT:
+    out0, out1, out2: Arrays of gridSize(grid) field components, x, y, z in Tesla or north, east, down in nT.
+ */
+inline bool GeoMagGrid(float dyear, const GeodeticGrid& grid, const ConstModel& WMM, GridFrame frame, TPrecision* out0, TPrecision* out1, TPrecision* out2){
+    DerivativeCoeffs coeffs= derivativeCoeffs(snapshotModel(dyear, WMM));
+    return GeoMagGrid(grid, coeffs, frame, out0, out1, out2);
+}
+
+/** The factors and twiddle factors of an inverse discrete Fourier transform of length n, made by makeFourierPlan.*/
+struct FourierPlan{
+    int n;
+    std::vector<int> factors;// prime factors of n, 4 is used in place of 2*2
+    std::vector<std::complex<TPrecision>> twiddle;// exp(2*pi*i*k/n) for k= 0 to n-1
+};
+
+/** Return the plan for an inverse discrete Fourier transform of length n>=1.*/
+inline FourierPlan makeFourierPlan(int n){
+    FourierPlan plan;
+    plan.n= n;
+    int rest= n;
+    while (rest%4 == 0){
+        plan.factors.push_back(4);
+        rest/= 4;
+    }
+    for (int p = 2; rest > 1; p++){
+        while (rest%p == 0){
+            plan.factors.push_back(p);
+            rest/= p;
+        }
+        if (p*p > rest && rest > 1){
+            plan.factors.push_back(rest);
+            rest= 1;
+        }
+    }
+    plan.twiddle.resize(n);
+    for (int k = 0; k < n; k++){
+        double angle= 2.0*M_PI*k/n;
+        plan.twiddle[k]= std::complex<TPrecision>(std::cos(angle), std::sin(angle));
+    }
+    return plan;
+}
+
+/** Return a*b, written out because std::complex multiplication checks for infinities and NaN.*/
+inline std::complex<TPrecision> complexMul(std::complex<TPrecision> a, std::complex<TPrecision> b){
+    return std::complex<TPrecision>(a.real()*b.real()-a.imag()*b.imag(), a.real()*b.imag()+a.imag()*b.real());
+}
+
+/** Inverse discrete Fourier transform, out[j]= sum over k of in[k]*exp(2*pi*i*j*k/n), without the 1/n.
+Uses the self sorting Stockham algorithm, one pass over the data for each factor of n.
+ INPUT:
+    plan(): Plan made by makeFourierPlan(n).
+    in(n long): The spectrum, overwritten.
+ OUTPUT:
+    out(n long, not in): The transform.
+ */
+inline void inverseDFT(const FourierPlan& plan, std::complex<TPrecision>* in, std::complex<TPrecision>* out){
+    typedef std::complex<TPrecision> Complex;
+    const int N= plan.n;
+    const Complex* w= plan.twiddle.data();
+    Complex* x= in;
+    Complex* y= out;
+    int s= 1;// number of interleaved transforms left to do
+    int n= N;// length of each of them
+    for (int p : plan.factors){
+        int m= n/p;
+        // x[k+s*(q+m*r)] are the inputs r of butterfly k, q,
+        // and its outputs t times exp(2*pi*i*q*t/n) go to y[k+s*(t+p*q)]
+        for (int q = 0; q < m; q++){
+            for (int k = 0; k < s; k++){
+                const Complex* a= x+k+s*q;
+                Complex* b= y+k+s*p*q;
+                int ms= m*s;
+                if (p==4){
+                    Complex s02= a[0]+a[2*ms];
+                    Complex d02= a[0]-a[2*ms];
+                    Complex s13= a[ms]+a[3*ms];
+                    Complex d13= a[ms]-a[3*ms];
+                    Complex id13(-d13.imag(), d13.real());
+                    b[0]= s02+s13;
+                    b[s]= complexMul(d02+id13, w[q*s]);
+                    b[2*s]= complexMul(s02-s13, w[2*q*s]);
+                    b[3*s]= complexMul(d02-id13, w[3*q*s]);
+                } else if (p==2){
+                    b[0]= a[0]+a[ms];
+                    b[s]= complexMul(a[0]-a[ms], w[q*s]);
+                } else if (p==3){
+                    const TPrecision sin60= 0.86602540378443864676;
+                    Complex s12= a[ms]+a[2*ms];
+                    Complex d12= a[ms]-a[2*ms];
+                    Complex c= a[0]-((TPrecision)0.5)*s12;
+                    Complex id12(-sin60*d12.imag(), sin60*d12.real());
+                    b[0]= a[0]+s12;
+                    b[s]= complexMul(c+id12, w[q*s]);
+                    b[2*s]= complexMul(c-id12, w[2*q*s]);
+                } else if (p==5){
+                    const TPrecision c1= 0.30901699437494742410;//cos(2*pi/5)
+                    const TPrecision c2= -0.80901699437494742410;//cos(4*pi/5)
+                    const TPrecision s1= 0.95105651629515357212;//sin(2*pi/5)
+                    const TPrecision s2= 0.58778525229247312917;//sin(4*pi/5)
+                    Complex s14= a[ms]+a[4*ms];
+                    Complex d14= a[ms]-a[4*ms];
+                    Complex s23= a[2*ms]+a[3*ms];
+                    Complex d23= a[2*ms]-a[3*ms];
+                    Complex t1= a[0]+c1*s14+c2*s23;
+                    Complex t2= a[0]+c2*s14+c1*s23;
+                    Complex u1= s1*d14+s2*d23;
+                    Complex u2= s2*d14-s1*d23;
+                    Complex iu1(-u1.imag(), u1.real());
+                    Complex iu2(-u2.imag(), u2.real());
+                    b[0]= a[0]+s14+s23;
+                    b[s]= complexMul(t1+iu1, w[q*s]);
+                    b[2*s]= complexMul(t2+iu2, w[2*q*s]);
+                    b[3*s]= complexMul(t2-iu2, w[3*q*s]);
+                    b[4*s]= complexMul(t1-iu1, w[4*q*s]);
+                } else {
+                    // exp(2*pi*i*r*t/p) is w[((r*t)%p)*(N/p)]
+                    int root= N/p;
+                    for (int t = 0; t < p; t++){
+                        Complex sum= a[0];
+                        int rt= 0;
+                        for (int r = 1; r < p; r++){
+                            rt+= t;
+                            if (rt >= p){
+                                rt-= p;
+                            }
+                            sum+= complexMul(a[r*ms], w[rt*root]);
+                        }
+                        b[t*s]= complexMul(sum, w[q*t*s]);
+                    }
+                }
+            }
+        }
+        Complex* temp= x;
+        x= y;
+        y= temp;
+        n= m;
+        s*= p;
+    }
+    if (x != out){
+        for (int k = 0; k < N; k++){
+            out[k]= x[k];
+        }
+    }
+}
+
+/** Calculate the magnetic field on a regular geodetic grid that goes all the way around in longitude,
+with nlon longitudes lon0+i*360/nlon. grid.dlon is not used.
+The per m sums of each ring of constant latitude and height are turned into all of its longitudes
+with inverse fast Fourier transforms, so each grid point costs a few operations per prime factor of nlon,
+instead of a sum over all the orders m like GeoMagGrid.
+nlon with small prime factors, 2, 3, and 5, are fastest.
+Within rounding, gives the same results as GeoMagGrid.
+Return false without writing the outputs if grid.nlon is less than 1, because the ring spacing 360/grid.nlon is undefined,
+or if grid.nlat or grid.nh is negative.
+ INPUT:
+    grid(Above the surface of earth): The grid points, grid.dlon is taken to be 360/grid.nlon.
+    coeffs(): Derivative coefficients made by derivativeCoeffs, shared by all points.
+    frame(): Coordinates of the output, GRID_ITRS or GRID_NED.
+ OUTPUT:
+    out0, out1, out2: Arrays of gridSize(grid) field components, x, y, z in Tesla or north, east, down in nT.
+ */
+inline bool GeoMagGlobalGrid(const GeodeticGrid& grid, const DerivativeCoeffs& coeffs, GridFrame frame, TPrecision* out0, TPrecision* out1, TPrecision* out2){
+    if (grid.nlon < 1 || grid.nlat < 0 || grid.nh < 0){
+        return false;
+    }
+    typedef std::complex<TPrecision> Complex;
+    const int M= NMAX+2;// highest frequency after the NED rotation
+    const int N= grid.nlon;
+    const int numrows= grid.nh*grid.nlat;
+    const TPrecision scale= (frame==GRID_NED) ? 1E9f : 1;
+    const Complex i1(0, 1);
+    FourierPlan plan= makeFourierPlan(N);
+    // exp(i*k*lon0), so the first sample is at lon0
+    Complex shift[2*M+1];
+    for (int k = -M; k <= M; k++){
+        TPrecision angle= k*grid.lon0*((TPrecision)(M_PI/180.0));
+        shift[k+M]= Complex(std::cos(angle), std::sin(angle));
+    }
+    // two sided spectra of the three outputs of one row, output c= sum over j of S[c][j+M]*exp(i*j*lon)
+    struct RowSpectra{
+        Complex S[3][2*M+1];
+    };
+    auto rowSpectra= [&](int row_index, RowSpectra& spectra){
+        int ih= row_index/grid.nlat;
+        int ilat= row_index%grid.nlat;
+        GridRowSums row= gridRowSums(grid.lat0+ilat*grid.dlat, grid.h0+ih*grid.dh, coeffs, scale);
+        Complex D[3][2*M+1];
+        for (int c = 0; c < 3; c++){
+            for (int j = 0; j < 2*M+1; j++){
+                D[c][j]= 0;
+            }
+            D[c][M]= row.A[c][0];
+            for (int m = 1; m <= NMAX+1; m++){
+                D[c][M+m]= Complex(0.5f*row.A[c][m], -0.5f*row.B[c][m]);
+                D[c][M-m]= Complex(0.5f*row.A[c][m], 0.5f*row.B[c][m]);
+            }
+        }
+        for (int j = 0; j < 2*M+1; j++){
+            if (frame==GRID_NED){
+                // multiplying by cos(lon) or sin(lon) shifts the spectrum by one
+                const TPrecision half= 0.5f;
+                const Complex half_i(0, half);
+                Complex xlo= (j>0) ? D[0][j-1] : Complex(0);
+                Complex xhi= (j<2*M) ? D[0][j+1] : Complex(0);
+                Complex ylo= (j>0) ? D[1][j-1] : Complex(0);
+                Complex yhi= (j<2*M) ? D[1][j+1] : Complex(0);
+                Complex x1= half*(xlo+xhi) - half_i*(ylo-yhi);// cos(lon)*x+sin(lon)*y
+                Complex east= half_i*(xlo-xhi) + half*(ylo+yhi);// -sin(lon)*x+cos(lon)*y
+                spectra.S[0][j]= shift[j]*(-row.trig.sphi*x1 + row.trig.cphi*D[2][j]);
+                spectra.S[1][j]= shift[j]*east;
+                spectra.S[2][j]= shift[j]*(-row.trig.cphi*x1 + -row.trig.sphi*D[2][j]);
+            } else {
+                for (int c = 0; c < 3; c++){
+                    spectra.S[c][j]= shift[j]*D[c][j];
+                }
+            }
+        }
+    };
+    std::vector<Complex> spectrum(N);
+    std::vector<Complex> result(N);
+    // transform the real outputs u and v together as u+i*v.
+    // frequencies above N/2 alias onto the same samples, so they are added into bin k mod N.
+    auto transform= [&](const Complex* u, const Complex* v, TPrecision* u_out, TPrecision* v_out){
+        for (int k = 0; k < N; k++){
+            spectrum[k]= 0;
+        }
+        for (int j = 0; j < 2*M+1; j++){
+            int bin= ((j-M)%N+N)%N;
+            spectrum[bin]+= (v) ? u[j]+i1*v[j] : u[j];
+        }
+        inverseDFT(plan, spectrum.data(), result.data());
+        for (int k = 0; k < N; k++){
+            u_out[k]= result[k].real();
+        }
+        if (v){
+            for (int k = 0; k < N; k++){
+                v_out[k]= result[k].imag();
+            }
+        }
+    };
+    // rows are done in pairs, so the third outputs of both share one transform.
+    RowSpectra first;
+    RowSpectra second;
+    for (int r = 0; r < numrows; r+= 2){
+        size_t out= (size_t)r*N;
+        rowSpectra(r, first);
+        transform(first.S[0], first.S[1], out0+out, out1+out);
+        if (r+1 < numrows){
+            rowSpectra(r+1, second);
+            transform(second.S[0], second.S[1], out0+out+N, out1+out+N);
+            transform(first.S[2], second.S[2], out2+out, out2+out+N);
+        } else {
+            transform(first.S[2], nullptr, out2+out, nullptr);
+        }
+    }
+    return true;
+}
+
+/** Calculate the magnetic field on a regular geodetic grid that goes all the way around in longitude, see GeoMagGlobalGrid.
+Return false without writing the outputs if grid.nlon is less than 1, or grid.nlat or grid.nh is negative.
+ INPUT:
+    dyear(should be around the epoch of the model): The decimal year, shared by all points.
+    grid(Above the surface of earth): The grid points, grid.dlon is taken to be 360/grid.nlon.
+    WMM(): Magnetic field model to use.
+    frame(): Coordinates of the output, GRID_ITRS or GRID_NED.
+ OUTPUT:
+    out0, out1, out2: Arrays of gridSize(grid) field components, x, y, z in Tesla or north, east, down in nT.
+ */
+inline bool GeoMagGlobalGrid(float dyear, const GeodeticGrid& grid, const ConstModel& WMM, GridFrame frame, TPrecision* out0, TPrecision* out1, TPrecision* out2){
+    DerivativeCoeffs coeffs= derivativeCoeffs(snapshotModel(dyear, WMM));
+    return GeoMagGlobalGrid(grid, coeffs, frame, out0, out1, out2);
+}
+}
+#endif /* GEOMAG_GRID_HPP */
@@ -0,0 +1,186 @@
+/*
+MIT License
+
+Copyright (c) 2019 Nathan Zimmerberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/** \file
+ * \brief Multi-threaded version of geomag::GeoMagBatch, using std::thread.
+ * \details The points are split into chunks, and each thread starts with an equal
+contiguous range of chunks. A thread takes chunks from the front of its own range,
+and when it runs out it steals chunks from the back of the other ranges.
+
+Each point is calculated by the same batch kernel code no matter which thread
+takes its chunk, so the output doesn't depend on the number of threads.
+Compile with -pthread.
+*/
+#ifndef GEOMAG_PARALLEL_HPP
+#define GEOMAG_PARALLEL_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "XYZgeomag_batch.hpp"
+#include "XYZgeomag_cache.hpp"
+
+namespace geomag
+{
+/** Settings of GeoMagParallel.*/
+struct ParallelOptions{
+    unsigned threads= 0;//number of threads including the calling thread, 0 to use std::thread::hardware_concurrency()
+    size_t chunk= 4096;//points per chunk, the unit of work stealing, about 100 kB of inputs and outputs in double precision
+    BatchKernel kernel= GeoMagBatch;//kernel run on each chunk
+};
+
+/** The chunks left in one thread's range, next in the low 32 bits and end in the high 32 bits,
+so the owner and thieves can update it with one compare and swap.
+Aligned to a cache line, so ranges of different threads don't share one.
+Store them with CacheLineAllocator, like CacheShard.*/
+struct alignas(CACHE_LINE) ChunkRange{
+    std::atomic<uint64_t> range;
+};
+static_assert(sizeof(ChunkRange) == CACHE_LINE, "ChunkRange must fill one cache line");
+
+/** Take the first chunk of range, return false if it is empty.*/
+inline bool takeFrontChunk(ChunkRange& chunks, uint32_t& chunk){
+    uint64_t old= chunks.range.load(std::memory_order_relaxed);
+    while (true){
+        uint32_t next= (uint32_t)old;
+        uint32_t end= (uint32_t)(old>>32);
+        if (next >= end){
+            return false;
+        }
+        if (chunks.range.compare_exchange_weak(old, ((uint64_t)end<<32)|(next+1), std::memory_order_relaxed)){
+            chunk= next;
+            return true;
+        }
+    }
+}
+
+/** Take the last chunk of range, return false if it is empty.*/
+inline bool takeBackChunk(ChunkRange& chunks, uint32_t& chunk){
+    uint64_t old= chunks.range.load(std::memory_order_relaxed);
+    while (true){
+        uint32_t next= (uint32_t)old;
+        uint32_t end= (uint32_t)(old>>32);
+        if (next >= end){
+            return false;
+        }
+        if (chunks.range.compare_exchange_weak(old, ((uint64_t)(end-1)<<32)|next, std::memory_order_relaxed)){
+            chunk= end-1;
+            return true;
+        }
+    }
+}
+
+/** Calculate the magnetic field at many points in International Terrestrial Reference System coordinates, units Tesla,
+using several threads. Gives the same results as options.kernel called on each chunk of options.chunk points in turn,
+for any number of threads.
+ INPUT:
+    x, y, z(Above the surface of earth): Arrays of count position components, units m.
+    count: Number of points.
+    coeffs(): Derivative coefficients made by derivativeCoeffs, shared by all points.
+    options(): Number of threads, chunk size, and kernel.
+ OUTPUT:
+    bx, by, bz: Arrays of count magnetic field components, units Tesla.
+ */
+inline void GeoMagParallel(const TPrecision* x, const TPrecision* y, const TPrecision* z, size_t count, const DerivativeCoeffs& coeffs, TPrecision* bx, TPrecision* by, TPrecision* bz, ParallelOptions options= ParallelOptions()){
+    size_t chunk= (options.chunk > 0) ? options.chunk : 1;
+    size_t numchunks= (count+chunk-1)/chunk;
+    if (numchunks > UINT32_MAX){
+        chunk= (count+UINT32_MAX-1)/UINT32_MAX;
+        numchunks= (count+chunk-1)/chunk;
+    }
+    size_t numthreads= (options.threads > 0) ? options.threads : std::thread::hardware_concurrency();
+    if (numthreads > numchunks){
+        numthreads= numchunks;
+    }
+    if (numthreads <= 1){
+        // the same chunks as with more threads, so kernels with a different tail path give the same results
+        for (size_t start = 0; start < count; start+= chunk){
+            size_t len= (count-start < chunk) ? count-start : chunk;
+            options.kernel(x+start, y+start, z+start, len, coeffs, bx+start, by+start, bz+start);
+        }
+        return;
+    }
+    std::vector<ChunkRange, CacheLineAllocator<ChunkRange>> ranges(numthreads);
+    for (size_t t = 0; t < numthreads; t++){
+        uint64_t begin= numchunks*t/numthreads;
+        uint64_t end= numchunks*(t+1)/numthreads;
+        ranges[t].range.store((end<<32)|begin, std::memory_order_relaxed);
+    }
+    auto work= [&](size_t self){
+        uint32_t c;
+        auto run= [&](uint32_t index){
+            size_t start= index*chunk;
+            size_t len= (count-start < chunk) ? count-start : chunk;
+            options.kernel(x+start, y+start, z+start, len, coeffs, bx+start, by+start, bz+start);
+        };
+        while (takeFrontChunk(ranges[self], c)){
+            run(c);
+        }
+        // steal from the others, starting with the next thread so thieves spread out
+        for (size_t i = 1; i < numthreads; i++){
+            ChunkRange& victim= ranges[(self+i)%numthreads];
+            while (takeBackChunk(victim, c)){
+                run(c);
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(numthreads-1);
+    try{
+        for (size_t t = 1; t < numthreads; t++){
+            threads.emplace_back(work, t);
+        }
+    }
+    catch (...){
+        // destroying a std::thread that was not joined calls std::terminate
+        for (std::thread& thread : threads){
+            thread.join();
+        }
+        throw;
+    }
+    work(0);
+    for (std::thread& thread : threads){
+        thread.join();
+    }
+}
+
+/** Calculate the magnetic field at many points in International Terrestrial Reference System coordinates, units Tesla,
+using several threads, see GeoMagParallel.
+ INPUT:
+    dyear(should be around the epoch of the model): The decimal year, shared by all points.
+    x, y, z(Above the surface of earth): Arrays of count position components, units m.
+    count: Number of points.
+    WMM(): Magnetic field model to use.
+    options(): Number of threads, chunk size, and kernel.
+ OUTPUT:
+    bx, by, bz: Arrays of count magnetic field components, units Tesla.
+ */
+inline void GeoMagParallel(float dyear, const TPrecision* x, const TPrecision* y, const TPrecision* z, size_t count, const ConstModel& WMM, TPrecision* bx, TPrecision* by, TPrecision* bz, ParallelOptions options= ParallelOptions()){
+    DerivativeCoeffs coeffs= derivativeCoeffs(snapshotModel(dyear, WMM));
+    GeoMagParallel(x, y, z, count, coeffs, bx, by, bz, options);
+}
+}
+#endif /* GEOMAG_PARALLEL_HPP */
@@ -0,0 +1,133 @@
+/*
+MIT License
+
+Copyright (c) 2019 Nathan Zimmerberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/** \file
+ * \brief Magnetic field at many radii along one geocentric direction.
+ * \details Along a fixed direction the V,W terms of degree n are proportional to (EARTH_R/r)^(n+1),
+so the recursion is run once at r=EARTH_R, the field is summed separately for each degree,
+and the field at each radius is a polynomial in EARTH_R/r, evaluated by Horner's rule.
+*/
+#ifndef GEOMAG_PROFILE_HPP
+#define GEOMAG_PROFILE_HPP
+
+#include <stddef.h>
+#include "XYZgeomag.hpp"
+
+namespace geomag
+{
+/** The field of each degree along one direction at r=EARTH_R, made by radialProfile.*/
+struct RadialProfile{
+    Vector direction;//unit vector in International Terrestrial Reference System coordinates
+    TPrecision sums[3][NMAX+2];//sums[k][n] is field component k of the V,W terms of degree n at r=EARTH_R, units Tesla
+};
+
+/** Return the radial profile of a direction.
+ INPUT:
+    direction(not zero): Direction in International Terrestrial Reference System coordinates, any length.
+    coeffs(): Derivative coefficients made by derivativeCoeffs.
+ */
+inline RadialProfile radialProfile(Vector direction, const DerivativeCoeffs& coeffs){
+    RadialProfile profile;
+    TPrecision length= std::sqrt(direction.x*direction.x+direction.y*direction.y+direction.z*direction.z);
+    profile.direction= {direction.x/length, direction.y/length, direction.z/length};
+    for (int k = 0; k < 3; k++){
+        for (int n = 0; n <= NMAX+1; n++){
+            profile.sums[k][n]= 0;
+        }
+    }
+    // at r=EARTH_R, a=x/r, b=y/r, f=z/r, g=1, and V0,0=1
+    Vector u= profile.direction;
+    recurseTerms<NMAX+1>(u.x, u.y, u.z, 1, 1, RECURRENCE_PLAN, NMAX+1, [&](int n, int, int index, TPrecision Vnm, TPrecision Wnm){
+        profile.sums[0][n]+= coeffs.XV[index]*Vnm+coeffs.XW[index]*Wnm;
+        profile.sums[1][n]+= coeffs.YV[index]*Vnm+coeffs.YW[index]*Wnm;
+        profile.sums[2][n]+= coeffs.ZV[index]*Vnm+coeffs.ZW[index]*Wnm;
+    });
+    return profile;
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla,
+at radius r along the direction of profile.
+ INPUT:
+    profile(): Radial profile made by radialProfile.
+    r(Above the surface of earth): Distance from the center of the earth, units m.
+ */
+inline Vector profileField(const RadialProfile& profile, TPrecision r){
+    TPrecision q= EARTH_R/r;
+    TPrecision bx= profile.sums[0][NMAX+1];
+    TPrecision by= profile.sums[1][NMAX+1];
+    TPrecision bz= profile.sums[2][NMAX+1];
+    for (int n = NMAX; n >= 0; n--){
+        bx= bx*q+profile.sums[0][n];
+        by= by*q+profile.sums[1][n];
+        bz= bz*q+profile.sums[2][n];
+    }
+    return {bx*q, by*q, bz*q};
+}
+
+/** Calculate the magnetic field at many radii along one direction in International Terrestrial Reference System coordinates, units Tesla.
+Within rounding of GeoMag(position_itrs, coeffs) at each point.
+ INPUT:
+    direction(not zero): Direction in International Terrestrial Reference System coordinates, any length.
+    radii(Above the surface of earth): Array of count distances from the center of the earth, units m.
+    count: Number of points.
+    coeffs(): Derivative coefficients made by derivativeCoeffs, shared by all points.
+ OUTPUT:
+    bx, by, bz: Arrays of count magnetic field components, units Tesla.
+ */
+inline void GeoMagProfile(Vector direction, const TPrecision* radii, size_t count, const DerivativeCoeffs& coeffs, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    RadialProfile profile= radialProfile(direction, coeffs);
+    for (size_t i = 0; i < count; i++){
+        Vector field= profileField(profile, radii[i]);
+        bx[i]= field.x;
+        by[i]= field.y;
+        bz[i]= field.z;
+    }
+}
+
+/** Calculate the magnetic field at many heights above a point on the WGS 84 ellipsoid in International Terrestrial Reference System coordinates, units Tesla.
+The heights are measured along the geocentric radius through the point on the ellipsoid, not along the geodetic vertical,
+which moves the points horizontally by up to about 0.0034 times the height, 34 m at 10 km, compared to geodetic2ecef(lat, lon, h).
+ INPUT:
+    lat: Geodetic latitude in degrees, -90 at the south pole, 90 at the north pole.
+    lon: Geodetic longitude in degrees.
+    heights(Above the surface of earth): Array of count heights above the ellipsoid along the radius, units m.
+    count: Number of points.
+    coeffs(): Derivative coefficients made by derivativeCoeffs, shared by all points.
+ OUTPUT:
+    bx, by, bz: Arrays of count magnetic field components, units Tesla.
+ */
+inline void GeoMagProfile(TPrecision lat, TPrecision lon, const TPrecision* heights, size_t count, const DerivativeCoeffs& coeffs, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    Vector surface= geodetic2ecef(lat, lon, 0);
+    TPrecision r0= std::sqrt(surface.x*surface.x+surface.y*surface.y+surface.z*surface.z);
+    RadialProfile profile= radialProfile(surface, coeffs);
+    for (size_t i = 0; i < count; i++){
+        Vector field= profileField(profile, r0+heights[i]);
+        bx[i]= field.x;
+        by[i]= field.y;
+        bz[i]= field.z;
+    }
+}
+}
+#endif /* GEOMAG_PROFILE_HPP */
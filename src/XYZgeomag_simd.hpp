@@ -0,0 +1,240 @@
+/*
+MIT License
+
+Copyright (c) 2019 Nathan Zimmerberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/** \file
+ * \brief x86-64 SSE2, AVX2, and AVX-512 versions of geomag::GeoMagBatch, geomag::GeoMagGemm, and geomag::GeoMagColumns.
+ * \details Each vector lane evaluates one point,
+4 floats or 2 doubles per instruction with SSE2,
+8 floats or 4 doubles per instruction with AVX2,
+16 floats or 8 doubles per instruction with AVX-512.
+
+The kernels are compiled with the instruction set enabled per function,
+so they are available without -mavx2 or -mavx512f,
+but they must only be called if supported() is true on the running CPU.
+XYZgeomag_dispatch.hpp picks the best supported kernels at run time.
+Requires GCC or Clang.
+*/
+#ifndef GEOMAG_SIMD_HPP
+#define GEOMAG_SIMD_HPP
+
+#include "XYZgeomag_batch.hpp"
+#include "XYZgeomag_columns.hpp"
+#include "XYZgeomag_gemm.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define XYZgeomag_HAVE_SIMD 1
+#include <cpuid.h>
+#include <immintrin.h>
+
+#if defined(__clang__)
+  #define XYZgeomag_TARGET_PUSH(isa) _Pragma(XYZgeomag_STR(clang attribute push (__attribute__((target(isa))), apply_to = function)))
+  #define XYZgeomag_TARGET_POP _Pragma("clang attribute pop")
+#else
+  #define XYZgeomag_TARGET_PUSH(isa) _Pragma("GCC push_options") _Pragma(XYZgeomag_STR(GCC target(isa)))
+  #define XYZgeomag_TARGET_POP _Pragma("GCC pop_options")
+#endif
+#define XYZgeomag_STR(x) #x
+
+namespace geomag
+{
+// The CPU checks are compiled for the baseline instruction set, outside the target regions.
+
+/** The instruction sets the running CPU and operating system support, made by detectCpuFeatures.*/
+struct CpuFeatures{
+    bool sse2;
+    bool avx2;//also requires the operating system to save the ymm registers
+    bool fma;
+    bool avx512f;//also requires the operating system to save the zmm and mask registers
+};
+
+/** Return the instruction sets of the running CPU from cpuid,
+and from xgetbv which registers the operating system saves on a context switch.*/
+inline CpuFeatures detectCpuFeatures(){
+    CpuFeatures features= {false, false, false, false};
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)){
+        return features;
+    }
+    features.sse2= (edx>>26)&1;
+    bool osxsave= (ecx>>27)&1;
+    bool avx= (ecx>>28)&1;
+    bool fma= (ecx>>12)&1;
+    unsigned long long xcr0= 0;
+    if (osxsave){
+        unsigned lo, hi;
+        __asm__ ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        xcr0= ((unsigned long long)hi<<32)|lo;
+    }
+    bool ymm= (xcr0&0x06) == 0x06;//xmm and ymm state
+    bool zmm= (xcr0&0xE6) == 0xE6;//also opmask, and the upper zmm registers
+    features.fma= avx && fma && ymm;
+    if (__get_cpuid_max(0, nullptr) >= 7){
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        features.avx2= avx && ymm && ((ebx>>5)&1);
+        features.avx512f= zmm && ((ebx>>16)&1);
+    }
+    return features;
+}
+
+/** Return the instruction sets of the running CPU, detected on the first call.*/
+inline const CpuFeatures& cpuFeatures(){
+    static const CpuFeatures features= detectCpuFeatures();
+    return features;
+}
+
+namespace sse
+{
+/** Return true if the running CPU supports the sse kernels.*/
+inline bool supported(){
+    return cpuFeatures().sse2;
+}
+}
+namespace avx2
+{
+/** Return true if the running CPU supports the avx2 kernels.*/
+inline bool supported(){
+    return cpuFeatures().avx2 && cpuFeatures().fma;
+}
+}
+namespace avx512
+{
+/** Return true if the running CPU supports the avx512 kernels.*/
+inline bool supported(){
+    return cpuFeatures().avx512f;
+}
+}
+
+XYZgeomag_TARGET_PUSH("sse2")
+namespace sse
+{
+#if defined(XYZgeomag_DOUBLE_PRECISION)
+struct L{
+    typedef __m128d T;
+    enum { WIDTH= 2 };
+    static inline T set1(TPrecision a){ return _mm_set1_pd(a); }
+    static inline T load(const TPrecision* p){ return _mm_loadu_pd(p); }
+    static inline void store(TPrecision* p, T a){ _mm_storeu_pd(p,a); }
+    static inline T add(T a, T b){ return _mm_add_pd(a,b); }
+    static inline T mul(T a, T b){ return _mm_mul_pd(a,b); }
+    static inline T div(T a, T b){ return _mm_div_pd(a,b); }
+    static inline T sqrt(T a){ return _mm_sqrt_pd(a); }
+    // SSE2 has no fused multiply add
+    static inline T fmadd(T a, T b, T c){ return _mm_add_pd(_mm_mul_pd(a,b),c); }
+    static inline T fnmadd(T a, T b, T c){ return _mm_sub_pd(c,_mm_mul_pd(a,b)); }
+};
+#else
+struct L{
+    typedef __m128 T;
+    enum { WIDTH= 4 };
+    static inline T set1(TPrecision a){ return _mm_set1_ps(a); }
+    static inline T load(const TPrecision* p){ return _mm_loadu_ps(p); }
+    static inline void store(TPrecision* p, T a){ _mm_storeu_ps(p,a); }
+    static inline T add(T a, T b){ return _mm_add_ps(a,b); }
+    static inline T mul(T a, T b){ return _mm_mul_ps(a,b); }
+    static inline T div(T a, T b){ return _mm_div_ps(a,b); }
+    static inline T sqrt(T a){ return _mm_sqrt_ps(a); }
+    static inline T fmadd(T a, T b, T c){ return _mm_add_ps(_mm_mul_ps(a,b),c); }
+    static inline T fnmadd(T a, T b, T c){ return _mm_sub_ps(c,_mm_mul_ps(a,b)); }
+};
+#endif
+#include "XYZgeomag_simd_kernel.inl"
+}
+XYZgeomag_TARGET_POP
+
+XYZgeomag_TARGET_PUSH("avx2,fma")
+namespace avx2
+{
+#if defined(XYZgeomag_DOUBLE_PRECISION)
+struct L{
+    typedef __m256d T;
+    enum { WIDTH= 4 };
+    static inline T set1(TPrecision a){ return _mm256_set1_pd(a); }
+    static inline T load(const TPrecision* p){ return _mm256_loadu_pd(p); }
+    static inline void store(TPrecision* p, T a){ _mm256_storeu_pd(p,a); }
+    static inline T add(T a, T b){ return _mm256_add_pd(a,b); }
+    static inline T mul(T a, T b){ return _mm256_mul_pd(a,b); }
+    static inline T div(T a, T b){ return _mm256_div_pd(a,b); }
+    static inline T sqrt(T a){ return _mm256_sqrt_pd(a); }
+    static inline T fmadd(T a, T b, T c){ return _mm256_fmadd_pd(a,b,c); }
+    static inline T fnmadd(T a, T b, T c){ return _mm256_fnmadd_pd(a,b,c); }
+};
+#else
+struct L{
+    typedef __m256 T;
+    enum { WIDTH= 8 };
+    static inline T set1(TPrecision a){ return _mm256_set1_ps(a); }
+    static inline T load(const TPrecision* p){ return _mm256_loadu_ps(p); }
+    static inline void store(TPrecision* p, T a){ _mm256_storeu_ps(p,a); }
+    static inline T add(T a, T b){ return _mm256_add_ps(a,b); }
+    static inline T mul(T a, T b){ return _mm256_mul_ps(a,b); }
+    static inline T div(T a, T b){ return _mm256_div_ps(a,b); }
+    static inline T sqrt(T a){ return _mm256_sqrt_ps(a); }
+    static inline T fmadd(T a, T b, T c){ return _mm256_fmadd_ps(a,b,c); }
+    static inline T fnmadd(T a, T b, T c){ return _mm256_fnmadd_ps(a,b,c); }
+};
+#endif
+#include "XYZgeomag_simd_kernel.inl"
+}
+XYZgeomag_TARGET_POP
+
+XYZgeomag_TARGET_PUSH("avx512f")
+namespace avx512
+{
+#if defined(XYZgeomag_DOUBLE_PRECISION)
+struct L{
+    typedef __m512d T;
+    enum { WIDTH= 8 };
+    static inline T set1(TPrecision a){ return _mm512_set1_pd(a); }
+    static inline T load(const TPrecision* p){ return _mm512_loadu_pd(p); }
+    static inline void store(TPrecision* p, T a){ _mm512_storeu_pd(p,a); }
+    static inline T add(T a, T b){ return _mm512_add_pd(a,b); }
+    static inline T mul(T a, T b){ return _mm512_mul_pd(a,b); }
+    static inline T div(T a, T b){ return _mm512_div_pd(a,b); }
+    // the masked form avoids a spurious -Wmaybe-uninitialized from _mm512_sqrt in GCC 12
+    static inline T sqrt(T a){ return _mm512_mask_sqrt_pd(a,(__mmask8)0xFF,a); }
+    static inline T fmadd(T a, T b, T c){ return _mm512_fmadd_pd(a,b,c); }
+    static inline T fnmadd(T a, T b, T c){ return _mm512_fnmadd_pd(a,b,c); }
+};
+#else
+struct L{
+    typedef __m512 T;
+    enum { WIDTH= 16 };
+    static inline T set1(TPrecision a){ return _mm512_set1_ps(a); }
+    static inline T load(const TPrecision* p){ return _mm512_loadu_ps(p); }
+    static inline void store(TPrecision* p, T a){ _mm512_storeu_ps(p,a); }
+    static inline T add(T a, T b){ return _mm512_add_ps(a,b); }
+    static inline T mul(T a, T b){ return _mm512_mul_ps(a,b); }
+    static inline T div(T a, T b){ return _mm512_div_ps(a,b); }
+    static inline T sqrt(T a){ return _mm512_mask_sqrt_ps(a,(__mmask16)0xFFFF,a); }
+    static inline T fmadd(T a, T b, T c){ return _mm512_fmadd_ps(a,b,c); }
+    static inline T fnmadd(T a, T b, T c){ return _mm512_fnmadd_ps(a,b,c); }
+};
+#endif
+#include "XYZgeomag_simd_kernel.inl"
+}
+XYZgeomag_TARGET_POP
+}
+#endif /* x86 */
+#endif /* GEOMAG_SIMD_HPP */
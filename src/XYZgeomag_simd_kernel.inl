@@ -0,0 +1,365 @@
+/*
+MIT License
+
+Copyright (c) 2019 Nathan Zimmerberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/** \file
+ * \brief SIMD GeoMag kernel, written once against a lane type L.
+ * \details Only included by XYZgeomag_simd.hpp, once per instruction set,
+inside a namespace that defines L and with that instruction set enabled,
+so every function here is compiled for that instruction set.
+
+L must provide the vector type T, the lane count WIDTH, and
+set1, load, store, add, mul, div, sqrt, fmadd(a,b,c)=a*b+c, fnmadd(a,b,c)=c-a*b.
+*/
+
+/** Calculate the magnetic field at count points, see GeoMagBatch.
+count must be a multiple of L::WIDTH and at most BATCH_BLOCK.*/
+inline void GeoMagLanes(const TPrecision* x, const TPrecision* y, const TPrecision* z, int count, const DerivativeCoeffs& coeffs, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    typedef L::T T;
+    const RecurrencePlan& plan= RECURRENCE_PLAN;
+    alignas(64) TPrecision a[BATCH_BLOCK];
+    alignas(64) TPrecision b[BATCH_BLOCK];
+    alignas(64) TPrecision f[BATCH_BLOCK];
+    alignas(64) TPrecision g[BATCH_BLOCK];
+    alignas(64) TPrecision Vtop[BATCH_BLOCK];
+    alignas(64) TPrecision Wtop[BATCH_BLOCK];
+    alignas(64) TPrecision Vprev[BATCH_BLOCK];
+    alignas(64) TPrecision Wprev[BATCH_BLOCK];
+    alignas(64) TPrecision Vnm[BATCH_BLOCK];
+    alignas(64) TPrecision Wnm[BATCH_BLOCK];
+    const T zero= L::set1(0);
+    const T r= L::set1(EARTH_R);
+    int i,n,m;
+    for (i = 0; i < count; i+= L::WIDTH){
+        T xi= L::load(x+i);
+        T yi= L::load(y+i);
+        T zi= L::load(z+i);
+        T rsqrd= L::fmadd(xi,xi,L::fmadd(yi,yi,L::mul(zi,zi)));
+        T temp= L::div(r,rsqrd);
+        L::store(a+i,L::mul(xi,temp));
+        L::store(b+i,L::mul(yi,temp));
+        L::store(f+i,L::mul(zi,temp));
+        L::store(g+i,L::mul(r,temp));
+        L::store(bx+i,zero);
+        L::store(by+i,zero);
+        L::store(bz+i,zero);
+        L::store(Vtop+i,L::div(r,L::sqrt(rsqrd)));//V0,0
+        L::store(Wtop+i,zero);//W0,0
+    }
+
+    for (m = 0; m <= NMAX+1; m++){
+        int index= termIndex(m,m);
+        T xv= L::set1(coeffs.XV[index]);
+        T xw= L::set1(coeffs.XW[index]);
+        T yv= L::set1(coeffs.YV[index]);
+        T yw= L::set1(coeffs.YW[index]);
+        T zv= L::set1(coeffs.ZV[index]);
+        T zw= L::set1(coeffs.ZW[index]);
+        if (m!=0){
+            const T diag= L::set1(plan.diag[m]);
+            for (i = 0; i < count; i+= L::WIDTH){
+                T ai= L::load(a+i);
+                T bi= L::load(b+i);
+                T V= L::load(Vtop+i);
+                T W= L::load(Wtop+i);
+                L::store(Vtop+i,L::mul(diag,L::fnmadd(bi,W,L::mul(ai,V))));
+                L::store(Wtop+i,L::mul(diag,L::fmadd(ai,W,L::mul(bi,V))));
+            }
+        }
+        for (i = 0; i < count; i+= L::WIDTH){
+            T V= L::load(Vtop+i);
+            T W= L::load(Wtop+i);
+            L::store(Vprev+i,zero);
+            L::store(Wprev+i,zero);
+            L::store(Vnm+i,V);
+            L::store(Wnm+i,W);
+            L::store(bx+i,L::fmadd(xv,V,L::fmadd(xw,W,L::load(bx+i))));
+            L::store(by+i,L::fmadd(yv,V,L::fmadd(yw,W,L::load(by+i))));
+            L::store(bz+i,L::fmadd(zv,V,L::fmadd(zw,W,L::load(bz+i))));
+        }
+        for (n = m+1; n <= NMAX+1; n++){
+            index++;
+            const T fcoef= L::set1(plan.fcoef[index]);
+            const T gcoef= L::set1(plan.gcoef[index]);
+            xv= L::set1(coeffs.XV[index]);
+            xw= L::set1(coeffs.XW[index]);
+            yv= L::set1(coeffs.YV[index]);
+            yw= L::set1(coeffs.YW[index]);
+            zv= L::set1(coeffs.ZV[index]);
+            zw= L::set1(coeffs.ZW[index]);
+            for (i = 0; i < count; i+= L::WIDTH){
+                T fc= L::mul(fcoef,L::load(f+i));
+                T gc= L::mul(gcoef,L::load(g+i));
+                T Vp= L::load(Vnm+i);
+                T Wp= L::load(Wnm+i);
+                T V= L::fnmadd(gc,L::load(Vprev+i),L::mul(fc,Vp));
+                T W= L::fnmadd(gc,L::load(Wprev+i),L::mul(fc,Wp));
+                L::store(Vprev+i,Vp);
+                L::store(Wprev+i,Wp);
+                L::store(Vnm+i,V);
+                L::store(Wnm+i,W);
+                L::store(bx+i,L::fmadd(xv,V,L::fmadd(xw,W,L::load(bx+i))));
+                L::store(by+i,L::fmadd(yv,V,L::fmadd(yw,W,L::load(by+i))));
+                L::store(bz+i,L::fmadd(zv,V,L::fmadd(zw,W,L::load(bz+i))));
+            }
+        }
+    }
+}
+
+/** Calculate the magnetic field at many points in International Terrestrial Reference System coordinates, units Tesla.
+Same interface as geomag::GeoMagBatch, the points left over after the last full vector are done by geomag::GeoMag.*/
+inline void GeoMagBatch(const TPrecision* x, const TPrecision* y, const TPrecision* z, size_t count, const DerivativeCoeffs& coeffs, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    for (size_t start= 0; start < count; start+= BATCH_BLOCK){
+        int len= (count-start < BATCH_BLOCK) ? (int)(count-start) : BATCH_BLOCK;
+        int vlen= len - len%L::WIDTH;
+        if (vlen > 0){
+            GeoMagLanes(x+start, y+start, z+start, vlen, coeffs, bx+start, by+start, bz+start);
+        }
+        for (size_t i= start+vlen; i < start+len; i++){
+            Vector out= geomag::GeoMag({x[i], y[i], z[i]}, coeffs);
+            bx[i]= out.x;
+            by[i]= out.y;
+            bz[i]= out.z;
+        }
+    }
+}
+
+/** Calculate the magnetic field at many points in International Terrestrial Reference System coordinates, units Tesla.
+Same interface as geomag::GeoMagBatch.*/
+inline void GeoMagBatch(const TPrecision* x, const TPrecision* y, const TPrecision* z, size_t count, const ModelSnapshot& snapshot, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    DerivativeCoeffs coeffs= derivativeCoeffs(snapshot);
+    // parentheses suppress argument dependent lookup, which would also find geomag::GeoMagBatch
+    (GeoMagBatch)(x, y, z, count, coeffs, bx, by, bz);
+}
+
+/** Calculate the magnetic field at many points in International Terrestrial Reference System coordinates, units Tesla.
+Same interface as geomag::GeoMagBatch.*/
+inline void GeoMagBatch(float dyear, const TPrecision* x, const TPrecision* y, const TPrecision* z, size_t count, const ConstModel& WMM, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    (GeoMagBatch)(x, y, z, count, snapshotModel(dyear, WMM), bx, by, bz);
+}
+
+/** Build the V,W terms of count<=GEMM_TILE points into a tile, see geomag::basisTile.*/
+inline void basisTileLanes(const TPrecision* x, const TPrecision* y, const TPrecision* z, int count, BasisTile& tile){
+    typedef L::T T;
+    const RecurrencePlan& plan= RECURRENCE_PLAN;
+    alignas(64) TPrecision px[GEMM_TILE];
+    alignas(64) TPrecision py[GEMM_TILE];
+    alignas(64) TPrecision pz[GEMM_TILE];
+    alignas(64) TPrecision a[GEMM_TILE];
+    alignas(64) TPrecision b[GEMM_TILE];
+    alignas(64) TPrecision f[GEMM_TILE];
+    alignas(64) TPrecision g[GEMM_TILE];
+    const T r= L::set1(EARTH_R);
+    int i,n,m;
+    for (i = 0; i < GEMM_TILE; i++){
+        px[i]= (i < count) ? x[i] : EARTH_R;
+        py[i]= (i < count) ? y[i] : 0;
+        pz[i]= (i < count) ? z[i] : 0;
+    }
+    for (i = 0; i < GEMM_TILE; i+= L::WIDTH){
+        T xi= L::load(px+i);
+        T yi= L::load(py+i);
+        T zi= L::load(pz+i);
+        T rsqrd= L::fmadd(xi,xi,L::fmadd(yi,yi,L::mul(zi,zi)));
+        T temp= L::div(r,rsqrd);
+        L::store(a+i,L::mul(xi,temp));
+        L::store(b+i,L::mul(yi,temp));
+        L::store(f+i,L::mul(zi,temp));
+        L::store(g+i,L::mul(r,temp));
+        L::store(tile.V[0]+i,L::div(r,L::sqrt(rsqrd)));//V0,0
+        L::store(tile.W[0]+i,L::set1(0));//W0,0
+    }
+    for (m = 0; m <= NMAX+1; m++){
+        int index= termIndex(m,m);
+        if (m!=0){
+            const T diag= L::set1(plan.diag[m]);
+            const TPrecision* Vtop= tile.V[termIndex(m-1,m-1)];
+            const TPrecision* Wtop= tile.W[termIndex(m-1,m-1)];
+            for (i = 0; i < GEMM_TILE; i+= L::WIDTH){
+                T ai= L::load(a+i);
+                T bi= L::load(b+i);
+                T V= L::load(Vtop+i);
+                T W= L::load(Wtop+i);
+                L::store(tile.V[index]+i,L::mul(diag,L::fnmadd(bi,W,L::mul(ai,V))));
+                L::store(tile.W[index]+i,L::mul(diag,L::fmadd(ai,W,L::mul(bi,V))));
+            }
+        }
+        for (n = m+1; n <= NMAX+1; n++){
+            index++;
+            const T fcoef= L::set1(plan.fcoef[index]);
+            const T gcoef= L::set1(plan.gcoef[index]);
+            const TPrecision* V1= tile.V[index-1];
+            const TPrecision* W1= tile.W[index-1];
+            for (i = 0; i < GEMM_TILE; i+= L::WIDTH){
+                T fc= L::mul(fcoef,L::load(f+i));
+                T V= L::mul(fc,L::load(V1+i));
+                T W= L::mul(fc,L::load(W1+i));
+                if (n > m+1){
+                    T gc= L::mul(gcoef,L::load(g+i));
+                    V= L::fnmadd(gc,L::load(tile.V[index-2]+i),V);
+                    W= L::fnmadd(gc,L::load(tile.W[index-2]+i),W);
+                }
+                L::store(tile.V[index]+i,V);
+                L::store(tile.W[index]+i,W);
+            }
+        }
+    }
+}
+
+/** Contract a tile with the packed coefficients, see geomag::gemmMicroKernel.
+The register tile is two vectors of points by the three components,
+the six sums stay in registers for all the terms. GEMM_TILE must be a multiple of 2*L::WIDTH.*/
+inline void gemmMicroKernelLanes(const BasisTile& tile, const PackedCoeffs& packed, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    typedef L::T T;
+    for (int i = 0; i < GEMM_TILE; i+= 2*L::WIDTH){
+        T x0= L::set1(0), x1= L::set1(0);
+        T y0= L::set1(0), y1= L::set1(0);
+        T z0= L::set1(0), z1= L::set1(0);
+        // the degree 0 term has no derivative coefficients
+        for (int t = 1; t < NUMTERMS; t++){
+            const TPrecision* c= packed.terms[t];
+            T V0= L::load(tile.V[t]+i);
+            T V1= L::load(tile.V[t]+i+L::WIDTH);
+            T W0= L::load(tile.W[t]+i);
+            T W1= L::load(tile.W[t]+i+L::WIDTH);
+            T cv= L::set1(c[0]);
+            T cw= L::set1(c[1]);
+            x0= L::fmadd(cv,V0,L::fmadd(cw,W0,x0));
+            x1= L::fmadd(cv,V1,L::fmadd(cw,W1,x1));
+            cv= L::set1(c[2]);
+            cw= L::set1(c[3]);
+            y0= L::fmadd(cv,V0,L::fmadd(cw,W0,y0));
+            y1= L::fmadd(cv,V1,L::fmadd(cw,W1,y1));
+            cv= L::set1(c[4]);
+            cw= L::set1(c[5]);
+            z0= L::fmadd(cv,V0,L::fmadd(cw,W0,z0));
+            z1= L::fmadd(cv,V1,L::fmadd(cw,W1,z1));
+        }
+        L::store(bx+i,x0);
+        L::store(bx+i+L::WIDTH,x1);
+        L::store(by+i,y0);
+        L::store(by+i+L::WIDTH,y1);
+        L::store(bz+i,z0);
+        L::store(bz+i+L::WIDTH,z1);
+    }
+}
+
+/** Calculate the magnetic field at many points in International Terrestrial Reference System coordinates, units Tesla.
+Same interface as geomag::GeoMagGemm.*/
+inline void GeoMagGemm(const TPrecision* x, const TPrecision* y, const TPrecision* z, size_t count, const DerivativeCoeffs& coeffs, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    PackedCoeffs packed= packCoeffs(coeffs);
+    BasisTile tile;
+    alignas(64) TPrecision sums[3][GEMM_TILE];
+    for (size_t start= 0; start < count; start+= GEMM_TILE){
+        int len= (count-start < GEMM_TILE) ? (int)(count-start) : GEMM_TILE;
+        basisTileLanes(x+start, y+start, z+start, len, tile);
+        gemmMicroKernelLanes(tile, packed, sums[0], sums[1], sums[2]);
+        for (int i = 0; i < len; i++){
+            bx[start+i]= sums[0][i];
+            by[start+i]= sums[1][i];
+            bz[start+i]= sums[2][i];
+        }
+    }
+}
+
+/** Calculate the magnetic field at many points in International Terrestrial Reference System coordinates, units Tesla.
+Same interface as geomag::GeoMagGemm.*/
+inline void GeoMagGemm(const TPrecision* x, const TPrecision* y, const TPrecision* z, size_t count, const ModelSnapshot& snapshot, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    DerivativeCoeffs coeffs= derivativeCoeffs(snapshot);
+    (GeoMagGemm)(x, y, z, count, coeffs, bx, by, bz);
+}
+
+/** Calculate the magnetic field at many points in International Terrestrial Reference System coordinates, units Tesla.
+Same interface as geomag::GeoMagGemm.*/
+inline void GeoMagGemm(float dyear, const TPrecision* x, const TPrecision* y, const TPrecision* z, size_t count, const ConstModel& WMM, TPrecision* bx, TPrecision* by, TPrecision* bz){
+    (GeoMagGemm)(x, y, z, count, snapshotModel(dyear, WMM), bx, by, bz);
+}
+
+/** The derivative coefficients interleaved for GeoMagColumns, one column per lane.*/
+typedef ColumnCoeffs<L::WIDTH> Columns;
+
+/** Return the derivative coefficients interleaved for GeoMagColumns. Call once per snapshot.*/
+inline Columns columnCoeffs(const DerivativeCoeffs& coeffs){
+    return geomag::columnCoeffs<L::WIDTH>(coeffs);
+}
+
+/** Return the magnetic field in International Terrestrial Reference System coordinates, units Tesla.
+Same as geomag::GeoMagColumns, with L::WIDTH columns in the lanes of one register.*/
+inline Vector GeoMagColumns(Vector position_itrs, const Columns& columns){
+    typedef L::T T;
+    constexpr int GROUPS= (NMAX+2+L::WIDTH-1)/L::WIDTH;
+    TPrecision x= position_itrs.x;
+    TPrecision y= position_itrs.y;
+    TPrecision z= position_itrs.z;
+    TPrecision rsqrd= x*x+y*y+z*z;
+    TPrecision temp= EARTH_R/rsqrd;
+    TPrecision a= x*temp;
+    TPrecision b= y*temp;
+    alignas(64) TPrecision Vtop[GROUPS*L::WIDTH]= {0};
+    alignas(64) TPrecision Wtop[GROUPS*L::WIDTH]= {0};
+    columnSeeds(a, b, EARTH_R/std::sqrt(rsqrd), Vtop, Wtop);
+    const T f= L::set1(z*temp);
+    const T g= L::set1(EARTH_R*temp);
+    T bx= L::set1(0);
+    T by= L::set1(0);
+    T bz= L::set1(0);
+    const ColumnStep<L::WIDTH>* step= columns.steps;
+    for (int m0 = 0; m0 <= NMAX+1; m0+= L::WIDTH){
+        T V= L::load(Vtop+m0);
+        T W= L::load(Wtop+m0);
+        T Vprev= L::set1(0);
+        T Wprev= L::set1(0);
+        // the products are formed off the chain of the sums, which only waits for one add per step
+        bx= L::add(bx,L::fmadd(L::load(step->XV),V,L::mul(L::load(step->XW),W)));
+        by= L::add(by,L::fmadd(L::load(step->YV),V,L::mul(L::load(step->YW),W)));
+        bz= L::add(bz,L::fmadd(L::load(step->ZV),V,L::mul(L::load(step->ZW),W)));
+        step++;
+        for (int s = 1; s <= NMAX+1-m0; s++, step++){
+            T fc= L::mul(L::load(step->fcoef),f);
+            T gc= L::mul(L::load(step->gcoef),g);
+            T Vn= L::fnmadd(gc,Vprev,L::mul(fc,V));
+            T Wn= L::fnmadd(gc,Wprev,L::mul(fc,W));
+            Vprev= V;
+            Wprev= W;
+            V= Vn;
+            W= Wn;
+            bx= L::add(bx,L::fmadd(L::load(step->XV),V,L::mul(L::load(step->XW),W)));
+            by= L::add(by,L::fmadd(L::load(step->YV),V,L::mul(L::load(step->YW),W)));
+            bz= L::add(bz,L::fmadd(L::load(step->ZV),V,L::mul(L::load(step->ZW),W)));
+        }
+    }
+    alignas(64) TPrecision sums[3][L::WIDTH];
+    L::store(sums[0],bx);
+    L::store(sums[1],by);
+    L::store(sums[2],bz);
+    // pairwise sum of the lanes, log2(L::WIDTH) adds deep
+    for (int width= L::WIDTH/2; width > 0; width/= 2){
+        for (int j = 0; j < width; j++){
+            sums[0][j]+= sums[0][j+width];
+            sums[1][j]+= sums[1][j+width];
+            sums[2][j]+= sums[2][j+width];
+        }
+    }
+    return {sums[0][0], sums[1][0], sums[2][0]};
+}
@@ -0,0 +1,647 @@
+/*
+MIT License
+
+Copyright (c) 2019 Nathan Zimmerberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+// ../src/XYZgeomag_table.hpp Generated by python script wmmtablegen.py
+/** \file
+ * \brief Declination, inclination, and total intensity of WMM2020 at decimal year 2022.500
+and height 0.0 m, by bilinear interpolation of a 5 degree table, without trig functions.
+ * \details For microcontrollers where GeoMag is too slow, the table is stored in PROGMEM if it is defined.
+Does not need XYZgeomag.hpp, and uses float like the Arduino.
+
+Maximum errors versus the full model, the largest errors at 21x21 points in every cell,
+0.25 degrees apart, times 1.1 to bound the errors between them:
+  declination 3.881 deg, where the horizontal intensity is at least 6000 nT,
+    and 3.240 deg there between latitudes -60 and 60,
+    near the magnetic poles the declination is not reliable,
+  inclination 1.360 deg,
+  total intensity 158.4 nT.
+*/
+#ifndef GEOMAG_TABLE_HPP
+#define GEOMAG_TABLE_HPP
+
+#include <stdint.h>
+#include <math.h>
+
+namespace geomag
+{
+constexpr float TABLE_DYEAR= 2022.500000;//decimal year of the table
+constexpr float TABLE_HEIGHT= 0.000000;//height above the WGS 84 ellipsoid of the table, units m
+constexpr float TABLE_RESOLUTION= 5.000000;//spacing of the table, units degrees
+constexpr int TABLE_NLAT= 37;//latitudes from -90 to 90
+constexpr int TABLE_NLON= 72;//longitudes from -180, wrapping at 180
+constexpr float TABLE_ANGLE_UNIT= 0.010000;//unit of the stored angles, deg
+constexpr float TABLE_INTENSITY_UNIT= 4.000000;//unit of the stored total intensity, nT
+constexpr float TABLE_MIN_HORIZONTAL= 6000.0f;//the declination errors are measured where the horizontal intensity is at least this, nT
+constexpr float TABLE_DECLINATION_ERROR= 3.881f;//maximum declination error, deg
+constexpr float TABLE_MID_LATITUDE= 60.0f;//the mid latitude declination error is measured between -TABLE_MID_LATITUDE and TABLE_MID_LATITUDE, deg
+constexpr float TABLE_MID_LATITUDE_DECLINATION_ERROR= 3.240f;//maximum declination error at mid latitudes, deg
+constexpr float TABLE_INCLINATION_ERROR= 1.360f;//maximum inclination error, deg
+constexpr float TABLE_TOTAL_ERROR= 158.4f;//maximum total intensity error, nT
+
+/** The quantized elements at each table point, stored by latitude row then longitude.*/
+struct ElementTable{
+    const int16_t declination[TABLE_NLAT*TABLE_NLON];//units TABLE_ANGLE_UNIT
+    const int16_t inclination[TABLE_NLAT*TABLE_NLON];//units TABLE_ANGLE_UNIT
+    const int16_t total[TABLE_NLAT*TABLE_NLON];//units TABLE_INTENSITY_UNIT
+};
+
+/** Declination, inclination, and total intensity, returned by GeoMagTable.*/
+typedef struct {
+    float declination;// deg, eastward of true North is positive
+    float inclination;// deg, downward is positive
+    float total;// nT
+} TableElements;
+
+/** Read the table entry at index.*/
+inline int16_t tableEntry(const int16_t* entries, int index){
+    #ifdef PROGMEM
+      return (int16_t)pgm_read_word_near(entries+index);
+    #endif /* PROGMEM */
+    return entries[index];
+}
+
+/** Return the declination, inclination, and total intensity at TABLE_DYEAR and TABLE_HEIGHT,
+interpolated from table, with the errors documented above.
+ INPUT:
+    lat: Geodetic latitude in degrees, -90 at the south pole, 90 at the north pole.
+    lon: Geodetic longitude in degrees.
+    table(): The table to use, for example WMM2020_TABLE.
+ */
+inline TableElements GeoMagTable(float lat, float lon, const ElementTable& table){
+    float u= (lat+90.0f)/TABLE_RESOLUTION;
+    if (u < 0){
+        u= 0;
+    }
+    int i= (int)u;
+    if (i > TABLE_NLAT-2){
+        i= TABLE_NLAT-2;
+    }
+    u-= i;
+    float v= fmodf((lon+180.0f)/TABLE_RESOLUTION, (float)TABLE_NLON);
+    if (v < 0){
+        v+= TABLE_NLON;
+    }
+    int j= (int)v;
+    if (j > TABLE_NLON-1){
+        j= TABLE_NLON-1;
+    }
+    v-= j;
+    int j1= (j+1 == TABLE_NLON) ? 0 : j+1;
+    const int corners[4]= {i*TABLE_NLON+j, i*TABLE_NLON+j1, (i+1)*TABLE_NLON+j, (i+1)*TABLE_NLON+j1};
+    const float weights[4]= {(1-u)*(1-v), (1-u)*v, u*(1-v), u*v};
+    float declination= 0;
+    float inclination= 0;
+    float total= 0;
+    int32_t first= tableEntry(table.declination, corners[0]);
+    for (int k = 0; k < 4; k++){
+        // unwrap the declination around the first corner
+        int32_t d= tableEntry(table.declination, corners[k]);
+        if (d-first > 18000){
+            d-= 36000;
+        } else if (d-first < -18000){
+            d+= 36000;
+        }
+        declination+= weights[k]*d;
+        inclination+= weights[k]*tableEntry(table.inclination, corners[k]);
+        total+= weights[k]*tableEntry(table.total, corners[k]);
+    }
+    declination*= TABLE_ANGLE_UNIT;
+    if (declination > 180.0f){
+        declination-= 360.0f;
+    } else if (declination < -180.0f){
+        declination+= 360.0f;
+    }
+    return {declination, inclination*TABLE_ANGLE_UNIT, total*TABLE_INTENSITY_UNIT};
+}
+
+// Table
+constexpr
+#ifdef PROGMEM
+    PROGMEM
+#endif /* PROGMEM */
+ElementTable WMM2020_TABLE = {
+{14890,14390,13890,13390,12890,12390,11890,11390,10890,10390,9890,9390,8890,8390,7890,7390,
+6890,6390,5890,5390,4890,4390,3890,3390,2890,2390,1890,1390,890,390,-110,-610,
+-1110,-1610,-2110,-2610,-3110,-3610,-4110,-4610,-5110,-5610,-6110,-6610,-7110,-7610,-8110,-8610,
+-9110,-9610,-10110,-10610,-11110,-11610,-12110,-12610,-13110,-13610,-14110,-14610,-15110,-15610,-16110,-16610,
+-17110,-17610,17890,17390,16890,16390,15890,15390,14139,13575,13019,12472,11934,11405,10884,10373,
+9869,9374,8887,8406,7933,7465,7003,6546,6094,5646,5201,4760,4321,3885,3451,3018,
+2587,2156,1726,1295,864,433,0,-434,-870,-1308,-1749,-2193,-2639,-3089,-3542,-3999,
+-4460,-4925,-5394,-5868,-6346,-6829,-7317,-7811,-8310,-8815,-9325,-9842,-10366,-10896,-11433,-11976,
+-12527,-13085,-13650,-14221,-14799,-15381,-15969,-16561,-17155,-17751,17653,17057,16464,15875,15290,14711,
+12923,12298,11701,11133,10590,10070,9573,9094,8633,8186,7751,7327,6913,6505,6104,5708,
+5316,4928,4542,4160,3779,3401,3024,2648,2274,1900,1526,1152,777,400,21,-361,
+-747,-1138,-1533,-1934,-2341,-2754,-3173,-3598,-4029,-4466,-4909,-5358,-5813,-6274,-6740,-7214,
+-7694,-8182,-8678,-9184,-9701,-10230,-10774,-11333,-11909,-12506,-13123,-13763,-14426,-15112,-15821,-16549,
+-17292,17953,17195,16440,15695,14966,14258,13577,11023,10415,9864,9360,8897,8467,8063,7681,
+7315,6963,6620,6284,5952,5621,5292,4962,4630,4297,3963,3627,3291,2955,2619,2285,
+1952,1621,1291,962,634,304,-29,-365,-708,-1057,-1415,-1781,-2157,-2543,-2938,-3342,
+-3754,-4172,-4597,-5027,-5461,-5899,-6340,-6785,-7234,-7688,-8149,-8618,-9097,-9590,-10101,-10634,
+-11195,-11790,-12428,-13118,-13869,-14690,-15586,-16557,-17591,17334,16251,15196,14200,13282,12448,11698,
+8580,8155,7779,7442,7134,6850,6584,6330,6086,5847,5610,5371,5128,4878,4620,4352,
+4074,3787,3490,3186,2877,2564,2251,1938,1629,1324,1024,729,439,150,-140,-434,
+-734,-1045,-1367,-1704,-2055,-2421,-2800,-3190,-3590,-3997,-4409,-4824,-5239,-5653,-6065,-6474,
+-6882,-7288,-7693,-8100,-8511,-8931,-9362,-9813,-10292,-10811,-11388,-12049,-12831,-13792,-15006,-16544,
+17603,15632,13836,12377,11244,10359,9653,9072,6362,6164,5978,5803,5638,5482,5333,5190,
+5050,4910,4766,4615,4454,4278,4085,3873,3641,3390,3121,2836,2538,2231,1921,1611,
+1306,1010,725,452,190,-63,-313,-563,-821,-1091,-1378,-1685,-2013,-2361,-2728,-3110,
+-3503,-3903,-4305,-4705,-5100,-5487,-5865,-6232,-6587,-6931,-7264,-7587,-7900,-8207,-8509,-8808,
+-9108,-9415,-9737,-10090,-10510,-11087,-12149,-15922,11228,8995,8186,7707,7353,7061,6806,6575,
+4821,4755,4681,4601,4521,4441,4364,4291,4220,4149,4075,3993,3899,3786,3651,3490,
+3299,3079,2830,2555,2257,1943,1620,1296,978,674,389,125,-117,-340,-551,-757,
+-969,-1193,-1439,-1712,-2014,-2344,-2699,-3074,-3461,-3854,-4246,-4630,-5003,-5359,-5696,-6013,
+-6306,-6576,-6822,-7041,-7232,-7392,-7516,-7594,-7614,-7549,-7357,-6950,-6154,-4623,-2012,885,
+2803,3833,4380,4673,4824,4888,4897,4871,3819,3813,3791,3757,3718,3675,3634,3596,
+3562,3532,3502,3468,3423,3362,3276,3160,3007,2815,2584,2314,2010,1680,1333,981,
+636,309,11,-255,-485,-684,-859,-1020,-1180,-1353,-1549,-1779,-2046,-2351,-2690,-3054,
+-3434,-3818,-4197,-4562,-4907,-5228,-5519,-5778,-6002,-6188,-6334,-6436,-6487,-6480,-6401,-6232,
+-5944,-5502,-4857,-3966,-2821,-1506,-198,935,1824,2481,2952,3284,3511,3661,3753,3802,
+3140,3159,3161,3149,3129,3105,3079,3055,3037,3024,3016,3009,2997,2972,2925,2846,
+2728,2564,2349,2083,1771,1419,1042,654,273,-83,-403,-677,-903,-1083,-1227,-1345,
+-1454,-1569,-1706,-1879,-2098,-2366,-2678,-3024,-3390,-3760,-4122,-4463,-4776,-5054,-5293,-5488,
+-5636,-5733,-5774,-5753,-5663,-5493,-5230,-4858,-4366,-3747,-3013,-2197,-1349,-527,225,881,
+1434,1887,2250,2534,2751,2910,3022,3096,2645,2676,2689,2690,2680,2664,2645,2626,
+2611,2602,2600,2602,2605,2601,2579,2530,2441,2301,2102,1841,1520,1147,739,315,
+-102,-488,-828,-1110,-1332,-1498,-1618,-1705,-1770,-1831,-1904,-2008,-2160,-2371,-2639,-2953,
+-3295,-3643,-3979,-4290,-4564,-4795,-4977,-5105,-5175,-5182,-5121,-4988,-4776,-4479,-4094,-3621,
+-3073,-2473,-1851,-1237,-656,-118,369,806,1192,1528,1815,2054,2248,2400,2513,2593,
+2263,2298,2317,2324,2322,2312,2297,2279,2263,2250,2244,2244,2247,2249,2241,2211,
+2142,2022,1837,1580,1252,861,426,-27,-470,-876,-1224,-1505,-1719,-1873,-1979,-2045,
+-2084,-2104,-2118,-2147,-2215,-2343,-2540,-2799,-3099,-3413,-3716,-3991,-4224,-4407,-4533,-4597,
+-4595,-4523,-4380,-4162,-3870,-3506,-3078,-2600,-2097,-1597,-1122,-684,-285,79,414,725,
+1012,1274,1508,1712,1884,2023,2131,2209,1957,1991,2012,2023,2026,2021,2010,1993,
+1975,1957,1942,1933,1929,1928,1922,1900,1844,1737,1561,1307,973,569,117,-353,
+-807,-1215,-1557,-1826,-2025,-2165,-2258,-2314,-2338,-2330,-2295,-2249,-2219,-2239,-2334,-2508,
+-2742,-3007,-3271,-3511,-3710,-3856,-3940,-3956,-3903,-3779,-3587,-3330,-3012,-2642,-2233,-1806,
+-1387,-998,-650,-345,-74,177,415,645,868,1080,1276,1452,1605,1732,1832,1906,
+1707,1738,1757,1769,1775,1774,1767,1753,1734,1712,1690,1670,1656,1646,1637,1615,
+1565,1463,1291,1037,699,288,-171,-643,-1092,-1487,-1811,-2058,-2235,-2356,-2434,-2475,
+-2480,-2443,-2360,-2241,-2112,-2013,-1984,-2046,-2192,-2395,-2620,-2837,-3021,-3153,-3222,-3221,
+-3150,-3013,-2815,-2563,-2265,-1931,-1574,-1216,-882,-588,-341,-134,47,219,391,569,
+749,926,1094,1249,1386,1502,1593,1661,1503,1528,1543,1553,1560,1562,1559,1548,
+1530,1506,1478,1451,1427,1409,1394,1370,1319,1217,1045,788,447,34,-421,-883,
+-1315,-1687,-1984,-2203,-2354,-2448,-2499,-2510,-2481,-2401,-2265,-2079,-1867,-1668,-1527,-1477,
+-1526,-1659,-1845,-2048,-2234,-2377,-2460,-2474,-2418,-2301,-2131,-1916,-1664,-1383,-1086,-795,
+-531,-311,-140,-5,111,226,353,495,647,801,949,1088,1212,1318,1402,1463,
+1339,1357,1366,1372,1376,1379,1378,1370,1355,1331,1301,1269,1240,1216,1196,1168,
+1113,1008,830,569,226,-183,-626,-1069,-1474,-1816,-2083,-2271,-2389,-2447,-2456,-2421,
+-2341,-2208,-2022,-1788,-1528,-1277,-1071,-944,-912,-976,-1115,-1298,-1487,-1648,-1756,-1800,
+-1778,-1698,-1572,-1407,-1208,-982,-741,-504,-296,-133,-16,65,134,210,307,425,
+559,698,833,960,1075,1174,1252,1306,1211,1221,1222,1222,1223,1224,1224,1219,
+1205,1183,1153,1120,1089,1063,1040,1008,947,834,650,384,42,-358,-783,-1200,
+-1574,-1885,-2118,-2272,-2351,-2365,-2322,-2231,-2094,-1913,-1692,-1441,-1176,-921,-701,-540,
+-459,-466,-557,-708,-886,-1052,-1179,-1249,-1261,-1221,-1140,-1024,-875,-699,-505,-314,
+-149,-27,50,94,128,177,253,357,480,610,738,858,967,1061,1135,1184,
+1114,1117,1111,1103,1099,1098,1098,1094,1082,1062,1034,1003,972,946,920,883,
+815,693,500,231,-108,-493,-896,-1284,-1626,-1903,-2102,-2219,-2257,-2222,-2127,-1982,
+-1798,-1584,-1351,-1108,-866,-637,-434,-271,-167,-137,-185,-300,-454,-612,-744,-830,
+-866,-859,-815,-740,-636,-502,-350,-196,-65,26,73,89,100,130,192,287,
+404,530,655,773,881,973,1045,1092,1043,1041,1029,1014,1005,1002,1001,999,
+990,972,946,916,886,859,831,787,708,576,375,103,-228,-597,-975,-1332,
+-1643,-1886,-2050,-2128,-2124,-2046,-1906,-1720,-1505,-1277,-1047,-826,-618,-424,-248,-99,
+11,62,45,-38,-165,-306,-433,-524,-574,-589,-574,-532,-463,-367,-250,-130,
+-28,38,63,60,55,71,123,212,326,451,577,696,806,902,976,1023,
+992,989,973,954,941,936,937,937,931,916,892,863,833,803,768,714,
+623,477,268,-5,-328,-678,-1031,-1358,-1635,-1844,-1972,-2014,-1973,-1859,-1687,-1477,
+-1248,-1018,-800,-603,-426,-266,-119,13,118,179,183,126,23,-100,-215,-305,
+-362,-389,-394,-377,-338,-273,-188,-97,-22,22,29,12,-6,0,44,128,
+240,365,493,618,734,837,918,970,952,953,938,919,906,902,905,910,
+908,896,874,845,812,776,730,662,554,394,174,-100,-414,-746,-1073,-1369,
+-1613,-1787,-1879,-1887,-1816,-1678,-1489,-1269,-1038,-813,-609,-432,-281,-147,-24,90,
+187,251,267,229,146,40,-64,-149,-207,-241,-258,-260,-242,-204,-148,-86,
+-36,-13,-22,-52,-80,-83,-46,32,140,266,398,529,655,768,860,922,
+914,926,919,904,895,896,905,916,920,913,892,862,823,777,717,630,
+502,323,91,-186,-493,-808,-1110,-1375,-1584,-1722,-1780,-1758,-1664,-1512,-1318,-1099,
+-873,-657,-465,-303,-169,-55,49,148,235,298,321,296,229,138,44,-34,
+-90,-128,-152,-165,-166,-150,-120,-85,-60,-59,-84,-126,-164,-177,-149,-80,
+24,149,284,423,560,687,793,871,869,899,906,904,905,914,932,951,
+963,962,944,911,865,806,728,618,467,267,19,-265,-567,-868,-1146,-1380,
+-1553,-1655,-1680,-1633,-1524,-1366,-1174,-963,-747,-541,-358,-206,-83,18,109,196,
+274,334,360,345,290,211,128,57,3,-35,-63,-84,-98,-101,-95,-87,
+-88,-109,-152,-208,-258,-282,-265,-206,-110,12,150,296,444,585,709,806,
+809,864,894,912,929,953,982,1012,1032,1036,1021,986,933,860,760,626,
+449,225,-41,-335,-638,-928,-1184,-1388,-1527,-1594,-1591,-1523,-1404,-1245,-1060,-858,
+-653,-456,-280,-134,-16,79,162,239,310,366,394,386,342,276,203,139,
+89,51,21,-7,-32,-52,-69,-87,-115,-161,-224,-296,-360,-397,-394,-347,
+-260,-142,-3,149,307,462,604,722,730,815,875,921,962,1004,1049,1090,
+1119,1129,1117,1080,1019,931,811,652,447,197,-90,-399,-706,-988,-1226,-1403,
+-1511,-1548,-1520,-1437,-1310,-1153,-974,-782,-586,-396,-225,-80,36,130,209,280,
+346,398,428,427,395,341,280,224,179,142,110,76,40,2,-37,-83,
+-139,-211,-298,-389,-469,-521,-532,-497,-420,-308,-170,-14,152,320,478,617,
+636,752,846,925,996,1062,1124,1178,1216,1233,1223,1184,1116,1014,875,690,
+458,181,-131,-456,-771,-1050,-1274,-1430,-1513,-1526,-1479,-1383,-1251,-1094,-920,-734,
+-544,-360,-190,-44,75,171,251,321,384,435,468,475,457,418,371,326,
+286,250,214,173,124,67,3,-72,-160,-262,-374,-487,-586,-653,-677,-654,
+-586,-479,-342,-183,-12,165,338,497,533,680,809,923,1026,1119,1202,1270,
+1318,1340,1333,1293,1218,1103,944,736,476,170,-167,-513,-839,-1119,-1335,-1475,
+-1540,-1536,-1475,-1369,-1232,-1074,-900,-717,-530,-347,-176,-26,100,202,287,361,
+425,480,519,538,536,516,487,454,420,385,343,291,226,146,53,-55,
+-177,-313,-455,-592,-709,-791,-827,-814,-752,-649,-512,-352,-176,8,193,370,
+432,606,768,916,1051,1172,1276,1360,1419,1449,1444,1403,1322,1195,1017,784,
+495,159,-207,-576,-917,-1203,-1415,-1546,-1600,-1585,-1514,-1401,-1259,-1096,-920,-735,
+-546,-360,-185,-27,108,222,318,400,473,536,587,622,641,644,635,617,
+591,556,506,439,352,244,116,-30,-193,-366,-540,-703,-839,-934,-979,-971,
+-913,-811,-674,-512,-331,-141,54,246,341,538,728,905,1069,1217,1343,1445,
+1518,1557,1558,1517,1430,1290,1092,832,511,139,-261,-658,-1017,-1312,-1525,-1653,
+-1700,-1678,-1601,-1483,-1334,-1165,-983,-791,-596,-403,-220,-51,98,228,341,440,
+529,609,679,737,781,810,825,824,807,770,711,625,510,367,197,5,
+-204,-421,-631,-821,-975,-1080,-1130,-1124,-1065,-962,-822,-656,-471,-273,-69,137,
+265,482,694,895,1084,1255,1403,1525,1614,1666,1675,1637,1545,1391,1171,878,
+517,102,-340,-772,-1156,-1463,-1681,-1807,-1851,-1824,-1742,-1617,-1461,-1284,-1092,-890,
+-685,-481,-284,-100,69,222,359,485,600,706,803,890,964,1023,1062,1080,
+1073,1037,966,858,711,525,305,57,-208,-474,-725,-944,-1114,-1228,-1279,-1270,
+-1208,-1100,-955,-783,-592,-386,-172,46,205,438,666,887,1096,1287,1457,1598,
+1706,1774,1796,1763,1668,1501,1253,920,508,35,-463,-940,-1354,-1678,-1900,-2025,
+-2064,-2031,-1941,-1808,-1642,-1453,-1248,-1033,-813,-593,-378,-171,24,206,377,537,
+688,830,963,1086,1194,1285,1353,1392,1398,1364,1284,1154,970,735,454,139,
+-192,-518,-816,-1066,-1254,-1374,-1424,-1411,-1342,-1227,-1075,-896,-696,-482,-258,-27,
+153,399,642,878,1104,1314,1502,1664,1792,1878,1914,1890,1793,1610,1329,944,
+462,-89,-660,-1195,-1645,-1984,-2208,-2326,-2353,-2308,-2205,-2057,-1877,-1672,-1450,-1216,
+-976,-734,-494,-259,-31,189,401,603,798,983,1159,1323,1471,1598,1698,1764,
+1790,1765,1683,1535,1317,1028,677,281,-134,-535,-891,-1180,-1389,-1516,-1566,-1548,
+-1472,-1349,-1189,-1001,-792,-568,-333,-92,97,355,611,861,1101,1327,1533,1714,
+1860,1964,2014,1996,1895,1690,1364,907,329,-328,-993,-1593,-2074,-2417,-2627,-2723,
+-2727,-2657,-2530,-2360,-2156,-1929,-1683,-1425,-1159,-888,-617,-347,-80,182,439,689,
+931,1165,1388,1598,1789,1958,2097,2200,2256,2256,2186,2036,1795,1458,1031,538,
+17,-484,-920,-1265,-1507,-1650,-1705,-1685,-1604,-1474,-1306,-1110,-892,-657,-412,-159,
+19,288,555,817,1070,1308,1528,1721,1881,1995,2050,2028,1907,1659,1259,693,
+-20,-811,-1573,-2216,-2693,-3003,-3168,-3216,-3174,-3062,-2897,-2692,-2456,-2197,-1920,-1631,
+-1333,-1029,-722,-413,-105,200,502,800,1090,1373,1644,1902,2142,2359,2548,2699,
+2805,2851,2823,2704,2475,2118,1631,1032,373,-272,-835,-1275,-1580,-1760,-1834,-1823,
+-1744,-1612,-1439,-1236,-1010,-767,-512,-249,-112,164,438,706,964,1207,1428,1620,
+1773,1874,1904,1839,1648,1294,745,-2,-889,-1787,-2563,-3144,-3522,-3726,-3794,-3759,
+-3645,-3473,-3257,-3006,-2729,-2432,-2119,-1795,-1462,-1123,-779,-433,-87,260,604,944,
+1279,1607,1926,2233,2525,2798,3046,3263,3440,3565,3623,3594,3450,3161,2696,2043,
+1237,374,-422,-1059,-1509,-1785,-1920,-1945,-1886,-1765,-1597,-1394,-1166,-918,-657,-387,
+-384,-118,144,396,633,847,1029,1169,1250,1252,1147,898,466,-178,-1018,-1958,
+-2847,-3564,-4063,-4361,-4497,-4508,-4426,-4273,-4068,-3821,-3543,-3241,-2919,-2582,-2232,-1873,
+-1507,-1135,-758,-380,1,382,762,1140,1515,1886,2250,2607,2954,3288,3607,3905,
+4178,4418,4614,4753,4812,4762,4559,4145,3457,2473,1293,143,-774,-1395,-1761,-1935,
+-1972,-1913,-1785,-1609,-1399,-1164,-912,-651,-1768,-1645,-1550,-1497,-1505,-1593,-1783,-2094,
+-2539,-3108,-3756,-4412,-4999,-5463,-5787,-5978,-6053,-6033,-5937,-5780,-5575,-5331,-5056,-4756,
+-4434,-4096,-3742,-3377,-3002,-2619,-2228,-1832,-1431,-1025,-616,-205,208,623,1039,1455,
+1871,2287,2701,3113,3523,3930,4334,4732,5124,5509,5886,6250,6601,6933,7240,7514,
+7741,7898,7947,7816,7361,6291,4203,1458,-552,-1582,-2044,-2213,-2227,-2156,-2040,-1905,
+-17107,-16607,-16107,-15607,-15107,-14607,-14107,-13607,-13107,-12607,-12107,-11607,-11107,-10607,-10107,-9607,
+-9107,-8607,-8107,-7607,-7107,-6607,-6107,-5607,-5107,-4607,-4107,-3607,-3107,-2607,-2107,-1607,
+-1107,-607,-107,393,893,1393,1893,2393,2893,3393,3893,4393,4893,5393,5893,6393,
+6893,7393,7893,8393,8893,9393,9893,10393,10893,11393,11893,12393,12893,13393,13893,14393,
+14893,15393,15893,16393,16893,17393,17893,-17607},
+{-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,
+-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,
+-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,
+-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,
+-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7203,-7532,-7518,-7501,-7482,-7461,-7438,-7413,-7387,
+-7359,-7331,-7302,-7272,-7242,-7212,-7182,-7153,-7124,-7096,-7069,-7043,-7018,-6995,-6973,-6953,
+-6935,-6918,-6903,-6890,-6879,-6871,-6864,-6859,-6857,-6857,-6858,-6863,-6869,-6878,-6889,-6902,
+-6917,-6935,-6955,-6976,-7000,-7025,-7052,-7081,-7110,-7141,-7172,-7204,-7237,-7269,-7301,-7332,
+-7362,-7391,-7419,-7445,-7469,-7490,-7509,-7525,-7538,-7548,-7555,-7559,-7560,-7558,-7552,-7543,
+-7825,-7789,-7748,-7704,-7656,-7606,-7553,-7498,-7442,-7384,-7326,-7268,-7209,-7151,-7094,-7039,
+-6985,-6933,-6884,-6838,-6794,-6754,-6717,-6684,-6654,-6628,-6605,-6585,-6568,-6555,-6544,-6537,
+-6533,-6532,-6535,-6541,-6550,-6564,-6581,-6603,-6629,-6660,-6695,-6734,-6778,-6825,-6877,-6932,
+-6990,-7051,-7115,-7180,-7246,-7313,-7380,-7446,-7510,-7573,-7632,-7688,-7739,-7785,-7825,-7858,
+-7885,-7903,-7914,-7917,-7912,-7900,-7881,-7856,-8029,-7964,-7895,-7823,-7749,-7673,-7595,-7515,
+-7435,-7353,-7270,-7187,-7104,-7021,-6940,-6861,-6785,-6713,-6645,-6582,-6525,-6474,-6429,-6390,
+-6357,-6329,-6307,-6289,-6274,-6263,-6255,-6249,-6246,-6246,-6248,-6254,-6265,-6280,-6300,-6326,
+-6359,-6399,-6446,-6500,-6561,-6628,-6703,-6783,-6868,-6959,-7053,-7150,-7250,-7351,-7453,-7555,
+-7655,-7752,-7846,-7934,-8016,-8090,-8153,-8203,-8239,-8260,-8265,-8254,-8229,-8192,-8145,-8090,
+-8082,-7990,-7899,-7808,-7716,-7624,-7531,-7437,-7341,-7243,-7144,-7043,-6940,-6838,-6736,-6636,
+-6539,-6447,-6362,-6285,-6217,-6159,-6112,-6075,-6047,-6029,-6017,-6011,-6009,-6010,-6011,-6013,
+-6015,-6018,-6021,-6026,-6034,-6047,-6066,-6093,-6128,-6173,-6228,-6293,-6369,-6454,-6549,-6652,
+-6763,-6880,-7002,-7129,-7259,-7391,-7524,-7658,-7791,-7923,-8051,-8174,-8290,-8397,-8488,-8557,
+-8596,-8598,-8566,-8507,-8433,-8350,-8263,-8173,-7968,-7866,-7766,-7668,-7571,-7474,-7377,-7278,
+-7177,-7073,-6965,-6854,-6738,-6620,-6501,-6382,-6265,-6155,-6053,-5962,-5885,-5824,-5779,-5750,
+-5738,-5739,-5750,-5769,-5792,-5815,-5836,-5854,-5866,-5874,-5879,-5881,-5884,-5890,-5903,-5924,
+-5955,-6000,-6058,-6131,-6217,-6317,-6429,-6552,-6683,-6823,-6968,-7119,-7273,-7429,-7587,-7746,
+-7904,-8062,-8217,-8370,-8519,-8664,-8802,-8917,-8888,-8769,-8646,-8525,-8407,-8292,-8181,-8073,
+-7745,-7643,-7543,-7445,-7349,-7254,-7159,-7062,-6962,-6858,-6748,-6633,-6511,-6383,-6250,-6115,
+-5982,-5854,-5735,-5631,-5546,-5483,-5445,-5432,-5443,-5475,-5521,-5578,-5638,-5697,-5749,-5791,
+-5821,-5839,-5846,-5845,-5839,-5832,-5830,-5837,-5857,-5893,-5948,-6021,-6113,-6223,-6347,-6485,
+-6633,-6789,-6951,-7118,-7287,-7458,-7629,-7798,-7966,-8129,-8287,-8437,-8572,-8681,-8738,-8717,
+-8637,-8532,-8417,-8300,-8184,-8070,-7959,-7851,-7468,-7368,-7270,-7174,-7080,-6987,-6894,-6800,
+-6704,-6604,-6497,-6383,-6260,-6128,-5988,-5843,-5697,-5554,-5420,-5304,-5212,-5150,-5123,-5131,
+-5173,-5245,-5338,-5443,-5552,-5656,-5748,-5824,-5880,-5914,-5929,-5926,-5910,-5887,-5863,-5846,
+-5844,-5861,-5902,-5968,-6058,-6170,-6302,-6449,-6607,-6773,-6944,-7118,-7291,-7463,-7631,-7794,
+-7947,-8089,-8212,-8312,-8379,-8407,-8396,-8350,-8279,-8191,-8094,-7992,-7887,-7781,-7675,-7571,
+-7159,-7061,-6964,-6868,-6774,-6681,-6590,-6498,-6404,-6308,-6206,-6096,-5977,-5847,-5707,-5558,
+-5403,-5249,-5105,-4978,-4881,-4822,-4808,-4843,-4923,-5041,-5187,-5347,-5510,-5665,-5803,-5919,
+-6009,-6071,-6103,-6107,-6086,-6047,-5999,-5952,-5918,-5905,-5921,-5968,-6047,-6154,-6285,-6434,
+-6595,-6764,-6935,-7105,-7271,-7430,-7580,-7716,-7835,-7933,-8006,-8051,-8068,-8059,-8026,-7975,
+-7910,-7833,-7747,-7655,-7559,-7460,-7360,-7259,-6820,-6721,-6624,-6527,-6431,-6336,-6242,-6149,
+-6056,-5961,-5863,-5759,-5646,-5523,-5387,-5239,-5082,-4922,-4769,-4634,-4534,-4480,-4483,-4547,
+-4669,-4837,-5037,-5251,-5466,-5670,-5855,-6015,-6147,-6245,-6309,-6335,-6324,-6282,-6216,-6140,
+-6069,-6018,-5997,-6014,-6070,-6161,-6282,-6424,-6580,-6741,-6903,-7060,-7207,-7342,-7460,-7558,
+-7634,-7685,-7713,-7718,-7706,-7678,-7639,-7588,-7528,-7459,-7382,-7298,-7208,-7114,-7017,-6919,
+-6440,-6340,-6240,-6141,-6042,-5942,-5844,-5746,-5649,-5553,-5455,-5355,-5249,-5133,-5005,-4862,
+-4706,-4543,-4383,-4241,-4138,-4091,-4114,-4211,-4377,-4596,-4848,-5114,-5376,-5624,-5851,-6054,
+-6229,-6372,-6478,-6542,-6559,-6531,-6463,-6370,-6267,-6176,-6111,-6087,-6107,-6169,-6268,-6392,
+-6532,-6678,-6822,-6956,-7077,-7180,-7262,-7320,-7353,-7364,-7356,-7335,-7304,-7268,-7226,-7178,
+-7123,-7061,-6990,-6912,-6826,-6734,-6638,-6540,-6006,-5902,-5799,-5696,-5592,-5487,-5382,-5277,
+-5174,-5072,-4972,-4872,-4770,-4661,-4540,-4402,-4247,-4079,-3912,-3764,-3660,-3622,-3667,-3801,
+-4014,-4286,-4591,-4906,-5212,-5500,-5765,-6006,-6222,-6408,-6559,-6666,-6721,-6720,-6668,-6573,
+-6452,-6326,-6218,-6146,-6120,-6143,-6207,-6303,-6417,-6539,-6657,-6765,-6857,-6928,-6975,-6997,
+-6995,-6973,-6939,-6899,-6858,-6818,-6777,-6733,-6683,-6626,-6560,-6484,-6400,-6308,-6210,-6109,
+-5501,-5393,-5285,-5177,-5068,-4957,-4844,-4731,-4619,-4510,-4404,-4302,-4200,-4094,-3976,-3839,
+-3682,-3508,-3331,-3177,-3072,-3046,-3119,-3295,-3559,-3888,-4248,-4613,-4965,-5292,-5592,-5867,
+-6116,-6337,-6523,-6665,-6752,-6780,-6747,-6661,-6534,-6387,-6244,-6126,-6052,-6028,-6052,-6113,
+-6196,-6289,-6380,-6462,-6527,-6572,-6592,-6586,-6556,-6510,-6456,-6403,-6356,-6316,-6279,-6240,
+-6195,-6141,-6077,-6001,-5916,-5820,-5718,-5610,-4912,-4795,-4680,-4567,-4452,-4336,-4217,-4096,
+-3975,-3857,-3744,-3636,-3531,-3424,-3304,-3164,-3000,-2815,-2628,-2467,-2366,-2357,-2461,-2682,
+-3001,-3388,-3808,-4228,-4629,-4998,-5333,-5636,-5909,-6149,-6353,-6511,-6614,-6656,-6636,-6558,
+-6431,-6272,-6104,-5951,-5836,-5771,-5756,-5782,-5835,-5900,-5967,-6027,-6074,-6100,-6102,-6077,
+-6028,-5963,-5894,-5833,-5785,-5748,-5718,-5686,-5646,-5593,-5528,-5451,-5360,-5258,-5147,-5030,
+-4223,-4095,-3971,-3852,-3733,-3612,-3488,-3361,-3233,-3107,-2987,-2872,-2763,-2651,-2526,-2377,
+-2201,-2005,-1809,-1645,-1552,-1563,-1701,-1965,-2337,-2781,-3260,-3739,-4193,-4608,-4978,-5304,
+-5588,-5832,-6033,-6185,-6284,-6324,-6304,-6226,-6096,-5929,-5744,-5568,-5425,-5329,-5285,-5284,
+-5313,-5357,-5406,-5451,-5486,-5504,-5496,-5460,-5398,-5320,-5242,-5177,-5131,-5102,-5082,-5058,
+-5022,-4971,-4903,-4820,-4722,-4610,-4486,-4355,-3428,-3285,-3151,-3024,-2901,-2777,-2651,-2521,
+-2389,-2258,-2132,-2013,-1899,-1781,-1649,-1490,-1303,-1097,-896,-737,-657,-692,-859,-1160,
+-1574,-2067,-2601,-3136,-3643,-4102,-4503,-4846,-5131,-5364,-5545,-5675,-5754,-5780,-5751,-5666,
+-5531,-5355,-5158,-4966,-4803,-4689,-4627,-4609,-4622,-4652,-4689,-4727,-4758,-4774,-4764,-4724,
+-4655,-4570,-4487,-4422,-4383,-4366,-4358,-4344,-4315,-4264,-4193,-4102,-3993,-3867,-3726,-3578,
+-2530,-2369,-2223,-2090,-1964,-1840,-1714,-1584,-1452,-1320,-1193,-1073,-956,-834,-696,-530,
+-337,-129,67,213,274,218,29,-293,-732,-1258,-1831,-2411,-2963,-3459,-3884,-4234,
+-4512,-4723,-4875,-4975,-5027,-5032,-4990,-4898,-4756,-4572,-4364,-4159,-3984,-3858,-3786,-3759,
+-3763,-3785,-3816,-3851,-3884,-3903,-3897,-3859,-3789,-3703,-3620,-3560,-3532,-3530,-3538,-3537,
+-3515,-3466,-3391,-3293,-3172,-3029,-2869,-2699,-1547,-1370,-1212,-1073,-947,-825,-703,-578,
+-449,-321,-197,-79,36,158,298,465,655,853,1032,1157,1196,1123,924,597,
+154,-380,-970,-1574,-2150,-2667,-3104,-3453,-3715,-3900,-4019,-4086,-4110,-4095,-4041,-3941,
+-3794,-3603,-3387,-3173,-2989,-2857,-2780,-2750,-2750,-2767,-2795,-2830,-2865,-2890,-2892,-2861,
+-2797,-2715,-2639,-2589,-2575,-2591,-2618,-2633,-2622,-2578,-2502,-2397,-2265,-2108,-1929,-1737,
+-519,-329,-163,-21,103,219,334,452,573,694,812,924,1035,1154,1290,1448,
+1625,1802,1956,2054,2071,1986,1787,1471,1044,527,-50,-647,-1221,-1735,-2166,-2502,
+-2744,-2901,-2989,-3024,-3022,-2989,-2924,-2820,-2671,-2480,-2261,-2044,-1857,-1723,-1645,-1613,
+-1610,-1625,-1650,-1684,-1722,-1753,-1763,-1742,-1689,-1619,-1554,-1519,-1524,-1560,-1607,-1640,
+-1643,-1608,-1537,-1431,-1294,-1126,-933,-725,502,699,868,1008,1128,1235,1341,1449,
+1562,1675,1786,1892,1997,2109,2236,2380,2536,2686,2808,2878,2875,2782,2590,2295,
+1901,1423,887,329,-210,-694,-1099,-1409,-1626,-1756,-1816,-1825,-1800,-1752,-1680,-1575,
+-1430,-1245,-1033,-821,-640,-509,-432,-400,-396,-408,-429,-460,-497,-531,-549,-538,
+-500,-446,-400,-384,-407,-462,-528,-581,-602,-582,-522,-423,-289,-121,76,290,
+1467,1660,1826,1962,2074,2173,2269,2368,2472,2578,2682,2784,2884,2990,3106,3234,
+3365,3486,3577,3620,3598,3499,3317,3049,2697,2273,1800,1308,832,403,44,-230,
+-416,-521,-557,-546,-505,-446,-369,-269,-133,38,232,427,595,717,788,819,
+824,816,799,773,741,709,689,690,713,747,772,769,728,657,575,504,
+464,464,506,587,707,864,1052,1259,2339,2519,2675,2804,2909,3000,3089,3180,
+3277,3378,3478,3577,3675,3776,3883,3995,4104,4198,4262,4280,4243,4140,3969,3728,
+3421,3059,2659,2248,1851,1493,1193,964,811,730,710,735,786,851,928,1022,
+1142,1292,1462,1631,1778,1886,1950,1978,1984,1979,1967,1948,1923,1898,1878,1874,
+1884,1899,1904,1883,1828,1746,1652,1567,1508,1486,1503,1561,1658,1792,1959,2147,
+3103,3263,3405,3524,3622,3708,3791,3878,3971,4068,4168,4266,4364,4463,4563,4663,
+4754,4827,4869,4869,4819,4714,4554,4339,4075,3773,3447,3118,2803,2520,2283,2101,
+1980,1920,1912,1944,1998,2064,2138,2223,2328,2453,2594,2735,2858,2949,3004,3030,
+3036,3034,3027,3015,2999,2981,2966,2959,2959,2960,2949,2914,2849,2759,2658,2562,
+2487,2443,2436,2466,2534,2639,2776,2936,3763,3899,4023,4131,4223,4306,4386,4471,
+4562,4659,4758,4859,4958,5057,5154,5246,5325,5383,5409,5396,5338,5233,5083,4892,
+4667,4419,4160,3904,3663,3448,3268,3130,3039,2996,2996,3030,3083,3146,3215,3291,
+3380,3483,3596,3708,3807,3881,3928,3952,3960,3960,3958,3953,3945,3935,3926,3919,
+3914,3904,3881,3836,3765,3671,3566,3463,3375,3313,3282,3286,3324,3397,3500,3626,
+4336,4445,4550,4645,4732,4813,4893,4979,5070,5168,5269,5372,5474,5574,5670,5757,
+5829,5877,5894,5873,5811,5708,5569,5400,5209,5006,4802,4605,4423,4264,4131,4030,
+3964,3935,3940,3972,4022,4080,4143,4210,4284,4367,4456,4544,4621,4681,4721,4743,
+4753,4758,4761,4762,4762,4760,4757,4752,4744,4728,4697,4645,4569,4474,4367,4260,
+4163,4087,4037,4017,4028,4070,4139,4231,4844,4926,5011,5094,5175,5255,5338,5426,
+5520,5619,5723,5828,5932,6033,6128,6212,6279,6321,6333,6308,6246,6148,6021,5872,
+5709,5543,5380,5228,5091,4972,4875,4802,4756,4737,4745,4775,4819,4871,4927,4985,
+5047,5113,5182,5249,5309,5357,5392,5414,5429,5439,5448,5457,5464,5469,5471,5469,
+5460,5439,5403,5347,5269,5173,5066,4957,4856,4771,4707,4668,4655,4670,4709,4769,
+5309,5368,5435,5507,5582,5661,5745,5836,5932,6034,6139,6245,6350,6451,6544,6626,
+6689,6728,6736,6710,6650,6560,6444,6313,6173,6034,5902,5782,5676,5586,5513,5460,
+5428,5417,5426,5452,5489,5534,5582,5631,5682,5735,5788,5839,5886,5926,5958,5982,
+6002,6020,6037,6053,6068,6080,6087,6088,6078,6055,6015,5955,5876,5781,5676,5568,
+5465,5375,5302,5250,5220,5213,5227,5260,5752,5794,5846,5907,5976,6053,6138,6229,
+6327,6429,6534,6640,6744,6843,6933,7011,7070,7105,7111,7085,7029,6945,6841,6725,
+6604,6486,6376,6277,6191,6120,6063,6023,5999,5992,6000,6021,6051,6088,6127,6168,
+6209,6251,6292,6333,6371,6406,6437,6465,6492,6518,6544,6569,6592,6611,6623,6625,
+6615,6590,6547,6486,6406,6313,6210,6106,6005,5915,5838,5778,5737,5715,5711,5724,
+6189,6217,6258,6311,6374,6447,6528,6618,6713,6814,6916,7019,7119,7215,7301,7374,
+7428,7459,7462,7436,7382,7305,7212,7109,7003,6900,6805,6720,6648,6588,6541,6507,
+6487,6481,6485,6501,6523,6552,6582,6615,6648,6681,6714,6747,6781,6814,6847,6880,
+6915,6950,6985,7019,7050,7075,7091,7096,7086,7059,7015,6952,6874,6783,6686,6587,
+6491,6404,6328,6266,6220,6189,6174,6174,6625,6645,6678,6723,6779,6845,6921,7005,
+7095,7189,7286,7383,7477,7566,7646,7713,7761,7787,7787,7760,7709,7638,7553,7461,
+7368,7277,7193,7118,7054,7000,6958,6927,6908,6898,6899,6907,6922,6942,6964,6989,
+7015,7042,7070,7100,7132,7166,7202,7241,7283,7326,7370,7412,7451,7482,7503,7510,
+7501,7474,7429,7367,7291,7206,7115,7024,6936,6855,6784,6724,6678,6644,6624,6618,
+7058,7073,7100,7138,7186,7244,7311,7386,7466,7551,7638,7726,7811,7892,7964,8023,
+8065,8085,8081,8053,8003,7937,7860,7778,7695,7614,7540,7472,7413,7364,7323,7293,
+7271,7259,7254,7255,7262,7274,7290,7308,7329,7352,7377,7406,7438,7474,7514,7558,
+7605,7655,7705,7755,7800,7837,7862,7873,7866,7840,7797,7739,7668,7590,7509,7427,
+7349,7277,7213,7159,7116,7084,7063,7055,7481,7492,7514,7545,7585,7633,7689,7751,
+7819,7891,7966,8041,8115,8185,8246,8296,8329,8342,8333,8303,8255,8194,8125,8052,
+7979,7908,7842,7782,7728,7682,7643,7612,7589,7572,7562,7558,7559,7565,7574,7588,
+7605,7625,7649,7678,7710,7748,7790,7836,7887,7940,7995,8049,8098,8140,8171,8186,
+8183,8162,8124,8072,8010,7942,7871,7801,7735,7673,7619,7572,7534,7506,7488,7479,
+7883,7891,7907,7931,7962,7999,8043,8092,8146,8203,8263,8323,8382,8437,8486,8523,
+8546,8550,8535,8502,8456,8401,8341,8278,8216,8156,8099,8047,8000,7958,7923,7893,
+7869,7850,7837,7829,7826,7828,7833,7843,7858,7876,7899,7926,7958,7995,8036,8082,
+8131,8184,8239,8293,8344,8389,8425,8446,8451,8439,8410,8368,8318,8262,8204,8147,
+8093,8043,7998,7960,7929,7906,7890,7882,8255,8260,8271,8287,8309,8335,8366,8401,
+8440,8481,8524,8567,8609,8647,8679,8700,8708,8700,8678,8644,8602,8555,8506,8455,
+8406,8358,8313,8271,8232,8198,8168,8141,8120,8102,8089,8081,8076,8076,8079,8087,
+8099,8115,8135,8159,8188,8221,8257,8298,8342,8389,8437,8487,8535,8581,8620,8649,
+8665,8665,8651,8623,8587,8546,8503,8460,8419,8381,8347,8318,8294,8276,8263,8256,
+8593,8595,8600,8609,8622,8637,8656,8677,8700,8724,8748,8772,8793,8810,8819,8819,
+8809,8790,8764,8733,8700,8665,8629,8593,8558,8525,8493,8463,8436,8411,8389,8370,
+8353,8340,8330,8323,8319,8319,8322,8328,8337,8349,8365,8384,8406,8431,8459,8490,
+8523,8558,8595,8634,8673,8712,8749,8782,8810,8829,8836,8830,8813,8790,8764,8736,
+8709,8684,8661,8641,8624,8611,8601,8595,8894,8893,8893,8894,8897,8901,8904,8908,
+8911,8912,8911,8907,8899,8889,8875,8860,8843,8825,8806,8786,8767,8747,8728,8709,
+8690,8673,8656,8640,8626,8613,8601,8591,8583,8576,8570,8567,8565,8565,8567,8571,
+8577,8584,8593,8604,8616,8630,8646,8663,8681,8701,8721,8742,8764,8787,8810,8833,
+8856,8878,8900,8921,8940,8955,8965,8966,8959,8948,8937,8926,8917,8909,8902,8897,
+8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,
+8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,
+8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,
+8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,8821,
+8821,8821,8821,8821,8821,8821,8821,8821},
+{13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,
+13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,
+13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,
+13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,13629,
+13629,13629,13629,13629,13629,13629,13629,13629,14484,14449,14409,14363,14311,14254,14193,14127,
+14058,13986,13911,13833,13754,13674,13593,13511,13430,13350,13272,13195,13121,13050,12982,12919,
+12860,12806,12757,12714,12677,12647,12623,12606,12597,12594,12600,12613,12633,12661,12696,12739,
+12788,12845,12907,12975,13049,13127,13209,13294,13382,13472,13562,13653,13743,13831,13917,14000,
+14079,14154,14224,14288,14346,14397,14442,14479,14509,14532,14547,14555,14555,14548,14533,14512,
+15145,15071,14986,14892,14789,14678,14559,14434,14302,14165,14023,13877,13728,13577,13424,13271,
+13118,12967,12818,12673,12533,12398,12269,12148,12035,11931,11836,11751,11678,11616,11566,11529,
+11505,11495,11499,11519,11553,11603,11668,11748,11844,11954,12078,12216,12365,12525,12694,12871,
+13053,13239,13428,13616,13802,13984,14160,14329,14488,14636,14772,14895,15004,15098,15176,15239,
+15287,15319,15336,15338,15325,15299,15260,15208,15574,15457,15327,15187,15036,14876,14707,14529,
+14344,14152,13953,13748,13539,13325,13110,12892,12676,12461,12251,12045,11847,11657,11477,11308,
+11150,11005,10874,10756,10652,10564,10492,10436,10398,10378,10379,10400,10444,10510,10600,10714,
+10852,11014,11198,11403,11629,11872,12130,12400,12680,12966,13255,13543,13827,14103,14368,14619,
+14853,15068,15262,15433,15581,15704,15802,15875,15924,15950,15953,15935,15898,15841,15767,15678,
+15757,15596,15424,15241,15049,14847,14637,14418,14190,13954,13710,13457,13197,12931,12660,12386,
+12112,11841,11574,11316,11068,10832,10611,10406,10217,10045,9890,9751,9629,9525,9437,9369,
+9320,9292,9288,9310,9359,9439,9549,9693,9869,10078,10319,10591,10890,11214,11559,11922,
+12296,12679,13065,13448,13824,14187,14533,14858,15158,15428,15668,15874,16046,16182,16285,16353,
+16389,16394,16370,16320,16246,16150,16036,15904,15709,15508,15297,15077,14850,14616,14375,14126,
+13868,13600,13322,13033,12734,12424,12106,11784,11459,11136,10820,10516,10226,9954,9703,9474,
+9268,9083,8920,8776,8650,8542,8451,8377,8322,8289,8280,8300,8352,8440,8567,8735,
+8945,9197,9491,9823,10192,10591,11017,11464,11926,12396,12867,13335,13791,14229,14643,15028,
+15379,15691,15961,16187,16368,16504,16596,16647,16658,16632,16573,16484,16369,16230,16072,15898,
+15469,15233,14989,14740,14486,14227,13964,13695,13417,13130,12831,12518,12190,11848,11494,11131,
+10763,10397,10039,9695,9371,9073,8803,8563,8354,8173,8017,7884,7770,7671,7586,7515,
+7460,7423,7410,7425,7474,7564,7700,7884,8121,8409,8749,9136,9566,10033,10530,11050,
+11585,12128,12671,13205,13724,14219,14684,15112,15496,15833,16118,16349,16527,16651,16723,16748,
+16728,16667,16571,16442,16287,16108,15910,15696,15088,14824,14554,14281,14007,13730,13452,13171,
+12883,12586,12276,11950,11606,11244,10866,10474,10075,9676,9285,8911,8563,8247,7968,7729,
+7530,7368,7236,7129,7040,6963,6896,6836,6784,6746,6725,6730,6770,6852,6985,7175,
+7427,7741,8117,8549,9031,9556,10113,10694,11289,11887,12482,13063,13624,14155,14649,15099,
+15499,15843,16128,16352,16515,16619,16667,16663,16613,16520,16389,16226,16036,15823,15591,15345,
+14612,14326,14037,13747,13457,13169,12881,12592,12300,12000,11688,11360,11012,10643,10254,9848,
+9432,9014,8603,8210,7848,7524,7247,7020,6843,6711,6615,6546,6494,6450,6408,6366,
+6324,6286,6258,6250,6271,6334,6451,6632,6884,7210,7609,8074,8598,9169,9775,10404,
+11043,11680,12308,12915,13495,14040,14542,14994,15390,15724,15994,16199,16340,16420,16442,16413,
+16336,16217,16061,15872,15656,15418,15161,14891,14071,13772,13470,13169,12869,12572,12278,11986,
+11692,11394,11086,10764,10422,10060,9675,9272,8856,8434,8018,7620,7254,6933,6667,6460,
+6313,6219,6166,6141,6131,6124,6114,6096,6071,6040,6010,5990,5991,6028,6118,6274,
+6510,6830,7235,7719,8271,8876,9518,10181,10850,11510,12152,12767,13347,13884,14373,14807,
+15180,15488,15730,15906,16019,16073,16072,16021,15926,15789,15616,15411,15179,14924,14651,14366,
+13484,13178,12870,12563,12258,11957,11659,11366,11074,10780,10481,10170,9845,9500,9135,8750,
+8350,7941,7535,7145,6788,6479,6231,6051,5937,5883,5873,5890,5920,5951,5974,5986,
+5986,5975,5956,5936,5925,5939,5997,6118,6321,6617,7008,7490,8051,8672,9335,10018,
+10702,11371,12013,12618,13180,13693,14151,14549,14882,15149,15351,15491,15572,15600,15579,15514,
+15406,15260,15079,14866,14626,14363,14081,13787,12858,12551,12244,11937,11633,11331,11034,10742,
+10454,10168,9881,9587,9284,8967,8633,8280,7911,7529,7147,6778,6441,6153,5929,5777,
+5697,5678,5704,5757,5820,5883,5940,5986,6022,6045,6056,6055,6049,6052,6085,6169,
+6329,6582,6937,7392,7937,8553,9215,9900,10583,11245,11873,12457,12989,13465,13879,14227,
+14507,14721,14873,14970,15018,15022,14985,14909,14795,14646,14463,14249,14007,13742,13459,13162,
+12197,11896,11595,11296,10998,10703,10412,10127,9847,9572,9300,9028,8753,8470,8175,7864,
+7536,7194,6847,6511,6203,5943,5746,5623,5570,5579,5632,5710,5799,5889,5977,6062,
+6141,6211,6267,6303,6322,6333,6353,6407,6520,6718,7016,7418,7919,8501,9138,9803,
+10467,11108,11710,12262,12757,13188,13549,13839,14057,14210,14307,14358,14373,14356,14306,14224,
+14108,13958,13777,13566,13329,13067,12788,12496,11507,11219,10932,10648,10365,10084,9807,9535,
+9270,9012,8761,8515,8272,8028,7777,7513,7233,6938,6636,6340,6070,5843,5675,5575,
+5544,5570,5638,5733,5840,5954,6072,6194,6319,6441,6548,6632,6688,6720,6741,6774,
+6846,6984,7211,7541,7974,8495,9082,9703,10328,10932,11497,12010,12461,12844,13151,13380,
+13533,13622,13663,13670,13654,13618,13559,13473,13356,13209,13031,12827,12597,12345,12075,11794,
+10803,10536,10272,10010,9751,9493,9239,8990,8749,8516,8292,8078,7871,7668,7462,7248,
+7019,6776,6524,6276,6047,5854,5712,5630,5608,5641,5715,5818,5938,6071,6215,6371,
+6536,6702,6856,6984,7078,7137,7169,7192,7231,7314,7470,7718,8067,8510,9026,9583,
+10151,10702,11218,11684,12089,12424,12678,12849,12942,12972,12961,12928,12885,12834,12768,12679,
+12562,12417,12244,12047,11828,11589,11335,11071,10113,9874,9640,9409,9181,8956,8735,8519,
+8311,8113,7925,7748,7581,7420,7261,7095,6919,6729,6530,6330,6143,5982,5859,5784,
+5761,5788,5857,5959,6086,6233,6396,6576,6767,6962,7146,7305,7428,7511,7556,7578,
+7596,7637,7731,7902,8168,8526,8959,9438,9934,10420,10877,11291,11647,11935,12141,12262,
+12305,12287,12235,12170,12105,12041,11968,11876,11758,11613,11444,11255,11049,10828,10595,10355,
+9475,9272,9074,8881,8692,8507,8326,8153,7987,7832,7687,7553,7429,7313,7199,7083,
+6957,6819,6671,6517,6366,6230,6117,6039,6002,6010,6061,6152,6276,6426,6598,6787,
+6988,7191,7385,7556,7695,7793,7852,7878,7888,7904,7954,8067,8261,8540,8890,9287,
+9704,10117,10508,10864,11171,11413,11578,11661,11668,11618,11537,11450,11368,11291,11209,11110,
+10987,10841,10676,10495,10303,10102,9894,9684,8935,8772,8616,8465,8319,8178,8044,7918,
+7802,7697,7601,7514,7437,7366,7298,7228,7151,7061,6956,6840,6717,6595,6484,6393,
+6332,6309,6330,6396,6502,6642,6807,6990,7182,7375,7561,7729,7869,7975,8045,8082,
+8095,8105,8135,8213,8357,8572,8849,9168,9507,9847,10171,10468,10724,10924,11056,11111,
+11097,11030,10936,10834,10738,10646,10549,10438,10307,10156,9991,9818,9640,9460,9280,9104,
+8530,8411,8298,8191,8089,7993,7907,7832,7769,7717,7674,7638,7609,7585,7562,7537,
+7502,7452,7383,7293,7186,7068,6949,6839,6747,6687,6668,6696,6771,6885,7027,7188,
+7358,7530,7697,7851,7985,8094,8174,8224,8252,8273,8306,8374,8492,8665,8884,9137,
+9406,9678,9940,10181,10390,10552,10655,10694,10671,10601,10503,10394,10283,10171,10052,9920,
+9772,9612,9444,9275,9109,8950,8799,8659,8286,8208,8138,8072,8012,7960,7920,7895,
+7884,7886,7897,7914,7935,7958,7979,7995,7998,7980,7934,7859,7758,7636,7502,7367,
+7243,7143,7081,7066,7099,7174,7282,7411,7551,7697,7842,7981,8108,8218,8307,8374,
+8424,8469,8522,8601,8714,8863,9042,9244,9457,9672,9882,10076,10244,10375,10457,10486,
+10463,10397,10300,10184,10056,9917,9768,9606,9434,9257,9079,8909,8750,8608,8483,8376,
+8207,8164,8129,8101,8079,8067,8070,8092,8131,8186,8250,8319,8389,8459,8524,8577,
+8612,8618,8588,8520,8416,8282,8129,7968,7812,7676,7574,7516,7506,7540,7608,7701,
+7810,7930,8056,8183,8307,8420,8520,8604,8679,8752,8835,8934,9054,9194,9349,9515,
+9687,9861,10032,10192,10331,10439,10508,10533,10514,10454,10360,10236,10086,9916,9728,9529,
+9324,9120,8926,8746,8587,8453,8346,8265,8282,8264,8258,8261,8272,8296,8338,8403,
+8489,8592,8705,8824,8942,9056,9160,9249,9310,9335,9316,9250,9139,8991,8817,8630,
+8446,8279,8144,8052,8006,8002,8033,8092,8173,8271,8383,8504,8627,8746,8856,8957,
+9054,9153,9262,9383,9515,9654,9796,9940,10087,10236,10384,10524,10647,10744,10808,10834,
+10821,10768,10673,10538,10365,10160,9932,9690,9446,9209,8989,8792,8624,8488,8388,8321,
+8499,8493,8506,8533,8572,8629,8708,8811,8938,9083,9241,9403,9563,9717,9857,9975,
+10060,10101,10091,10025,9908,9746,9553,9344,9135,8944,8785,8667,8593,8560,8562,8592,
+8649,8729,8830,8947,9071,9195,9314,9428,9540,9659,9786,9922,10064,10204,10342,10477,
+10613,10752,10892,11026,11147,11244,11312,11345,11339,11290,11193,11046,10851,10614,10346,10063,
+9778,9506,9255,9033,8847,8701,8596,8530,8843,8840,8863,8906,8970,9056,9167,9304,
+9467,9648,9841,10038,10233,10418,10586,10727,10831,10885,10883,10819,10698,10526,10319,10093,
+9867,9657,9480,9344,9249,9193,9172,9180,9217,9281,9372,9482,9605,9731,9855,9975,
+10097,10224,10360,10503,10649,10793,10932,11069,11208,11350,11494,11635,11764,11871,11950,11994,
+11996,11950,11851,11694,11480,11217,10917,10599,10279,9973,9692,9445,9237,9072,8953,8878,
+9307,9299,9324,9379,9461,9571,9710,9877,10068,10277,10496,10718,10936,11141,11327,11483,
+11598,11661,11664,11604,11482,11307,11094,10858,10620,10399,10208,10056,9944,9869,9827,9817,
+9835,9884,9962,10063,10179,10301,10423,10545,10667,10795,10931,11074,11221,11369,11516,11664,
+11815,11971,12131,12287,12432,12555,12648,12704,12714,12672,12571,12407,12181,11901,11582,11241,
+10897,10566,10262,9992,9763,9580,9443,9353,9882,9865,9889,9949,10045,10174,10334,10522,
+10733,10960,11194,11429,11656,11869,12060,12220,12337,12403,12409,12351,12233,12060,11847,11610,
+11369,11141,10939,10773,10644,10551,10491,10462,10463,10495,10556,10642,10745,10857,10972,11087,
+11205,11329,11460,11600,11748,11901,12060,12224,12395,12573,12754,12931,13094,13234,13342,13409,
+13427,13388,13287,13120,12890,12606,12280,11932,11579,11238,10921,10639,10397,10198,10047,9941,
+10556,10532,10551,10613,10715,10853,11025,11223,11442,11674,11911,12145,12370,12578,12761,12913,
+13023,13084,13088,13032,12918,12752,12546,12316,12078,11849,11642,11464,11320,11209,11130,11082,
+11065,11078,11119,11186,11270,11366,11468,11573,11683,11800,11926,12063,12213,12374,12546,12730,
+12924,13125,13328,13525,13706,13862,13981,14057,14080,14044,13945,13781,13556,13279,12962,12623,
+12277,11942,11629,11347,11103,10899,10739,10625,11303,11274,11290,11349,11449,11585,11754,11949,
+12162,12385,12610,12830,13039,13229,13395,13529,13624,13673,13671,13615,13506,13350,13157,12940,
+12713,12490,12283,12099,11943,11817,11721,11655,11618,11610,11630,11673,11736,11812,11898,11991,
+12092,12202,12324,12462,12615,12785,12972,13173,13387,13607,13828,14040,14234,14399,14526,14606,
+14633,14601,14507,14353,14142,13883,13589,13273,12952,12639,12345,12078,11844,11647,11490,11375,
+12079,12050,12061,12113,12202,12325,12478,12653,12844,13043,13242,13436,13617,13780,13920,14029,
+14104,14138,14127,14070,13968,13826,13651,13453,13243,13034,12833,12650,12489,12353,12244,12162,
+12107,12080,12077,12098,12138,12194,12263,12344,12436,12542,12663,12802,12960,13138,13335,13548,
+13774,14005,14234,14453,14650,14817,14945,15027,15056,15030,14946,14808,14620,14390,14130,13852,
+13569,13291,13029,12790,12579,12400,12256,12148,12827,12798,12804,12843,12914,13013,13137,13280,
+13436,13598,13760,13916,14062,14191,14298,14380,14432,14449,14431,14374,14281,14155,14002,13828,
+13643,13454,13269,13096,12939,12801,12686,12594,12526,12482,12461,12462,12483,12521,12576,12645,
+12731,12833,12953,13094,13254,13436,13635,13851,14076,14305,14530,14743,14934,15095,15218,15298,
+15330,15312,15244,15129,14972,14780,14564,14332,14096,13863,13643,13440,13261,13108,12983,12889,
+13480,13452,13450,13473,13521,13590,13678,13781,13893,14011,14129,14242,14346,14437,14512,14565,
+14594,14598,14572,14519,14437,14330,14201,14056,13899,13738,13578,13424,13281,13152,13039,12946,
+12873,12820,12787,12775,12782,12808,12851,12912,12992,13090,13207,13345,13502,13678,13870,14074,
+14286,14499,14707,14901,15075,15222,15336,15411,15446,15439,15391,15304,15184,15037,14869,14689,
+14504,14321,14147,13985,13841,13716,13613,13534,13986,13957,13946,13952,13975,14013,14064,14126,
+14194,14266,14339,14409,14472,14526,14568,14595,14605,14596,14567,14518,14449,14362,14260,14145,
+14021,13892,13762,13636,13516,13405,13307,13222,13154,13101,13067,13050,13051,13069,13106,13160,
+13233,13324,13434,13561,13705,13864,14036,14216,14401,14585,14763,14929,15078,15204,15303,15372,
+15410,15415,15388,15333,15252,15150,15032,14903,14769,14636,14507,14386,14276,14179,14098,14033,
+14315,14284,14265,14257,14259,14270,14289,14314,14344,14377,14410,14442,14469,14491,14505,14510,
+14504,14487,14456,14413,14358,14292,14215,14130,14039,13944,13848,13754,13663,13579,13503,13437,
+13383,13341,13313,13300,13301,13318,13350,13398,13462,13542,13636,13744,13865,13996,14136,14282,
+14429,14575,14715,14846,14963,15064,15145,15206,15244,15259,15252,15225,15180,15120,15047,14965,
+14879,14790,14703,14619,14540,14470,14408,14356,14468,14439,14416,14399,14386,14379,14375,14375,
+14377,14381,14385,14388,14390,14388,14382,14372,14355,14333,14304,14268,14226,14178,14125,14068,
+14007,13945,13882,13821,13763,13708,13659,13617,13582,13557,13541,13536,13542,13559,13587,13627,
+13679,13741,13813,13895,13985,14081,14182,14286,14391,14493,14592,14684,14768,14842,14903,14952,
+14987,15008,15015,15009,14992,14964,14928,14885,14837,14787,14734,14682,14632,14585,14541,14502,
+14473,14451,14430,14411,14394,14378,14364,14351,14339,14327,14315,14303,14291,14277,14261,14244,
+14224,14202,14178,14151,14123,14092,14060,14026,13992,13958,13924,13892,13862,13835,13811,13791,
+13777,13767,13764,13766,13775,13791,13813,13842,13878,13919,13965,14017,14072,14131,14192,14254,
+14317,14378,14436,14492,14543,14589,14629,14663,14690,14710,14723,14729,14728,14722,14711,14695,
+14676,14653,14628,14602,14576,14549,14523,14497,14372,14360,14348,14335,14323,14310,14298,14285,
+14272,14259,14246,14233,14220,14207,14193,14179,14165,14150,14135,14121,14106,14091,14076,14062,
+14049,14036,14024,14013,14004,13996,13990,13986,13984,13984,13987,13992,13999,14009,14022,14037,
+14054,14073,14094,14117,14141,14166,14191,14217,14243,14269,14294,14317,14340,14361,14380,14396,
+14411,14423,14433,14441,14446,14449,14449,14448,14444,14439,14433,14425,14416,14406,14395,14384,
+14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,
+14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,
+14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,
+14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,14204,
+14204,14204,14204,14204,14204,14204,14204,14204}};
+}
+#endif /* GEOMAG_TABLE_HPP */
@@ -0,0 +1,376 @@
+/*
+MIT License
+
+Copyright (c) 2019 Nathan Zimmerberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/** \file
+ * \brief Precomputed field tiles in a memory mapped file, with tricubic interpolation.
+ * \details For many lookups in a fixed height band, the field is sampled once on a global
+geodetic latitude, longitude, height grid and saved to a file, then interpolated with
+Catmull-Rom cubics along each axis from the 4x4x4 surrounding nodes.
+
+The International Terrestrial Reference System components are stored, in nT as floats,
+because they are smooth across the poles, unlike north and east.
+The grid has an extra row of nodes past each pole and an extra layer of nodes
+below and above the height band, so the interpolation never needs to clamp.
+
+File layout, in the byte order of the machine that built it:
+    TileHeader
+    float field[nh][nlat][nlon][3]
+
+Requires POSIX mmap.
+*/
+#ifndef GEOMAG_TILES_HPP
+#define GEOMAG_TILES_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "XYZgeomag_grid.hpp"
+
+namespace geomag
+{
+constexpr uint32_t TILE_VERSION= 1;//increment when the file layout changes
+constexpr char TILE_MAGIC[8]= {'X','Y','Z','G','T','I','L','E'};
+constexpr uint32_t TILE_BYTE_ORDER= 0x01020304;//reads differently if the file was built with the other byte order
+
+/** Header at the start of a tile file.*/
+struct TileHeader{
+    char magic[8];// TILE_MAGIC
+    uint32_t version;// TILE_VERSION
+    uint32_t byte_order;// TILE_BYTE_ORDER
+    float dyear;// decimal year the field is sampled at
+    float max_error;// largest interpolation error measured by buildTiles, units nT
+    float h_min;// bottom of the height band above the WGS 84 ellipsoid, units m
+    float h_max;// top of the height band, units m
+    float lat0;// latitude of the first node row, one row past the south pole, degrees
+    float dlat;// latitude spacing, degrees
+    float lon0;// longitude of the first node column, degrees
+    float dlon;// longitude spacing, 360/nlon degrees
+    float h0;// height of the first node layer, one layer below h_min, m
+    float dh;// height spacing, m
+    int32_t nlat;// number of node rows
+    int32_t nlon;// number of node columns, the last wraps around to the first
+    int32_t nh;// number of node layers
+    uint32_t reserved;
+};
+
+/** Return the number of floats of field data of a tile file.*/
+inline size_t tileDataSize(const TileHeader& header){
+    return (size_t)header.nh*header.nlat*header.nlon*3;
+}
+
+/** Return the header of a tile set covering h_min to h_max,
+with about angle_spacing degrees and height_spacing m between nodes.*/
+inline TileHeader makeTileHeader(float dyear, TPrecision h_min, TPrecision h_max, TPrecision angle_spacing, TPrecision height_spacing){
+    TileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TILE_MAGIC, sizeof(header.magic));
+    header.version= TILE_VERSION;
+    header.byte_order= TILE_BYTE_ORDER;
+    header.dyear= dyear;
+    header.h_min= h_min;
+    header.h_max= h_max;
+    int lat_intervals= (int)std::ceil(180/angle_spacing);
+    header.dlat= 180.0f/lat_intervals;
+    header.lat0= -90-header.dlat;
+    header.nlat= lat_intervals+3;
+    header.nlon= (int)std::ceil(360/angle_spacing);
+    header.dlon= 360.0f/header.nlon;
+    header.lon0= -180;
+    int h_intervals= (h_max > h_min) ? (int)std::ceil((h_max-h_min)/height_spacing) : 1;
+    header.dh= (h_max > h_min) ? (h_max-h_min)/h_intervals : 1;
+    header.h0= h_min-header.dh;
+    header.nh= h_intervals+3;
+    return header;
+}
+
+/** Return the field at the nodes of header, in the layout of a tile file.*/
+inline std::vector<float> sampleTiles(const TileHeader& header, const DerivativeCoeffs& coeffs){
+    GeodeticGrid grid;
+    grid.lat0= header.lat0;
+    grid.dlat= header.dlat;
+    grid.nlat= header.nlat;
+    grid.lon0= header.lon0;
+    grid.dlon= header.dlon;
+    grid.nlon= header.nlon;
+    grid.h0= header.h0;
+    grid.dh= header.dh;
+    grid.nh= header.nh;
+    size_t size= gridSize(grid);
+    std::vector<TPrecision> x(size), y(size), z(size);
+    GeoMagGlobalGrid(grid, coeffs, GRID_ITRS, x.data(), y.data(), z.data());
+    std::vector<float> data(3*size);
+    for (size_t i = 0; i < size; i++){
+        data[3*i]= x[i]*1E9f;
+        data[3*i+1]= y[i]*1E9f;
+        data[3*i+2]= z[i]*1E9f;
+    }
+    return data;
+}
+
+/** Catmull-Rom weights of the nodes at -1, 0, 1, 2 for a point t from 0 to 1 between nodes 0 and 1.*/
+inline void catmullRomWeights(TPrecision t, TPrecision w[4]){
+    TPrecision t2= t*t;
+    TPrecision t3= t2*t;
+    w[0]= 0.5f*(-t3+2*t2-t);
+    w[1]= 0.5f*(3*t3-5*t2+2);
+    w[2]= 0.5f*(-3*t3+4*t2+t);
+    w[3]= 0.5f*(t3-t2);
+}
+
+/** Split a coordinate into the index of the node below it, clamped to 1 to count-3, and the fraction past it.
+The interpolation reads the nodes from index-1 to index+2, so the clamp keeps them inside the count nodes.*/
+inline int tileIndex(TPrecision coordinate, TPrecision first, TPrecision spacing, int count, TPrecision& t){
+    TPrecision f= (coordinate-first)/spacing;
+    TPrecision node= std::floor(f);
+    // clamped before the conversion to int, which is undefined for NaN or values out of range
+    int i;
+    if (!(node >= 1)){
+        i= 1;
+    }
+    else if (node > count-3){
+        i= count-3;
+    }
+    else{
+        i= (int)node;
+    }
+    t= f-i;
+    return i;
+}
+
+/** Return the interpolated field, in International Terrestrial Reference System coordinates, units Tesla.
+ INPUT:
+    header(): Header of the tiles.
+    data(): Field data of the tiles.
+    lat: Geodetic latitude in degrees, -90 to 90.
+    lon(finite): Geodetic longitude in degrees.
+    h(h_min to h_max): Height above the WGS 84 ellipsoid in meters.
+ */
+inline Vector interpolateTiles(const TileHeader& header, const float* data, TPrecision lat, TPrecision lon, TPrecision h){
+    TPrecision tlat, th;
+    int ilat= tileIndex(lat, header.lat0, header.dlat, header.nlat, tlat);
+    int ih= tileIndex(h, header.h0, header.dh, header.nh, th);
+    // the nodes cover 360 degrees, wrapping first keeps the node index in the range of int
+    TPrecision flon= std::fmod(lon-header.lon0, (TPrecision)360)/header.dlon;
+    TPrecision floor_lon= std::floor(flon);
+    TPrecision tlon= flon-floor_lon;
+    int ilon= ((int)floor_lon)%header.nlon;
+    if (ilon < 0){
+        ilon+= header.nlon;
+    }
+    TPrecision wlat[4], wlon[4], wh[4];
+    catmullRomWeights(tlat, wlat);
+    catmullRomWeights(tlon, wlon);
+    catmullRomWeights(th, wh);
+    int lons[4];
+    for (int k = 0; k < 4; k++){
+        lons[k]= (ilon-1+k+header.nlon)%header.nlon;
+    }
+    TPrecision sum[3]= {0, 0, 0};
+    for (int kh = 0; kh < 4; kh++){
+        for (int klat = 0; klat < 4; klat++){
+            const float* row= data+((size_t)(ih-1+kh)*header.nlat+(ilat-1+klat))*header.nlon*3;
+            TPrecision w= wh[kh]*wlat[klat];
+            for (int c = 0; c < 3; c++){
+                TPrecision line= wlon[0]*row[3*lons[0]+c]+wlon[1]*row[3*lons[1]+c]+wlon[2]*row[3*lons[2]+c]+wlon[3]*row[3*lons[3]+c];
+                sum[c]+= w*line;
+            }
+        }
+    }
+    return {sum[0]*1E-9f, sum[1]*1E-9f, sum[2]*1E-9f};
+}
+
+/** Return the largest interpolation error found at samples random points in the height band, units nT.*/
+inline TPrecision measureTileError(const TileHeader& header, const float* data, const DerivativeCoeffs& coeffs, int samples){
+    uint32_t state= 12345;
+    auto uniform= [&state](){
+        state= state*1664525u+1013904223u;
+        return (TPrecision)((state>>8)*(1.0/16777216.0));
+    };
+    TPrecision worst= 0;
+    for (int i = 0; i < samples; i++){
+        TPrecision lat= std::asin(2*uniform()-1)*((TPrecision)(180.0/M_PI));//uniform on the sphere
+        TPrecision lon= 360*uniform()-180;
+        TPrecision h= header.h_min+(header.h_max-header.h_min)*uniform();
+        Vector truth= GeoMag(geodetic2ecef(lat, lon, h), coeffs);
+        Vector out= interpolateTiles(header, data, lat, lon, h);
+        TPrecision dx= (out.x-truth.x)*1E9f;
+        TPrecision dy= (out.y-truth.y)*1E9f;
+        TPrecision dz= (out.z-truth.z)*1E9f;
+        TPrecision error= std::sqrt(dx*dx+dy*dy+dz*dz);
+        if (error > worst){
+            worst= error;
+        }
+    }
+    return worst;
+}
+
+/** Sample the field of a model into a tile file, choosing the node spacing so the measured
+interpolation error is at most max_error. The spacing starts coarse and is refined using
+the error measured at random points, which scales with the cube of the spacing.
+Return false if the spacing would have to be finer than 0.05 degrees, or the file can't be written.
+ INPUT:
+    path(): File to write.
+    dyear(should be around the epoch of the model): The decimal year of the field.
+    WMM(): Magnetic field model to use.
+    h_min, h_max(Above the surface of earth): The height band above the WGS 84 ellipsoid, units m.
+    max_error(>0): The largest allowed interpolation error, units nT.
+ OUTPUT:
+    header: The header written to the file, if not nullptr.
+ */
+inline bool buildTiles(const char* path, float dyear, const ConstModel& WMM, TPrecision h_min, TPrecision h_max, TPrecision max_error, TileHeader* header= nullptr){
+    const int samples= 20000;
+    DerivativeCoeffs coeffs= derivativeCoeffs(snapshotModel(dyear, WMM));
+    TPrecision angle_spacing= 2;
+    TPrecision height_spacing= 10000;
+    TileHeader candidate;
+    std::vector<float> data;
+    while (true){
+        candidate= makeTileHeader(dyear, h_min, h_max, angle_spacing, height_spacing);
+        data= sampleTiles(candidate, coeffs);
+        TPrecision error= measureTileError(candidate, data.data(), coeffs, samples);
+        if (error <= max_error){
+            candidate.max_error= error;
+            break;
+        }
+        // the error on a node layer is only from the angular spacing, the rest is put down to the height spacing
+        TileHeader layer= candidate;
+        layer.h_max= layer.h_min;
+        TPrecision angle_error= measureTileError(layer, data.data(), coeffs, samples);
+        TPrecision height_error= error-angle_error;
+        bool refined= false;
+        if (angle_error > 0.5f*max_error){
+            angle_spacing*= std::min((TPrecision)0.9f, std::cbrt(0.4f*max_error/angle_error));
+            refined= true;
+        }
+        if (height_error > 0.5f*max_error){
+            height_spacing*= std::min((TPrecision)0.9f, std::cbrt(0.4f*max_error/height_error));
+            refined= true;
+        }
+        if (!refined){
+            angle_spacing*= 0.9f;
+            height_spacing*= 0.9f;
+        }
+        if (angle_spacing < 0.05f){
+            return false;
+        }
+    }
+    FILE* file= fopen(path, "wb");
+    if (!file){
+        return false;
+    }
+    bool ok= fwrite(&candidate, sizeof(candidate), 1, file) == 1 &&
+             fwrite(data.data(), sizeof(float), data.size(), file) == data.size();
+    ok= (fclose(file) == 0) && ok;
+    if (ok && header){
+        *header= candidate;
+    }
+    return ok;
+}
+
+/** A tile file mapped into memory by openTiles, closed by closeTiles.*/
+struct TileMap{
+    const TileHeader* header;
+    const float* data;// field data, right after the header
+    void* mapping;
+    size_t size;// bytes mapped
+};
+
+/** Memory map a tile file without copying it.
+Return false if the file can't be mapped, isn't a tile file of this version and byte order,
+or its measured interpolation error is more than max_error.
+ INPUT:
+    path(): File made by buildTiles.
+    max_error(): The largest interpolation error the caller accepts, units nT.
+ OUTPUT:
+    tiles: The mapped tiles.
+ */
+inline bool openTiles(const char* path, TPrecision max_error, TileMap& tiles){
+    tiles= TileMap{nullptr, nullptr, nullptr, 0};
+    int fd= open(path, O_RDONLY);
+    if (fd < 0){
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(TileHeader)){
+        close(fd);
+        return false;
+    }
+    size_t size= info.st_size;
+    void* mapping= mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED){
+        return false;
+    }
+    const TileHeader* header= (const TileHeader*)mapping;
+    bool ok= memcmp(header->magic, TILE_MAGIC, sizeof(TILE_MAGIC)) == 0 &&
+             header->version == TILE_VERSION &&
+             header->byte_order == TILE_BYTE_ORDER &&
+             header->nlat >= 4 && header->nlon >= 4 && header->nh >= 4 &&
+             size == sizeof(TileHeader)+tileDataSize(*header)*sizeof(float) &&
+             header->max_error <= max_error;
+    if (!ok){
+        munmap(mapping, size);
+        return false;
+    }
+    tiles= TileMap{header, (const float*)(header+1), mapping, size};
+    return true;
+}
+
+/** Unmap tiles opened by openTiles.*/
+inline void closeTiles(TileMap& tiles){
+    if (tiles.mapping){
+        munmap(tiles.mapping, tiles.size);
+    }
+    tiles= TileMap{nullptr, nullptr, nullptr, 0};
+}
+
+/** Return false if the point is outside the height band of the tiles, the latitude is outside -90 to 90,
+or any coordinate is NaN or infinite, otherwise interpolate the field in International Terrestrial Reference System coordinates, units Tesla.
+ INPUT:
+    tiles(): Tiles opened by openTiles.
+    lat: Geodetic latitude in degrees, -90 to 90.
+    lon: Geodetic longitude in degrees.
+    h: Height above the WGS 84 ellipsoid in meters.
+ OUTPUT:
+    field: The interpolated field.
+ */
+inline bool tileField(const TileMap& tiles, TPrecision lat, TPrecision lon, TPrecision h, Vector& field){
+    // written so NaN fails every comparison
+    bool inside= h >= tiles.header->h_min && h <= tiles.header->h_max && lat >= -90 && lat <= 90 && std::isfinite(lon);
+    if (!inside){
+        return false;
+    }
+    field= interpolateTiles(*tiles.header, tiles.data, lat, lon, h);
+    return true;
+}
+}
+#endif /* GEOMAG_TILES_HPP */